@@ -0,0 +1,35 @@
+// Hi-Z pyramid stored level after level in one float buffer. Level 0 has half
+// the depth buffer's resolution, every texel holds the farthest depth of the
+// 2x2 texels below it, down to a single texel.
+
+uvec2 HiZHalfSize(uvec2 size) {
+    return max((size + 1u) >> 1u, uvec2(1u));
+}
+
+uvec2 HiZLevelSize(uvec2 depthSize, uint level) {
+    uvec2 size = HiZHalfSize(depthSize);
+    for (uint i = 0u; i < level; ++i) {
+        size = HiZHalfSize(size);
+    }
+    return size;
+}
+
+uint HiZLevelOffset(uvec2 depthSize, uint level) {
+    uint offset = 0u;
+    uvec2 size = HiZHalfSize(depthSize);
+    for (uint i = 0u; i < level; ++i) {
+        offset += size.x * size.y;
+        size = HiZHalfSize(size);
+    }
+    return offset;
+}
+
+uint HiZLevelCount(uvec2 depthSize) {
+    uint count = 1u;
+    uvec2 size = HiZHalfSize(depthSize);
+    while (size.x > 1u || size.y > 1u) {
+        size = HiZHalfSize(size);
+        ++count;
+    }
+    return count;
+}
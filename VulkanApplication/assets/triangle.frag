@@ -1,9 +1,63 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+
 layout (location = 0) in vec3 vertColor;
+layout (location = 1) flat in uint drawIndex;
 
 layout (location = 0) out vec4 fragColor;
 
+// Feature switches, specialized per pipeline. Untextured scenes compile the
+// texture table lookup out; TextureTaps squared samples are averaged per pixel.
+layout (constant_id = 1) const bool Textured = true;
+layout (constant_id = 2) const uint TextureTaps = 1u;
+
+struct DrawData {
+    vec4 tint;
+    // Entry of the texture table
+    uint texture;
+    uint samplerSlot;
+};
+
+const uint InvalidSlot = 0xFFFFFFFFu;
+
+layout (set = 0, binding = 0) uniform texture2D textures[];
+layout (set = 0, binding = 1) uniform sampler samplers[];
+
+layout (set = 0, binding = 2) readonly buffer DrawDataBuffer {
+    DrawData drawData[];
+} drawDataBuffers[];
+
+// Bindless slot of each streamed texture's resident levels, InvalidSlot until the first level landed
+layout (set = 0, binding = 2) readonly buffer TextureTable {
+    uint slots[];
+} textureTables[];
+
+layout (push_constant) uniform PushConstants {
+    uint drawDataSlot;
+    uint textureTableSlot;
+} pushConstants;
+
 void main() {
-    fragColor = vec4(vertColor, 1.0);
+    DrawData draw = drawDataBuffers[pushConstants.drawDataSlot].drawData[drawIndex];
+
+    vec4 color = vec4(vertColor, draw.tint.a);
+    uint textureSlot = Textured && draw.texture != InvalidSlot ? textureTables[pushConstants.textureTableSlot].slots[draw.texture] : InvalidSlot;
+    if (Textured && textureSlot != InvalidSlot) {
+        // Screen space, repeated every 64 pixels, until meshes carry texture coordinates
+        vec2 uv = gl_FragCoord.xy / 64.0;
+        vec2 pixelSize = vec2(1.0 / 64.0);
+
+        // Unrolled by the driver, the tap count is a constant
+        vec4 texel = vec4(0.0);
+        for (uint y = 0u; y < TextureTaps; ++y) {
+            for (uint x = 0u; x < TextureTaps; ++x) {
+                vec2 offset = (vec2(x, y) + 0.5) / float(TextureTaps) - 0.5;
+                texel += texture(sampler2D(textures[nonuniformEXT(textureSlot)], samplers[nonuniformEXT(draw.samplerSlot)]), uv + offset * pixelSize);
+            }
+        }
+        color *= texel / float(TextureTaps * TextureTaps);
+    }
+
+    fragColor = color;
 }
@@ -1,20 +1,41 @@
 #version 450
 
-vec2 vertices[3] = vec2[](
-    vec2( 0.0, -0.5),
-    vec2(-0.5,  0.5),
-    vec2( 0.5,  0.5)
-);
-
-vec3 vertColors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec3 inColor;
+
+// Per instance, non-instanced draws read one identity instance at firstInstance
+layout (location = 2) in vec2 inInstanceOffset;
+layout (location = 3) in float inInstanceScale;
+layout (location = 4) in uint inInstanceDrawIndex;
 
 layout (location = 0) out vec3 vertColor;
 
+// Feature switches, specialized per pipeline. Off shades with the draw's tint alone.
+layout (constant_id = 0) const bool VertexColor = true;
+layout (location = 1) flat out uint drawIndex;
+
+struct DrawData {
+    vec4 tint;
+    uint texture;
+    uint samplerSlot;
+};
+
+// Bindless set, every storage buffer of the application is an element of the array
+layout (set = 0, binding = 2) readonly buffer DrawDataBuffer {
+    DrawData drawData[];
+} drawDataBuffers[];
+
+layout (push_constant) uniform PushConstants {
+    uint drawDataSlot;
+    uint textureTableSlot;
+} pushConstants;
+
 void main(){
-    gl_Position = vec4(vertices[gl_VertexIndex], 0.0, 1.0);
-    vertColor = vertColors[gl_VertexIndex];
-}
\ No newline at end of file
+    drawIndex = inInstanceDrawIndex;
+    DrawData draw = drawDataBuffers[pushConstants.drawDataSlot].drawData[drawIndex];
+
+    gl_Position = vec4(inPosition * inInstanceScale + inInstanceOffset, 0.0, 1.0);
+    vertColor = VertexColor ? inColor * draw.tint.rgb : draw.tint.rgb;
+}
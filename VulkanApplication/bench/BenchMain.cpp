@@ -0,0 +1,293 @@
+#include "application.h"
+#include "MultiDevice.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Runs a headless scene for a fixed number of frames and reports frame time
+// percentiles, startup time and peak memory as JSON. With --baseline the
+// metrics are compared against a previous report and the exit code is 1 when
+// any of them got worse by more than the tolerance.
+
+namespace {
+
+// Instance count of the --instanced-scene benchmark
+constexpr uint32_t InstancedSceneInstanceCount = 100000;
+
+struct BenchOptions {
+    nex::ApplicationConfig config;
+    int width = 1280;
+    int height = 720;
+    uint64_t frames = 500;
+    std::string outputPath;
+    std::string baselinePath;
+    // Relative slowdown allowed before a metric counts as regressed
+    double tolerance = 0.10;
+    // Physical devices the frames are shared out between
+    uint32_t devices = 1;
+};
+
+using Metrics = std::vector<std::pair<std::string, double>>;
+
+double Percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+
+    size_t rank = std::min(samples.size() - 1, static_cast<size_t>(p / 100.0 * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+    return samples[rank];
+}
+
+double PeakRssMiB() {
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in KiB on Linux
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Frame times of every device pooled, startup of the slowest device and the memory of all of them
+nex::RunStats MergeDeviceStats(const std::vector<nex::RunStats>& deviceStats) {
+    nex::RunStats merged = deviceStats.front();
+    for (size_t i = 1; i < deviceStats.size(); ++i) {
+        const nex::RunStats& stats = deviceStats[i];
+        merged.deviceName += ", " + stats.deviceName;
+        if (stats.startupMs > merged.startupMs) {
+            merged.startupMs = stats.startupMs;
+            merged.startupPhases = stats.startupPhases;
+        }
+        merged.firstFrameMs = std::max(merged.firstFrameMs, stats.firstFrameMs);
+        merged.cpuFrameMs.insert(merged.cpuFrameMs.end(), stats.cpuFrameMs.begin(), stats.cpuFrameMs.end());
+        merged.gpuFrameMs.insert(merged.gpuFrameMs.end(), stats.gpuFrameMs.begin(), stats.gpuFrameMs.end());
+        merged.peakDeviceMemoryBytes += stats.peakDeviceMemoryBytes;
+    }
+    return merged;
+}
+
+Metrics CollectMetrics(const nex::RunStats& stats) {
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    Metrics metrics = {
+        { "startup_ms", stats.startupMs },
+        { "first_frame_ms", stats.firstFrameMs },
+        { "cpu_frame_ms_p50", Percentile(stats.cpuFrameMs, 50.0) },
+        { "cpu_frame_ms_p95", Percentile(stats.cpuFrameMs, 95.0) },
+        { "cpu_frame_ms_p99", Percentile(stats.cpuFrameMs, 99.0) },
+        { "gpu_frame_ms_p50", Percentile(stats.gpuFrameMs, 50.0) },
+        { "gpu_frame_ms_p95", Percentile(stats.gpuFrameMs, 95.0) },
+        { "gpu_frame_ms_p99", Percentile(stats.gpuFrameMs, 99.0) },
+        { "peak_device_memory_mib", stats.peakDeviceMemoryBytes / MiB },
+        { "peak_rss_mib", PeakRssMiB() },
+    };
+
+    // Skipped phases did not run, a zero would read as an improvement against the baseline
+    for (const auto& phase : stats.startupPhases) {
+        if (!phase.skipped) {
+            metrics.emplace_back("startup_" + phase.name + "_ms", phase.durationMs);
+        }
+    }
+
+    return metrics;
+}
+
+void WriteReport(std::ostream& out, const BenchOptions& options, const nex::RunStats& stats, const Metrics& metrics) {
+    const nex::SceneConfig& scene = options.config.scene;
+
+    out << "{\n";
+    out << "  \"scene\": {\n"
+        << "    \"triangles\": " << scene.triangleCount << ",\n"
+        << "    \"draws\": " << scene.drawCount << ",\n"
+        << "    \"pipelines\": " << scene.pipelineCount << ",\n"
+        << "    \"instances\": " << scene.instanceCount << ",\n"
+        << "    \"generated_texture\": " << options.config.generatedTextureSize << ",\n"
+        << "    \"width\": " << options.width << ",\n"
+        << "    \"height\": " << options.height << ",\n"
+        << "    \"frames\": " << options.frames << ",\n"
+        << "    \"warmup_frames\": " << options.config.warmupFrames << ",\n"
+        << "    \"frames_in_flight\": " << options.config.framesInFlight << ",\n"
+        << "    \"record_threads\": " << options.config.recordThreads << ",\n"
+        << "    \"gpu_driven\": " << (options.config.gpuDriven ? "true" : "false") << "\n"
+        << "  },\n";
+    out << "  \"devices\": { \"count\": " << options.devices << ", \"names\": \"" << stats.deviceName << "\" },\n";
+    out << "  \"samples\": { \"cpu_frames\": " << stats.cpuFrameMs.size() << ", \"gpu_frames\": " << stats.gpuFrameMs.size() << " },\n";
+    out << "  \"metrics\": {\n" << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        out << "    \"" << metrics[i].first << "\": " << metrics[i].second << (i + 1 < metrics.size() ? ",\n" : "\n");
+    }
+    out << "  }\n}\n" << std::defaultfloat;
+}
+
+// Reads the flat "metrics" object of a report written by WriteReport
+std::map<std::string, double> ReadBaselineMetrics(const std::string& filepath) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open baseline " + filepath);
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string json = buffer.str();
+
+    size_t pos = json.find("\"metrics\"");
+    if (pos == std::string::npos || (pos = json.find('{', pos)) == std::string::npos) {
+        throw std::runtime_error("Baseline " + filepath + " has no metrics object");
+    }
+    size_t end = json.find('}', pos);
+
+    std::map<std::string, double> metrics;
+    while (true) {
+        size_t keyBegin = json.find('"', pos);
+        if (keyBegin == std::string::npos || keyBegin > end) {
+            break;
+        }
+        size_t keyEnd = json.find('"', keyBegin + 1);
+        size_t colon = json.find(':', keyEnd);
+
+        std::string key = json.substr(keyBegin + 1, keyEnd - keyBegin - 1);
+        metrics[key] = std::stod(json.substr(colon + 1));
+
+        pos = json.find_first_of(",}", colon);
+    }
+
+    return metrics;
+}
+
+// All metrics are lower-is-better
+bool CompareWithBaseline(const Metrics& metrics, const std::map<std::string, double>& baseline, double tolerance) {
+    bool regressed = false;
+
+    std::cout << "[bench] Comparison with baseline (tolerance " << tolerance * 100.0 << "%):\n" << std::fixed << std::setprecision(3);
+    for (const auto& [name, value] : metrics) {
+        auto iter = baseline.find(name);
+        if (iter == baseline.end()) {
+            continue;
+        }
+
+        double base = iter->second;
+        double change = base > 0.0 ? (value - base) / base : 0.0;
+        bool metricRegressed = change > tolerance;
+        regressed = regressed || metricRegressed;
+
+        std::cout << "  " << std::left << std::setw(24) << name << std::right
+                  << std::setw(12) << base << " -> " << std::setw(12) << value
+                  << "  " << std::showpos << change * 100.0 << "%" << std::noshowpos
+                  << (metricRegressed ? "  REGRESSED" : "") << '\n';
+    }
+    std::cout << std::defaultfloat << std::flush;
+
+    return !regressed;
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: VulkanBench [--triangles N] [--draws N] [--pipelines N] [--width W] [--height H]\n"
+                 "                   [--frames N] [--warmup N] [--frames-in-flight N] [--record-threads N]\n"
+                 "                   [--gpu-driven] [--instances N] [--instanced-scene]\n"
+                 "                   [--generated-texture N] [--devices N]\n"
+                 "                   [--output results.json] [--baseline baseline.json] [--tolerance 0.10]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    options.config.headless = true;
+    options.config.warmupFrames = 50;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--triangles" && hasValue) {
+            options.config.scene.triangleCount = std::stoul(argv[++i]);
+        } else if (arg == "--draws" && hasValue) {
+            options.config.scene.drawCount = std::stoul(argv[++i]);
+        } else if (arg == "--pipelines" && hasValue) {
+            options.config.scene.pipelineCount = std::stoul(argv[++i]);
+        } else if (arg == "--width" && hasValue) {
+            options.width = std::stoi(argv[++i]);
+        } else if (arg == "--height" && hasValue) {
+            options.height = std::stoi(argv[++i]);
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--warmup" && hasValue) {
+            options.config.warmupFrames = std::stoull(argv[++i]);
+        } else if (arg == "--frames-in-flight" && hasValue) {
+            options.config.framesInFlight = std::stoul(argv[++i]);
+        } else if (arg == "--record-threads" && hasValue) {
+            options.config.recordThreads = std::stoul(argv[++i]);
+        } else if (arg == "--instances" && hasValue) {
+            options.config.scene.instanceCount = std::stoul(argv[++i]);
+        } else if (arg == "--instanced-scene") {
+            options.config.scene.instanceCount = InstancedSceneInstanceCount;
+        } else if (arg == "--generated-texture" && hasValue) {
+            options.config.generatedTextureSize = std::stoul(argv[++i]);
+        } else if (arg == "--gpu-driven") {
+            options.config.gpuDriven = true;
+        } else if (arg == "--devices" && hasValue) {
+            options.devices = std::stoul(argv[++i]);
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            options.tolerance = std::stod(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument \"" << arg << "\"" << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.devices == 0 || (options.devices > 1 && options.frames == 0)) {
+        std::cerr << "--devices needs at least 1 device, and --frames above 0 to share out between several" << std::endl;
+        PrintUsage();
+        return 1;
+    }
+
+    options.config.frameLimit = options.config.warmupFrames + options.frames;
+    if (options.config.framesInFlight == 0) {
+        options.config.framesInFlight = nex::PolicyFramesInFlight(options.config.presentPolicy);
+    }
+
+    nex::RunStats stats;
+    if (options.devices > 1) {
+        stats = MergeDeviceStats(nex::RunOnDevices("VulkanBench", options.width, options.height, options.config, options.devices));
+    } else {
+        nex::Application app("VulkanBench", options.width, options.height, options.config);
+        app.run();
+        stats = app.runStats();
+    }
+
+    Metrics metrics = CollectMetrics(stats);
+
+    if (options.outputPath.empty()) {
+        WriteReport(std::cout, options, stats, metrics);
+    } else {
+        std::ofstream file(options.outputPath, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << options.outputPath << std::endl;
+            return 1;
+        }
+        WriteReport(file, options, stats, metrics);
+        std::cout << "[bench] Report written to " << options.outputPath << std::endl;
+    }
+
+    if (!options.baselinePath.empty() && !CompareWithBaseline(metrics, ReadBaselineMetrics(options.baselinePath), options.tolerance)) {
+        std::cerr << "[bench] Performance regressed against " << options.baselinePath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
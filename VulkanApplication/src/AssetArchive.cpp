@@ -0,0 +1,254 @@
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+
+#include "Lz4.h"
+
+namespace nex {
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void Store(std::vector<char>& file, uint64_t offset, const T& value) {
+    std::memcpy(file.data() + offset, &value, sizeof(value));
+}
+
+} // namespace
+
+uint64_t HashAssetName(std::string_view name) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+Asset::Asset(std::shared_ptr<const MappedFile> mapping, const char* data, size_t size)
+    : m_mapping(std::move(mapping)), m_data(data), m_size(size) {}
+
+Asset::Asset(std::vector<uint64_t> decompressed, size_t size)
+    : m_storage(std::move(decompressed)), m_data(reinterpret_cast<const char*>(m_storage.data())), m_size(size) {}
+
+void AssetArchive::open(const std::string& filepath) {
+    close();
+
+    // Lookups touch a few index pages and then the entries actually read
+    auto file = std::make_shared<const MappedFile>(filepath, FileAccess::Random);
+
+    const Header* header = file->dataAs<Header>();
+    if (header->magic != Magic || header->version != Version) {
+        throw std::runtime_error("Asset archive " + filepath + " has an unknown format");
+    }
+    if (header->bucketCount == 0) {
+        throw std::runtime_error("Asset archive " + filepath + " has no buckets");
+    }
+
+    // Throw when a section is out of bounds or misaligned
+    const uint32_t* buckets = file->dataAs<uint32_t>(header->bucketsOffset, size_t(header->bucketCount) + 1);
+    const Entry* entries = file->dataAs<Entry>(header->entriesOffset, header->entryCount);
+    if (header->namesOffset > file->size()) {
+        throw std::runtime_error("Asset archive " + filepath + " is truncated");
+    }
+
+    // Validated once here, so lookups and reads can trust the index
+    if (buckets[0] != 0 || buckets[header->bucketCount] != header->entryCount) {
+        throw std::runtime_error("Asset archive " + filepath + " has a corrupt index");
+    }
+    for (uint32_t bucket = 0; bucket < header->bucketCount; ++bucket) {
+        if (buckets[bucket] > buckets[bucket + 1]) {
+            throw std::runtime_error("Asset archive " + filepath + " has a corrupt index");
+        }
+        for (uint32_t i = buckets[bucket]; i < buckets[bucket + 1]; ++i) {
+            if (BucketOf(entries[i].nameHash, header->bucketCount) != bucket) {
+                throw std::runtime_error("Asset archive " + filepath + " has a corrupt index");
+            }
+        }
+    }
+
+    uint64_t namesSize = file->size() - header->namesOffset;
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        const Entry& entry = entries[i];
+        bool valid = entry.nameOffset <= namesSize && entry.nameLength <= namesSize - entry.nameOffset
+                  && entry.dataOffset % DataAlignment == 0 && entry.dataOffset <= file->size()
+                  && entry.storedSize <= file->size() - entry.dataOffset
+                  && ((entry.compression == Compression::Lz4 && entry.size <= Lz4MaxDecompressedSize(entry.storedSize))
+                      || (entry.compression == Compression::None && entry.storedSize == entry.size));
+        if (!valid) {
+            throw std::runtime_error("Asset archive " + filepath + " has a corrupt entry");
+        }
+    }
+
+    m_file = std::move(file);
+    m_header = header;
+    m_buckets = buckets;
+    m_entries = entries;
+}
+
+void AssetArchive::close() {
+    // Assets read from the archive keep the mapping alive
+    m_file.reset();
+    m_header = nullptr;
+    m_buckets = nullptr;
+    m_entries = nullptr;
+}
+
+Asset AssetArchive::read(std::string_view name) const {
+    const Entry* entry = find(name);
+    if (entry == nullptr) {
+        throw std::runtime_error("Asset " + std::string(name) + " is not in the archive");
+    }
+
+    const char* storedData = m_file->data() + entry->dataOffset;
+    if (entry->compression == Compression::None) {
+        return Asset(m_file, storedData, entry->size);
+    }
+
+    std::vector<uint64_t> decompressed((entry->size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    try {
+        Lz4DecompressBlock(storedData, entry->storedSize, reinterpret_cast<char*>(decompressed.data()), entry->size);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Asset " + std::string(name) + " is corrupt: " + e.what());
+    }
+    return Asset(std::move(decompressed), entry->size);
+}
+
+const AssetArchive::Entry* AssetArchive::find(std::string_view name) const {
+    if (m_header == nullptr) {
+        return nullptr;
+    }
+
+    uint64_t nameHash = HashAssetName(name);
+    uint32_t bucket = BucketOf(nameHash, m_header->bucketCount);
+    for (uint32_t i = m_buckets[bucket]; i < m_buckets[bucket + 1]; ++i) {
+        if (m_entries[i].nameHash == nameHash && nameOf(m_entries[i]) == name) {
+            return &m_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+std::string_view AssetArchive::nameOf(const Entry& entry) const {
+    return std::string_view(m_file->data() + m_header->namesOffset + entry.nameOffset, entry.nameLength);
+}
+
+void AssetArchiveWriter::add(const std::string& name, const char* data, size_t size, bool compress) {
+    for (const auto& entry : m_entries) {
+        if (entry.name == name) {
+            throw std::runtime_error("Asset " + name + " is added twice");
+        }
+    }
+
+    PendingEntry entry;
+    entry.name = name;
+    entry.nameHash = HashAssetName(name);
+    entry.size = size;
+
+    if (compress && size > 0) {
+        std::vector<char> compressed = Lz4CompressBlock(data, size);
+        if (compressed.size() <= size - size / 8) {
+            entry.compression = Compression::Lz4;
+            entry.data = std::move(compressed);
+        }
+    }
+    if (entry.compression == Compression::None) {
+        entry.data.assign(data, data + size);
+    }
+
+    m_stats.entryCount += 1;
+    m_stats.compressedCount += entry.compression != Compression::None ? 1 : 0;
+    m_stats.size += entry.size;
+    m_stats.storedSize += entry.data.size();
+
+    m_entries.push_back(std::move(entry));
+}
+
+void AssetArchiveWriter::write(const std::string& filepath) const {
+    using Header = AssetArchive::Header;
+    using Entry = AssetArchive::Entry;
+
+    std::vector<size_t> order(m_entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_entries[a].nameHash < m_entries[b].nameHash;
+    });
+
+    // About one entry per bucket
+    Header header;
+    header.entryCount = static_cast<uint32_t>(m_entries.size());
+    header.bucketCount = std::max(header.entryCount, 1u);
+    header.bucketsOffset = AlignUp(sizeof(Header), 8);
+    header.entriesOffset = AlignUp(header.bucketsOffset + sizeof(uint32_t) * (header.bucketCount + 1), 8);
+    header.namesOffset = header.entriesOffset + sizeof(Entry) * header.entryCount;
+
+    std::vector<Entry> entries(m_entries.size());
+    uint64_t namesSize = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        entries[i].nameOffset = static_cast<uint32_t>(namesSize);
+        entries[i].nameLength = static_cast<uint32_t>(m_entries[order[i]].name.size());
+        namesSize += entries[i].nameLength;
+    }
+
+    uint64_t dataOffset = AlignUp(header.namesOffset + namesSize, AssetArchive::DataAlignment);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const PendingEntry& pending = m_entries[order[i]];
+        entries[i].nameHash = pending.nameHash;
+        entries[i].dataOffset = dataOffset;
+        entries[i].storedSize = pending.data.size();
+        entries[i].size = pending.size;
+        entries[i].compression = pending.compression;
+        dataOffset = AlignUp(dataOffset + pending.data.size(), AssetArchive::DataAlignment);
+    }
+
+    // Entries are sorted by hash, so each bucket starts where the previous one ends
+    std::vector<uint32_t> buckets(header.bucketCount + 1, 0);
+    for (const auto& entry : entries) {
+        ++buckets[AssetArchive::BucketOf(entry.nameHash, header.bucketCount) + 1];
+    }
+    std::partial_sum(buckets.begin(), buckets.end(), buckets.begin());
+
+    std::vector<char> file(dataOffset, 0);
+    Store(file, 0, header);
+    std::memcpy(file.data() + header.bucketsOffset, buckets.data(), sizeof(uint32_t) * buckets.size());
+    if (!entries.empty()) {
+        std::memcpy(file.data() + header.entriesOffset, entries.data(), sizeof(Entry) * entries.size());
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        const PendingEntry& pending = m_entries[order[i]];
+        std::memcpy(file.data() + header.namesOffset + entries[i].nameOffset, pending.name.data(), pending.name.size());
+        if (!pending.data.empty()) {
+            std::memcpy(file.data() + entries[i].dataOffset, pending.data.data(), pending.data.size());
+        }
+    }
+
+    std::string tmpFilepath = filepath + ".tmp";
+
+    FILE* output = std::fopen(tmpFilepath.c_str(), "wb");
+    if (!output) {
+        throw std::runtime_error("Failed to open " + tmpFilepath + " for writing");
+    }
+
+    bool written = std::fwrite(file.data(), 1, file.size(), output) == file.size();
+    written = std::fclose(output) == 0 && written;
+
+    std::error_code errorCode;
+    if (written) {
+        std::filesystem::rename(tmpFilepath, filepath, errorCode);
+    }
+
+    if (!written || errorCode) {
+        std::filesystem::remove(tmpFilepath, errorCode);
+        throw std::runtime_error("Failed to write asset archive " + filepath);
+    }
+}
+
+} // namespace nex
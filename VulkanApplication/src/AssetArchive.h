@@ -0,0 +1,187 @@
+#ifndef __VulkanApp_AssetArchive_H__
+#define __VulkanApp_AssetArchive_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace nex {
+
+// Stable across builds and platforms, the packer and the runtime must agree on it
+uint64_t HashAssetName(std::string_view name);
+
+// Contents of an asset. Stored archive entries and loose files are views of
+// their mapping, compressed entries own their decompressed bytes. Either way
+// the data starts at least 8 byte aligned.
+class Asset {
+public:
+    Asset() = default;
+    Asset(std::shared_ptr<const MappedFile> mapping, const char* data, size_t size);
+    Asset(std::vector<uint64_t> decompressed, size_t size);
+
+    // The data may point into the owned storage
+    Asset(const Asset&) = delete;
+    Asset& operator=(const Asset&) = delete;
+    Asset(Asset&&) = default;
+    Asset& operator=(Asset&&) = default;
+
+    const char* data() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    // Reads count elements of T at offset, throws when misaligned or out of bounds
+    template <typename T>
+    const T* dataAs(size_t offset = 0, size_t count = 1) const {
+        if (offset % alignof(T) != 0 || offset > m_size || count > (m_size - offset) / sizeof(T)) {
+            throw std::runtime_error("Invalid typed access to asset");
+        }
+        return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+private:
+    std::shared_ptr<const MappedFile> m_mapping;
+    std::vector<uint64_t> m_storage;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// Single file holding every asset, written at build time by the AssetPacker
+// tool. Reading it costs one open and one mapping however many assets it
+// holds.
+//
+// Layout, little endian, every section 8 byte aligned:
+//   header
+//   buckets   bucketCount + 1 entry indices, bucket b covers entries [buckets[b], buckets[b + 1])
+//   entries   sorted by name hash, so every bucket is a contiguous run
+//   names     not terminated, referenced by the entries
+//   data      every entry starts on a DataAlignment boundary
+// A name's bucket is taken from the top bits of its hash, so a lookup reads
+// one bucket of about one entry.
+class AssetArchive {
+public:
+    static constexpr uint32_t Magic = 0x4B50584E; // "NXPK"
+    static constexpr uint32_t Version = 1;
+    // Lets stored entries be used in place as SPIR-V words, vertex data and the like
+    static constexpr uint64_t DataAlignment = 64;
+
+    enum class Compression : uint32_t {
+        None = 0,
+        Lz4 = 1,
+    };
+
+    struct Header {
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        uint32_t entryCount = 0;
+        uint32_t bucketCount = 0;
+        uint64_t bucketsOffset = 0;
+        uint64_t entriesOffset = 0;
+        uint64_t namesOffset = 0;
+    };
+
+    struct Entry {
+        uint64_t nameHash = 0;
+        uint64_t dataOffset = 0;
+        // Bytes in the archive and after decompression, equal for stored entries
+        uint64_t storedSize = 0;
+        uint64_t size = 0;
+        uint32_t nameOffset = 0;
+        uint32_t nameLength = 0;
+        Compression compression = Compression::None;
+        uint32_t reserved = 0;
+    };
+
+    static uint32_t BucketOf(uint64_t nameHash, uint32_t bucketCount) {
+        // Monotonic in the hash, unlike a modulo
+        return static_cast<uint32_t>(((nameHash >> 32) * bucketCount) >> 32);
+    }
+
+    AssetArchive() = default;
+
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    // Maps the archive and validates its index, throws when it is malformed
+    void open(const std::string& filepath);
+    void close();
+
+    bool isOpen() const {
+        return m_file != nullptr;
+    }
+
+    const std::string& filepath() const {
+        return m_file->filepath();
+    }
+
+    uint32_t entryCount() const {
+        return m_header ? m_header->entryCount : 0;
+    }
+
+    bool contains(std::string_view name) const {
+        return find(name) != nullptr;
+    }
+
+    // Throws when the archive has no such entry or its data is corrupt
+    Asset read(std::string_view name) const;
+
+private:
+    const Entry* find(std::string_view name) const;
+    std::string_view nameOf(const Entry& entry) const;
+
+private:
+    std::shared_ptr<const MappedFile> m_file;
+    const Header* m_header = nullptr;
+    const uint32_t* m_buckets = nullptr;
+    const Entry* m_entries = nullptr;
+};
+
+// Builds an archive in memory and writes it out in one go
+class AssetArchiveWriter {
+public:
+    struct Stats {
+        size_t entryCount = 0;
+        size_t compressedCount = 0;
+        uint64_t size = 0;
+        uint64_t storedSize = 0;
+    };
+
+    // Compression is kept only when it saves at least an eighth of the entry.
+    // Throws on a duplicate name.
+    void add(const std::string& name, const char* data, size_t size, bool compress);
+
+    // Written next to filepath and renamed over it, so mappings of the previous archive stay valid
+    void write(const std::string& filepath) const;
+
+    const Stats& stats() const {
+        return m_stats;
+    }
+
+private:
+    using Compression = AssetArchive::Compression;
+
+    struct PendingEntry {
+        std::string name;
+        uint64_t nameHash = 0;
+        uint64_t size = 0;
+        Compression compression = Compression::None;
+        std::vector<char> data;
+    };
+
+private:
+    std::vector<PendingEntry> m_entries;
+    Stats m_stats;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_AssetArchive_H__
@@ -0,0 +1,61 @@
+#include "AssetStore.h"
+
+#include <filesystem>
+
+namespace nex {
+
+void AssetStore::init(MappedFileCache& fileCache, const std::string& archivePath, const std::string& looseRoot) {
+    m_fileCache = &fileCache;
+    m_looseRoot = looseRoot;
+
+    if (!archivePath.empty() && std::filesystem::exists(archivePath)) {
+        m_archive.open(archivePath);
+    }
+}
+
+void AssetStore::destroy() {
+    m_archive.close();
+    m_redirects.clear();
+    m_fileCache = nullptr;
+}
+
+Asset AssetStore::load(const std::string& name) const {
+    std::filesystem::path filepath(name);
+    bool redirected = false;
+    {
+        std::lock_guard<std::mutex> lock(m_redirectsMutex);
+        if (auto iter = m_redirects.find(name); iter != m_redirects.end()) {
+            filepath = iter->second;
+            redirected = true;
+        }
+    }
+
+    if (!redirected && m_archive.contains(name)) {
+        return m_archive.read(name);
+    }
+
+    if (filepath.is_relative() && !m_looseRoot.empty()) {
+        filepath = std::filesystem::path(m_looseRoot) / filepath;
+    }
+
+    std::shared_ptr<const MappedFile> file = m_fileCache->open(filepath.string());
+    const char* data = file->data();
+    size_t size = file->size();
+    return Asset(std::move(file), data, size);
+}
+
+void AssetStore::redirect(const std::string& name, const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_redirectsMutex);
+    m_redirects[name] = filepath;
+}
+
+std::string AssetStore::ExecutableDirectory() {
+    std::error_code errorCode;
+    std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", errorCode);
+    if (errorCode) {
+        return std::filesystem::current_path().string();
+    }
+    return executable.parent_path().string();
+}
+
+} // namespace nex
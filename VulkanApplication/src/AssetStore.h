@@ -0,0 +1,52 @@
+#ifndef __VulkanApp_AssetStore_H__
+#define __VulkanApp_AssetStore_H__
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "AssetArchive.h"
+#include "MappedFile.h"
+
+namespace nex {
+
+// Resolves asset names such as "assets/triangle.vert.spv". Names in the
+// archive are served from its single mapping; anything else is a loose file
+// under the root directory, so assets added during development work without
+// repacking. Relative names never depend on the working directory.
+class AssetStore {
+public:
+    AssetStore() = default;
+
+    AssetStore(const AssetStore&) = delete;
+    AssetStore& operator=(const AssetStore&) = delete;
+
+    // A missing archive falls back to loose files, a corrupt one throws
+    void init(MappedFileCache& fileCache, const std::string& archivePath, const std::string& looseRoot);
+    void destroy();
+
+    // Thread safe, throws when the asset exists neither in the archive nor on disk
+    Asset load(const std::string& name) const;
+
+    // Serves name from filepath from now on, e.g. a shader recompiled at runtime. Thread safe.
+    void redirect(const std::string& name, const std::string& filepath);
+
+    const AssetArchive& archive() const {
+        return m_archive;
+    }
+
+    // Where the build puts the archive and the loose assets
+    static std::string ExecutableDirectory();
+
+private:
+    MappedFileCache* m_fileCache = nullptr;
+    AssetArchive m_archive;
+    std::string m_looseRoot;
+
+    mutable std::mutex m_redirectsMutex;
+    std::unordered_map<std::string, std::string> m_redirects;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_AssetStore_H__
@@ -0,0 +1,286 @@
+#include "BindlessDescriptors.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nex {
+
+namespace {
+
+uint32_t BindingIndex(BindlessResource resource) {
+    return static_cast<uint32_t>(resource);
+}
+
+} // namespace
+
+bool BindlessDescriptors::DeviceSupported(VkPhysicalDevice physicalDevice) {
+    VkPhysicalDeviceProperties deviceProperties {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return vulkan12Features.descriptorIndexing
+        && vulkan12Features.runtimeDescriptorArray
+        && vulkan12Features.descriptorBindingPartiallyBound
+        && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+        && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind
+        && vulkan12Features.descriptorBindingUpdateUnusedWhilePending
+        && vulkan12Features.shaderSampledImageArrayNonUniformIndexing
+        && vulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+void BindlessDescriptors::EnableRequiredFeatures(VkPhysicalDeviceVulkan12Features& features) {
+    features.descriptorIndexing = VK_TRUE;
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    // Also covers the sampler array
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+}
+
+BindlessDescriptors::~BindlessDescriptors() {
+    destroy();
+}
+
+void BindlessDescriptors::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, const BindlessCapacity& capacity) {
+    m_vkDevice = device;
+    m_framesInFlight = std::max(framesInFlight, 1u);
+
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties {};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    m_slots[BindingIndex(BindlessResource::SampledImage)].capacity = std::min({ capacity.sampledImages,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages });
+    m_slots[BindingIndex(BindlessResource::Sampler)].capacity = std::min({ capacity.samplers,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers, vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers });
+    m_slots[BindingIndex(BindlessResource::StorageBuffer)].capacity = std::min({ capacity.storageBuffers,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+    constexpr std::array<VkDescriptorType, 3> descriptorTypes {
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    };
+
+    std::array<VkDescriptorSetLayoutBinding, 3>& bindings = m_setLayoutBindings;
+    std::array<VkDescriptorPoolSize, 3> poolSizes {};
+    std::array<VkDescriptorBindingFlags, 3> bindingFlags {};
+
+    for (uint32_t binding = 0; binding < bindings.size(); ++binding) {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorType = descriptorTypes[binding];
+        bindings[binding].descriptorCount = m_slots[binding].capacity;
+        bindings[binding].stageFlags = VK_SHADER_STAGE_ALL;
+
+        poolSizes[binding].type = descriptorTypes[binding];
+        poolSizes[binding].descriptorCount = m_slots[binding].capacity;
+
+        // Unused slots are never accessed, so they may stay unwritten, and new
+        // ones are written while earlier frames are still executing
+        bindingFlags[binding] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+                              | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo {};
+    bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCreateInfo.bindingCount = bindingFlags.size();
+    bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+    setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    setLayoutCreateInfo.bindingCount = bindings.size();
+    setLayoutCreateInfo.pBindings = bindings.data();
+
+    if (VkResult result = vkCreateDescriptorSetLayout(m_vkDevice, &setLayoutCreateInfo, nullptr, &m_setLayout); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor set layout");
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo {};
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    descriptorPoolCreateInfo.maxSets = 1;
+    descriptorPoolCreateInfo.poolSizeCount = poolSizes.size();
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
+
+    if (VkResult result = vkCreateDescriptorPool(m_vkDevice, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo {};
+    descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.descriptorPool = m_descriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &m_setLayout;
+
+    if (VkResult result = vkAllocateDescriptorSets(m_vkDevice, &descriptorSetAllocateInfo, &m_descriptorSet); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bindless descriptor set");
+    }
+}
+
+void BindlessDescriptors::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Frees the set along with the pool
+    vkDestroyDescriptorPool(m_vkDevice, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_vkDevice, m_setLayout, nullptr);
+
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_slots = {};
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessDescriptors::addSampledImage(VkImageView imageView, VkImageLayout layout) {
+    std::lock_guard lock(m_mutex);
+
+    uint32_t slot = allocateSlot(BindlessResource::SampledImage);
+    writeImage(slot, imageView, layout);
+
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addSampler(VkSampler sampler) {
+    std::lock_guard lock(m_mutex);
+
+    uint32_t slot = allocateSlot(BindlessResource::Sampler);
+
+    VkDescriptorImageInfo imageInfo {};
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = BindingIndex(BindlessResource::Sampler);
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    std::lock_guard lock(m_mutex);
+
+    uint32_t slot = allocateSlot(BindlessResource::StorageBuffer);
+
+    VkDescriptorBufferInfo bufferInfo {};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = BindingIndex(BindlessResource::StorageBuffer);
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+
+    return slot;
+}
+
+void BindlessDescriptors::release(BindlessResource resource, uint32_t slot) {
+    if (slot == InvalidSlot) {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_slots[BindingIndex(resource)].retired.push_back({ slot, m_frameCounter });
+}
+
+void BindlessDescriptors::beginFrame(uint64_t frameCounter) {
+    std::lock_guard lock(m_mutex);
+
+    m_frameCounter = frameCounter;
+
+    // A slot released during frame N may be used by frames up to N, the last of
+    // which has completed once its frame slot is waited on again
+    for (auto& slots : m_slots) {
+        auto iter = std::partition(slots.retired.begin(), slots.retired.end(), [this](const SlotArray::Retired& retired) {
+            return m_frameCounter < retired.releasedAtFrame + m_framesInFlight;
+        });
+
+        for (auto retired = iter; retired != slots.retired.end(); ++retired) {
+            slots.freeSlots.push_back(retired->slot);
+        }
+        slots.retired.erase(iter, slots.retired.end());
+    }
+}
+
+void BindlessDescriptors::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout) const {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, 0, 1, &m_descriptorSet, 0, nullptr);
+}
+
+BindlessStats BindlessDescriptors::stats() const {
+    std::lock_guard lock(m_mutex);
+
+    BindlessStats stats;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        stats.capacity[i] = m_slots[i].capacity;
+        stats.used[i] = m_slots[i].next - static_cast<uint32_t>(m_slots[i].freeSlots.size() + m_slots[i].retired.size());
+    }
+
+    return stats;
+}
+
+uint32_t BindlessDescriptors::allocateSlot(BindlessResource resource) {
+    SlotArray& slots = m_slots[BindingIndex(resource)];
+
+    if (!slots.freeSlots.empty()) {
+        uint32_t slot = slots.freeSlots.back();
+        slots.freeSlots.pop_back();
+        return slot;
+    }
+
+    if (slots.next == slots.capacity) {
+        throw std::runtime_error("Bindless descriptor array is full");
+    }
+
+    return slots.next++;
+}
+
+void BindlessDescriptors::writeImage(uint32_t slot, VkImageView imageView, VkImageLayout layout) {
+    VkDescriptorImageInfo imageInfo {};
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = layout;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = BindingIndex(BindlessResource::SampledImage);
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+}
+
+} // namespace nex
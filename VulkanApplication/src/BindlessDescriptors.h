@@ -0,0 +1,124 @@
+#ifndef __VulkanApp_BindlessDescriptors_H__
+#define __VulkanApp_BindlessDescriptors_H__
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace nex {
+
+// Descriptor arrays of the bindless set, the value is the binding number
+enum class BindlessResource : uint32_t {
+    SampledImage = 0,
+    Sampler = 1,
+    StorageBuffer = 2,
+};
+
+struct BindlessCapacity {
+    uint32_t sampledImages = 16384;
+    uint32_t samplers = 256;
+    uint32_t storageBuffers = 16384;
+};
+
+struct BindlessStats {
+    // Per BindlessResource, after clamping to the device limits
+    std::array<uint32_t, 3> capacity {};
+    std::array<uint32_t, 3> used {};
+};
+
+// One update-after-bind descriptor set holding an array per resource kind.
+// Resources are registered once and addressed by their slot in the array, which
+// shaders receive through push constants or buffers, so draws never bind or
+// allocate descriptor sets. The set is bound once per command buffer.
+//
+// Slots no pending command buffer uses may be written while the set is bound
+// in frames still executing. Slots are therefore never rewritten in place:
+// released ones are only reused once every frame slot has cycled.
+class BindlessDescriptors {
+public:
+    static constexpr uint32_t InvalidSlot = ~0u;
+    // Guaranteed by every device, shared by all pipelines using the layout
+    static constexpr uint32_t PushConstantSize = 128;
+
+    // Vulkan 1.2 with the descriptor indexing features enabled by EnableRequiredFeatures()
+    static bool DeviceSupported(VkPhysicalDevice physicalDevice);
+    static void EnableRequiredFeatures(VkPhysicalDeviceVulkan12Features& features);
+
+    BindlessDescriptors() = default;
+    ~BindlessDescriptors();
+
+    BindlessDescriptors(const BindlessDescriptors&) = delete;
+    BindlessDescriptors& operator=(const BindlessDescriptors&) = delete;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, const BindlessCapacity& capacity = {});
+    void destroy();
+
+    // Thread safe, throw when the array is full
+    uint32_t addSampledImage(VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t addSampler(VkSampler sampler);
+    uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    // The resource must stay alive until the frames recorded so far have completed
+    void release(BindlessResource resource, uint32_t slot);
+
+    // Called after waiting on the frame slot's fence, returns the slots released
+    // framesInFlight frames ago to the free lists
+    void beginFrame(uint64_t frameCounter);
+
+    void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout) const;
+
+    VkDescriptorSetLayout setLayout() const {
+        return m_setLayout;
+    }
+
+    // What the set layout was created from, for validating shaders against it
+    const std::array<VkDescriptorSetLayoutBinding, 3>& setLayoutBindings() const {
+        return m_setLayoutBindings;
+    }
+
+    // Covers every stage, so one range fits all pipelines
+    static VkPushConstantRange PushConstantRange() {
+        return { VK_SHADER_STAGE_ALL, 0, PushConstantSize };
+    }
+
+    BindlessStats stats() const;
+
+private:
+    struct SlotArray {
+        uint32_t capacity = 0;
+        // Slots below are handed out from the free list first
+        uint32_t next = 0;
+        std::vector<uint32_t> freeSlots;
+
+        struct Retired {
+            uint32_t slot = 0;
+            uint64_t releasedAtFrame = 0;
+        };
+        std::vector<Retired> retired;
+    };
+
+    uint32_t allocateSlot(BindlessResource resource);
+    void writeImage(uint32_t slot, VkImageView imageView, VkImageLayout layout);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    std::array<VkDescriptorSetLayoutBinding, 3> m_setLayoutBindings {};
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    uint32_t m_framesInFlight = 1;
+    uint64_t m_frameCounter = 0;
+
+    // Guards the slot arrays and the descriptor set, which needs external
+    // synchronization for updates from several threads
+    mutable std::mutex m_mutex;
+    std::array<SlotArray, 3> m_slots;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_BindlessDescriptors_H__
@@ -0,0 +1,102 @@
+#include "FreeListAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace nex {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void FreeListAllocator::init(VkDeviceSize size) {
+    m_size = size;
+    m_usedBytes = 0;
+    m_allocationCount = 0;
+    m_freeRegions.clear();
+    m_freeRegionsBySize.clear();
+
+    addFreeRegion(0, size);
+}
+
+std::optional<VkDeviceSize> FreeListAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    // Smallest region that still fits once the offset is aligned
+    for (auto iter = m_freeRegionsBySize.lower_bound(size); iter != m_freeRegionsBySize.end(); ++iter) {
+        VkDeviceSize regionOffset = iter->second;
+        VkDeviceSize regionSize = iter->first;
+        VkDeviceSize alignedOffset = alignUp(regionOffset, alignment);
+
+        if (alignedOffset + size > regionOffset + regionSize) {
+            continue;
+        }
+
+        removeFreeRegion(m_freeRegions.find(regionOffset));
+
+        if (alignedOffset > regionOffset) {
+            addFreeRegion(regionOffset, alignedOffset - regionOffset);
+        }
+        if (VkDeviceSize tail = regionOffset + regionSize - (alignedOffset + size); tail > 0) {
+            addFreeRegion(alignedOffset + size, tail);
+        }
+
+        m_usedBytes += size;
+        ++m_allocationCount;
+
+        return alignedOffset;
+    }
+
+    return std::nullopt;
+}
+
+void FreeListAllocator::free(VkDeviceSize offset, VkDeviceSize size) {
+    m_usedBytes -= size;
+    --m_allocationCount;
+
+    auto next = m_freeRegions.lower_bound(offset);
+
+    if (next != m_freeRegions.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            removeFreeRegion(prev);
+        }
+    }
+
+    if (next != m_freeRegions.end() && offset + size == next->first) {
+        size += next->second;
+        removeFreeRegion(next);
+    }
+
+    addFreeRegion(offset, size);
+}
+
+void FreeListAllocator::addFreeRegion(VkDeviceSize offset, VkDeviceSize size) {
+    m_freeRegions.emplace(offset, size);
+    m_freeRegionsBySize.emplace(size, offset);
+}
+
+void FreeListAllocator::removeFreeRegion(std::map<VkDeviceSize, VkDeviceSize>::iterator region) {
+    auto [first, last] = m_freeRegionsBySize.equal_range(region->second);
+    for (auto iter = first; iter != last; ++iter) {
+        if (iter->second == region->first) {
+            m_freeRegionsBySize.erase(iter);
+            break;
+        }
+    }
+    m_freeRegions.erase(region);
+}
+
+VkDeviceSize MemoryBlockSize(VkDeviceSize defaultBlockSize, VkDeviceSize heapSize) {
+    return std::min(defaultBlockSize, heapSize / 8);
+}
+
+bool NeedsDedicatedMemory(VkDeviceSize allocationSize, VkDeviceSize blockSize) {
+    return allocationSize > blockSize / 2;
+}
+
+} // namespace nex
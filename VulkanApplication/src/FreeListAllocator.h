@@ -0,0 +1,67 @@
+#ifndef __VulkanApp_FreeListAllocator_H__
+#define __VulkanApp_FreeListAllocator_H__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace nex {
+
+// Offset bookkeeping of one device memory block, without the memory behind it.
+// Allocations take the smallest free region that fits once aligned, freed
+// regions merge with their free neighbours.
+class FreeListAllocator {
+public:
+    void init(VkDeviceSize size);
+
+    // Empty when no free region fits the size at the alignment
+    std::optional<VkDeviceSize> allocate(VkDeviceSize size, VkDeviceSize alignment);
+    // Takes the offset and size of an earlier allocation
+    void free(VkDeviceSize offset, VkDeviceSize size);
+
+    VkDeviceSize size() const {
+        return m_size;
+    }
+
+    VkDeviceSize usedBytes() const {
+        return m_usedBytes;
+    }
+
+    uint32_t allocationCount() const {
+        return m_allocationCount;
+    }
+
+    uint32_t freeRegionCount() const {
+        return static_cast<uint32_t>(m_freeRegions.size());
+    }
+
+    VkDeviceSize largestFreeRegion() const {
+        return m_freeRegionsBySize.empty() ? 0 : m_freeRegionsBySize.rbegin()->first;
+    }
+
+private:
+    void addFreeRegion(VkDeviceSize offset, VkDeviceSize size);
+    void removeFreeRegion(std::map<VkDeviceSize, VkDeviceSize>::iterator region);
+
+private:
+    VkDeviceSize m_size = 0;
+    VkDeviceSize m_usedBytes = 0;
+    uint32_t m_allocationCount = 0;
+
+    // Free regions indexed both ways: by offset for coalescing, by size for best fit
+    std::map<VkDeviceSize, VkDeviceSize> m_freeRegions;
+    std::multimap<VkDeviceSize, VkDeviceSize> m_freeRegionsBySize;
+};
+
+// Size of the blocks carved out of a heap. Small heaps (e.g. 256 MiB device
+// local host visible windows) get proportionally smaller blocks.
+VkDeviceSize MemoryBlockSize(VkDeviceSize defaultBlockSize, VkDeviceSize heapSize);
+
+// Allocations above half a block get memory of their own instead of a block region
+bool NeedsDedicatedMemory(VkDeviceSize allocationSize, VkDeviceSize blockSize);
+
+} // namespace nex
+
+#endif // __VulkanApp_FreeListAllocator_H__
@@ -0,0 +1,364 @@
+#include "GpuCuller.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#define SHADER_CULL_CODE_FILE "assets/cull.comp.spv"
+#define SHADER_HIZ_CODE_FILE "assets/hiz.comp.spv"
+
+namespace nex {
+
+namespace {
+
+constexpr uint32_t CullGroupSize = 64;
+constexpr uint32_t HiZGroupSize = 8;
+
+// Matches the cull shader flags
+constexpr uint32_t OcclusionCulling = 1;
+
+// layout(constant_id) of the cull shader's specialization constants
+constexpr uint32_t CullGroupSizeConstant = 0;
+constexpr uint32_t CompactCommandsConstant = 1;
+
+// std430 element of the object buffer, matches CullObject in cull.comp
+struct ObjectData {
+    glm::vec4 boundingSphere;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t drawIndex = 0;
+    uint32_t bucket = 0;
+    uint32_t commandBase = 0;
+    uint32_t padding[3] {};
+};
+
+struct CullPushConstants {
+    VkExtent2D depthSize {};
+    uint32_t objectsSlot = 0;
+    uint32_t commandsSlot = 0;
+    uint32_t countsSlot = 0;
+    uint32_t hizSlot = 0;
+    uint32_t objectCount = 0;
+    uint32_t flags = 0;
+};
+
+struct HiZPushConstants {
+    VkExtent2D depthSize {};
+    uint32_t depthSlot = 0;
+    uint32_t samplerSlot = 0;
+    uint32_t hizSlot = 0;
+    uint32_t level = 0;
+};
+
+// Same level layout as hiz.glsl
+VkExtent2D HiZHalfSize(VkExtent2D size) {
+    return { std::max((size.width + 1) / 2, 1u), std::max((size.height + 1) / 2, 1u) };
+}
+
+void RecordMemoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                         VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+    VkMemoryBarrier memoryBarrier {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+} // namespace
+
+std::vector<std::string> GpuCuller::Shaders() {
+    return { SHADER_CULL_CODE_FILE, SHADER_HIZ_CODE_FILE };
+}
+
+GpuCuller::~GpuCuller() {
+    destroy();
+}
+
+void GpuCuller::init(VkDevice device, VkMemoryAllocator& allocator, BindlessDescriptors& bindless, PipelineRegistry& pipelineRegistry,
+                     PipelineLayoutCache& pipelineLayouts, uint32_t framesInFlight, bool drawIndirectCount) {
+    m_vkDevice = device;
+    m_allocator = &allocator;
+    m_bindless = &bindless;
+    // Both passes use the bindless set and push constants only, so this is the scene's layout
+    m_pipelineLayout = pipelineLayouts.acquire({ pipelineRegistry.reflect(SHADER_CULL_CODE_FILE).get(),
+                                                 pipelineRegistry.reflect(SHADER_HIZ_CODE_FILE).get() });
+    m_drawIndirectCount = drawIndirectCount;
+    m_frames.resize(framesInFlight);
+
+    ComputePipelineDesc cullPipelineDesc;
+    cullPipelineDesc.computeShader = SHADER_CULL_CODE_FILE;
+    // The compaction path is compiled in or out once, instead of branching per object
+    cullPipelineDesc.computePermutation.setUint(CullGroupSizeConstant, CullGroupSize).setFlag(CompactCommandsConstant, drawIndirectCount);
+    cullPipelineDesc.layout = m_pipelineLayout;
+    m_cullPipeline = pipelineRegistry.request(cullPipelineDesc);
+
+    ComputePipelineDesc hizPipelineDesc;
+    hizPipelineDesc.computeShader = SHADER_HIZ_CODE_FILE;
+    hizPipelineDesc.layout = m_pipelineLayout;
+    m_hizPipeline = pipelineRegistry.request(hizPipelineDesc);
+
+    // Only used for texelFetch, which ignores filtering
+    VkSamplerCreateInfo samplerCreateInfo {};
+    samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    if (VkResult result = vkCreateSampler(m_vkDevice, &samplerCreateInfo, nullptr, &m_depthSampler); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth sampler");
+    }
+    m_depthSamplerSlot = m_bindless->addSampler(m_depthSampler);
+}
+
+void GpuCuller::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    destroyFrameBuffers();
+
+    for (auto& retired : m_retiredBuffers) {
+        m_allocator->destroyBuffer(retired.buffer);
+    }
+    m_retiredBuffers.clear();
+
+    m_allocator->destroyBuffer(m_hiz);
+    m_allocator->destroyBuffer(m_objects);
+    vkDestroySampler(m_vkDevice, m_depthSampler, nullptr);
+
+    // The bindless set is destroyed along with its slots, nothing to release
+    m_depthSampler = VK_NULL_HANDLE;
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+void GpuCuller::setObjects(const std::vector<GpuCullObject>& objects, uint32_t bucketCount, StagingUploader& uploader) {
+    if (m_objects.buffer != VK_NULL_HANDLE) {
+        throw std::runtime_error("GpuCuller objects are set once before the first frame");
+    }
+
+    m_objectCount = static_cast<uint32_t>(objects.size());
+    m_buckets.assign(bucketCount, {});
+
+    for (const auto& object : objects) {
+        ++m_buckets[object.bucket].objectCount;
+    }
+    for (uint32_t bucket = 1; bucket < bucketCount; ++bucket) {
+        m_buckets[bucket].commandBase = m_buckets[bucket - 1].commandBase + m_buckets[bucket - 1].objectCount;
+    }
+
+    std::vector<ObjectData> objectData(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (i > 0 && objects[i].bucket < objects[i - 1].bucket) {
+            throw std::runtime_error("GpuCuller objects are not sorted by bucket");
+        }
+
+        objectData[i].boundingSphere = objects[i].boundingSphere;
+        objectData[i].firstIndex = objects[i].firstIndex;
+        objectData[i].indexCount = objects[i].indexCount;
+        objectData[i].drawIndex = objects[i].drawIndex;
+        objectData[i].bucket = objects[i].bucket;
+        objectData[i].commandBase = m_buckets[objects[i].bucket].commandBase;
+    }
+
+    VkDeviceSize objectsSize = std::max<VkDeviceSize>(sizeof(ObjectData) * objectData.size(), sizeof(ObjectData));
+    m_objects = createBuffer(objectsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (!objectData.empty()) {
+        uploader.uploadBuffer(m_objects.buffer, 0, objectData.data(), sizeof(ObjectData) * objectData.size(),
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+    m_objectsSlot = m_bindless->addStorageBuffer(m_objects.buffer);
+
+    VkDeviceSize commandsSize = std::max<VkDeviceSize>(sizeof(VkDrawIndexedIndirectCommand) * m_objectCount, sizeof(VkDrawIndexedIndirectCommand));
+    VkDeviceSize countsSize = sizeof(uint32_t) * std::max(bucketCount, 1u);
+
+    for (auto& frame : m_frames) {
+        frame.commands = createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.counts = createBuffer(countsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                                                | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.readback = createBuffer(countsSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        frame.commandsSlot = m_bindless->addStorageBuffer(frame.commands.buffer);
+        frame.countsSlot = m_bindless->addStorageBuffer(frame.counts.buffer);
+    }
+}
+
+void GpuCuller::resize(VkExtent2D extent, VkImageView depthView) {
+    // Frames in flight may still read the old pyramid and depth buffer
+    if (m_hiz.buffer != VK_NULL_HANDLE) {
+        m_retiredBuffers.push_back({ m_hiz, m_frameCounter });
+        m_hiz = {};
+    }
+    m_bindless->release(BindlessResource::StorageBuffer, m_hizSlot);
+    m_bindless->release(BindlessResource::SampledImage, m_depthSlot);
+
+    m_depthExtent = extent;
+    m_depthSlot = m_bindless->addSampledImage(depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    VkDeviceSize texelCount = 0;
+    VkExtent2D levelSize = HiZHalfSize(extent);
+    for (uint32_t level = 0; level < hizLevelCount(); ++level) {
+        texelCount += VkDeviceSize(levelSize.width) * levelSize.height;
+        levelSize = HiZHalfSize(levelSize);
+    }
+
+    m_hiz = createBuffer(sizeof(float) * texelCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_hizSlot = m_bindless->addStorageBuffer(m_hiz.buffer);
+
+    // Nothing to test occlusion against until the first frame of the new extent is rendered
+    m_hizValid = false;
+}
+
+void GpuCuller::beginFrame(uint32_t frameSlot, uint64_t frameCounter) {
+    m_currentSlot = frameSlot;
+    m_frameCounter = frameCounter;
+
+    FrameBuffers& frame = m_frames[frameSlot];
+    if (frame.pending) {
+        const uint32_t* counts = static_cast<const uint32_t*>(frame.readback.allocation.mapped);
+
+        uint32_t visibleCount = 0;
+        for (size_t bucket = 0; bucket < m_buckets.size(); ++bucket) {
+            visibleCount += counts[bucket];
+        }
+        m_visibleCount = visibleCount;
+        frame.pending = false;
+    }
+
+    auto iter = std::partition(m_retiredBuffers.begin(), m_retiredBuffers.end(), [this](const RetiredBuffer& retired) {
+        return m_frameCounter < retired.retiredAtFrame + m_frames.size();
+    });
+    for (auto retired = iter; retired != m_retiredBuffers.end(); ++retired) {
+        m_allocator->destroyBuffer(retired->buffer);
+    }
+    m_retiredBuffers.erase(iter, m_retiredBuffers.end());
+}
+
+void GpuCuller::recordCull(VkCommandBuffer commandBuffer) {
+    FrameBuffers& frame = m_frames[m_currentSlot];
+
+    // The slot's fence was waited on, so the previous frame using these buffers is done with them
+    vkCmdFillBuffer(commandBuffer, frame.counts.buffer, 0, VK_WHOLE_SIZE, 0);
+
+    // Also orders the Hi-Z writes of the previous frame before the reads below
+    RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    CullPushConstants pushConstants;
+    pushConstants.depthSize = m_depthExtent;
+    pushConstants.objectsSlot = m_objectsSlot;
+    pushConstants.commandsSlot = frame.commandsSlot;
+    pushConstants.countsSlot = frame.countsSlot;
+    pushConstants.hizSlot = m_hizSlot;
+    pushConstants.objectCount = m_objectCount;
+    pushConstants.flags = m_hizValid ? OcclusionCulling : 0;
+
+    if (m_objectCount > 0) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline.wait());
+        m_bindless->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (m_objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+    }
+
+    RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferCopy countsCopy {};
+    countsCopy.size = sizeof(uint32_t) * std::max<size_t>(m_buckets.size(), 1);
+    vkCmdCopyBuffer(commandBuffer, frame.counts.buffer, frame.readback.buffer, 1, &countsCopy);
+
+    RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    frame.pending = true;
+}
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer, const std::vector<PipelineHandle>& pipelines) {
+    FrameBuffers& frame = m_frames[m_currentSlot];
+
+    for (uint32_t bucket = 0; bucket < m_buckets.size(); ++bucket) {
+        if (m_buckets[bucket].objectCount == 0) {
+            continue;
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[bucket].wait());
+
+        VkDeviceSize commandsOffset = sizeof(VkDrawIndexedIndirectCommand) * m_buckets[bucket].commandBase;
+        if (m_drawIndirectCount) {
+            vkCmdDrawIndexedIndirectCount(commandBuffer, frame.commands.buffer, commandsOffset, frame.counts.buffer, sizeof(uint32_t) * bucket,
+                                          m_buckets[bucket].objectCount, sizeof(VkDrawIndexedIndirectCommand));
+        } else {
+            vkCmdDrawIndexedIndirect(commandBuffer, frame.commands.buffer, commandsOffset, m_buckets[bucket].objectCount,
+                                     sizeof(VkDrawIndexedIndirectCommand));
+        }
+    }
+}
+
+void GpuCuller::recordHiZ(VkCommandBuffer commandBuffer) {
+    // The cull pass of this frame read the pyramid that is about to be overwritten
+    RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_hizPipeline.wait());
+    m_bindless->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout);
+
+    HiZPushConstants pushConstants;
+    pushConstants.depthSize = m_depthExtent;
+    pushConstants.depthSlot = m_depthSlot;
+    pushConstants.samplerSlot = m_depthSamplerSlot;
+    pushConstants.hizSlot = m_hizSlot;
+
+    VkExtent2D levelSize = HiZHalfSize(m_depthExtent);
+    uint32_t levelCount = hizLevelCount();
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        // Every level reduces the one written by the previous dispatch
+        if (level > 0) {
+            RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        }
+
+        pushConstants.level = level;
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (levelSize.width + HiZGroupSize - 1) / HiZGroupSize, (levelSize.height + HiZGroupSize - 1) / HiZGroupSize, 1);
+
+        levelSize = HiZHalfSize(levelSize);
+    }
+
+    m_hizValid = true;
+}
+
+AllocatedBuffer GpuCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required) {
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    return m_allocator->createBuffer(bufferCreateInfo, required);
+}
+
+void GpuCuller::destroyFrameBuffers() {
+    for (auto& frame : m_frames) {
+        m_allocator->destroyBuffer(frame.commands);
+        m_allocator->destroyBuffer(frame.counts);
+        m_allocator->destroyBuffer(frame.readback);
+    }
+    m_frames.clear();
+}
+
+uint32_t GpuCuller::hizLevelCount() const {
+    uint32_t levelCount = 1;
+    for (VkExtent2D size = HiZHalfSize(m_depthExtent); size.width > 1 || size.height > 1; size = HiZHalfSize(size)) {
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+} // namespace nex
@@ -0,0 +1,148 @@
+#ifndef __VulkanApp_GpuCuller_H__
+#define __VulkanApp_GpuCuller_H__
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "BindlessDescriptors.h"
+#include "PipelineLayoutCache.h"
+#include "PipelineRegistry.h"
+#include "StagingUploader.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+// Object the GPU decides to draw or not, one indexed draw of the scene mesh
+struct GpuCullObject {
+    // Center in normalized device coordinates with depth in z, radius in w
+    glm::vec4 boundingSphere { 0.0f };
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    // Passed as firstInstance, the shaders find the per-draw data with it
+    uint32_t drawIndex = 0;
+    // Objects of one bucket are drawn with one pipeline and one indirect draw
+    uint32_t bucket = 0;
+};
+
+// GPU-driven scene submission. A compute pass culls every object against the
+// frustum and against a Hi-Z pyramid built from the previous frame's depth,
+// and writes the survivors as compacted indirect draw commands. The scene pass
+// then issues one vkCmdDrawIndexedIndirectCount per bucket, so the CPU cost
+// no longer depends on the number of objects.
+//
+// All buffers are addressed through the bindless set. Commands and counts are
+// per frame slot; the counts are copied back to report the visible objects.
+class GpuCuller {
+public:
+    GpuCuller() = default;
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // SPIR-V asset names of the culling and Hi-Z passes, for loading them ahead of init()
+    static std::vector<std::string> Shaders();
+
+    // Without drawIndirectCount every object keeps a command slot and culled
+    // ones are drawn with zero instances through vkCmdDrawIndexedIndirect
+    void init(VkDevice device, VkMemoryAllocator& allocator, BindlessDescriptors& bindless, PipelineRegistry& pipelineRegistry,
+              PipelineLayoutCache& pipelineLayouts, uint32_t framesInFlight, bool drawIndirectCount);
+    void destroy();
+
+    // Objects must be sorted by bucket
+    void setObjects(const std::vector<GpuCullObject>& objects, uint32_t bucketCount, StagingUploader& uploader);
+
+    // The depth view is the depth buffer of the new extent, sampled by the Hi-Z pass
+    void resize(VkExtent2D extent, VkImageView depthView);
+
+    // The slot's fence must have been waited on before
+    void beginFrame(uint32_t frameSlot, uint64_t frameCounter);
+
+    // Recorded outside a render pass before the scene pass
+    void recordCull(VkCommandBuffer commandBuffer);
+    // Recorded inside the scene pass, pipelines are indexed by bucket
+    void recordDraws(VkCommandBuffer commandBuffer, const std::vector<PipelineHandle>& pipelines);
+    // Recorded after the scene pass with the depth buffer in SHADER_READ_ONLY_OPTIMAL
+    void recordHiZ(VkCommandBuffer commandBuffer);
+
+    // Objects that passed culling in the last frame read back, if any was yet
+    std::optional<uint32_t> visibleCount() const {
+        return m_visibleCount;
+    }
+
+    uint32_t objectCount() const {
+        return m_objectCount;
+    }
+
+    bool drawIndirectCount() const {
+        return m_drawIndirectCount;
+    }
+
+private:
+    struct FrameBuffers {
+        AllocatedBuffer commands;
+        AllocatedBuffer counts;
+        // Host visible copy of counts
+        AllocatedBuffer readback;
+        uint32_t commandsSlot = BindlessDescriptors::InvalidSlot;
+        uint32_t countsSlot = BindlessDescriptors::InvalidSlot;
+        bool pending = false;
+    };
+
+    struct Bucket {
+        uint32_t commandBase = 0;
+        uint32_t objectCount = 0;
+    };
+
+    // Buffers replaced by a resize, destroyed once every frame slot has cycled
+    struct RetiredBuffer {
+        AllocatedBuffer buffer;
+        uint64_t retiredAtFrame = 0;
+    };
+
+    AllocatedBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required);
+    void destroyFrameBuffers();
+    uint32_t hizLevelCount() const;
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkMemoryAllocator* m_allocator = nullptr;
+    BindlessDescriptors* m_bindless = nullptr;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    bool m_drawIndirectCount = false;
+
+    PipelineHandle m_cullPipeline;
+    PipelineHandle m_hizPipeline;
+
+    VkSampler m_depthSampler = VK_NULL_HANDLE;
+    uint32_t m_depthSamplerSlot = BindlessDescriptors::InvalidSlot;
+
+    AllocatedBuffer m_objects;
+    uint32_t m_objectsSlot = BindlessDescriptors::InvalidSlot;
+    uint32_t m_objectCount = 0;
+    std::vector<Bucket> m_buckets;
+
+    std::vector<FrameBuffers> m_frames;
+    uint32_t m_currentSlot = 0;
+    uint64_t m_frameCounter = 0;
+
+    VkExtent2D m_depthExtent {};
+    uint32_t m_depthSlot = BindlessDescriptors::InvalidSlot;
+    AllocatedBuffer m_hiz;
+    uint32_t m_hizSlot = BindlessDescriptors::InvalidSlot;
+    // Set once the pyramid holds a frame of the current extent
+    bool m_hizValid = false;
+    std::vector<RetiredBuffer> m_retiredBuffers;
+
+    std::optional<uint32_t> m_visibleCount;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_GpuCuller_H__
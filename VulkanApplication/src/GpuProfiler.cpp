@@ -0,0 +1,168 @@
+#include "GpuProfiler.h"
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "Profiler.h"
+
+namespace nex {
+
+namespace {
+
+constexpr uint32_t InvalidScope = std::numeric_limits<uint32_t>::max();
+
+} // namespace
+
+GpuProfiler::~GpuProfiler() {
+    destroy();
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+                       uint32_t traceThreadId, uint32_t maxScopesPerFrame) {
+    m_vkDevice = device;
+    m_traceThreadId = traceThreadId;
+    m_seriesPrefix = traceThreadId == Profiler::GpuThreadId ? "gpu/" : "gpu" + std::to_string(traceThreadId - Profiler::GpuThreadId) + "/";
+
+    VkPhysicalDeviceProperties properties {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t timestampValidBits = queueFamily < queueFamilies.size() ? queueFamilies[queueFamily].timestampValidBits : 0;
+    if (timestampValidBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+        std::cerr << "[profile] Timestamps are not supported on the graphics queue, GPU timings are disabled" << std::endl;
+        return;
+    }
+
+    m_timestampPeriodNs = properties.limits.timestampPeriod;
+    m_timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+
+    m_maxScopesPerFrame = maxScopesPerFrame;
+    m_queriesPerFrame = 2 + 2 * m_maxScopesPerFrame;
+    m_frames.resize(framesInFlight);
+    m_results.resize(m_queriesPerFrame);
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = m_queriesPerFrame * framesInFlight;
+
+    if (VkResult result = vkCreateQueryPool(m_vkDevice, &queryPoolCreateInfo, nullptr, &m_queryPool); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+}
+
+void GpuProfiler::destroy() {
+    if (m_queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_vkDevice, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+    m_frames.clear();
+}
+
+std::optional<double> GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    if (!enabled()) {
+        return std::nullopt;
+    }
+
+    std::optional<double> previousFrameMs = resolve(frameSlot);
+
+    FrameQueries& frame = m_frames[frameSlot];
+    frame.scopeNames.clear();
+    frame.cpuStartUs = Profiler::Get().nowUs();
+    frame.pending = true;
+
+    m_currentSlot = frameSlot;
+    m_recording = true;
+
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, firstQuery(frameSlot), m_queriesPerFrame);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, firstQuery(frameSlot));
+
+    return previousFrameMs;
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+    if (!enabled()) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, firstQuery(m_currentSlot) + 1);
+    m_recording = false;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+    if (!enabled() || !m_recording) {
+        return InvalidScope;
+    }
+
+    FrameQueries& frame = m_frames[m_currentSlot];
+    if (frame.scopeNames.size() == m_maxScopesPerFrame) {
+        return InvalidScope;
+    }
+
+    uint32_t scope = static_cast<uint32_t>(frame.scopeNames.size());
+    frame.scopeNames.push_back(name);
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, firstQuery(m_currentSlot) + 2 + 2 * scope);
+
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (scope == InvalidScope) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, firstQuery(m_currentSlot) + 3 + 2 * scope);
+}
+
+std::optional<double> GpuProfiler::resolve(uint32_t frameSlot) {
+    FrameQueries& frame = m_frames[frameSlot];
+    if (!frame.pending) {
+        return std::nullopt;
+    }
+    frame.pending = false;
+
+    uint32_t queryCount = 2 + 2 * static_cast<uint32_t>(frame.scopeNames.size());
+
+    // No WAIT_BIT: the slot fence has signaled, so the results are there or the frame was never submitted
+    if (VkResult result = vkGetQueryPoolResults(m_vkDevice, m_queryPool, firstQuery(frameSlot), queryCount,
+                                                queryCount * sizeof(uint64_t), m_results.data(), sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT);
+        result != VK_SUCCESS) {
+        return std::nullopt;
+    }
+
+    auto ticksToUs = [this](uint64_t begin, uint64_t end) {
+        return static_cast<double>((end - begin) & m_timestampMask) * m_timestampPeriodNs / 1000.0;
+    };
+
+    Profiler& profiler = Profiler::Get();
+
+    uint64_t frameBegin = m_results[0];
+    double frameUs = ticksToUs(frameBegin, m_results[1]);
+
+    // Without calibrated timestamps the GPU frame is anchored at the CPU recording time
+    profiler.addEvent({ "gpu frame", m_traceThreadId, frame.cpuStartUs, frameUs });
+    profiler.addSample(m_seriesPrefix + "frame", frameUs / 1000.0);
+
+    for (size_t scope = 0; scope < frame.scopeNames.size(); ++scope) {
+        uint64_t scopeBegin = m_results[2 + 2 * scope];
+        uint64_t scopeEnd = m_results[3 + 2 * scope];
+
+        double startUs = frame.cpuStartUs + ticksToUs(frameBegin, scopeBegin);
+        double durationUs = ticksToUs(scopeBegin, scopeEnd);
+
+        profiler.addEvent({ frame.scopeNames[scope], m_traceThreadId, startUs, durationUs });
+        profiler.addSample(m_seriesPrefix + frame.scopeNames[scope], durationUs / 1000.0);
+    }
+
+    return frameUs / 1000.0;
+}
+
+} // namespace nex
@@ -0,0 +1,107 @@
+#ifndef __VulkanApp_GpuProfiler_H__
+#define __VulkanApp_GpuProfiler_H__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace nex {
+
+// Timestamp queries around the frame and around named passes. Every frame slot
+// owns its own query range, and a slot's results are read back the next time
+// the slot is used, after its fence has been waited on, so reading never stalls.
+// Resolved timings go to Profiler as "gpu/<name>" samples and GPU trace events.
+class GpuProfiler {
+public:
+    static constexpr uint32_t DefaultMaxScopesPerFrame = 32;
+
+    GpuProfiler() = default;
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Devices after the first report on trace threads and sample series of their own, see Profiler::GpuThreadId
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+              uint32_t traceThreadId = Profiler::GpuThreadId, uint32_t maxScopesPerFrame = DefaultMaxScopesPerFrame);
+    void destroy();
+
+    // The slot's fence must have been waited on before. Returns the GPU time of the
+    // frame previously recorded into the slot, if there was one and it was resolved.
+    std::optional<double> beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+    void endFrame(VkCommandBuffer commandBuffer);
+
+    // Returns a scope index for endScope(), name must outlive the frame
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    bool enabled() const {
+        return m_queryPool != VK_NULL_HANDLE;
+    }
+
+private:
+    struct FrameQueries {
+        std::vector<const char*> scopeNames;
+        // CPU time the frame was recorded at, GPU timestamps of the frame are placed relative to it
+        double cpuStartUs = 0.0;
+        bool pending = false;
+    };
+
+    std::optional<double> resolve(uint32_t frameSlot);
+
+    uint32_t firstQuery(uint32_t frameSlot) const {
+        return frameSlot * m_queriesPerFrame;
+    }
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+
+    double m_timestampPeriodNs = 1.0;
+    uint64_t m_timestampMask = ~0ull;
+
+    uint32_t m_traceThreadId = Profiler::GpuThreadId;
+    // "gpu/" for the first device, "gpu<n>/" for the others
+    std::string m_seriesPrefix = "gpu/";
+
+    uint32_t m_maxScopesPerFrame = 0;
+    // Frame begin/end plus a begin/end pair per scope
+    uint32_t m_queriesPerFrame = 0;
+
+    std::vector<FrameQueries> m_frames;
+    uint32_t m_currentSlot = 0;
+    bool m_recording = false;
+
+    std::vector<uint64_t> m_results;
+};
+
+// Brackets a pass with GPU timestamps for the lifetime of the object
+class ScopedGpuTimer {
+public:
+    ScopedGpuTimer(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+        : m_profiler(profiler)
+        , m_commandBuffer(commandBuffer)
+        , m_scope(profiler.beginScope(commandBuffer, name))
+    {}
+
+    ~ScopedGpuTimer() {
+        m_profiler.endScope(m_commandBuffer, m_scope);
+    }
+
+    ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+    ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+
+private:
+    GpuProfiler& m_profiler;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_scope;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_GpuProfiler_H__
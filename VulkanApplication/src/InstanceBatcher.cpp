@@ -0,0 +1,115 @@
+#include "InstanceBatcher.h"
+
+#include <stdexcept>
+
+#include "Utils.h"
+
+namespace nex {
+
+size_t InstanceBatcher::BatchKeyHasher::operator()(const BatchKey& key) const {
+    size_t seed = 0;
+    utils::HashCombine(seed, key.pipeline);
+    utils::HashCombine(seed, key.firstIndex);
+    utils::HashCombine(seed, key.indexCount);
+    return seed;
+}
+
+InstanceBatcher::~InstanceBatcher() {
+    destroy();
+}
+
+void InstanceBatcher::init(VkMemoryAllocator& allocator, uint32_t framesInFlight, uint32_t capacity) {
+    m_allocator = &allocator;
+    m_capacity = capacity;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(InstanceData) * capacity * framesInFlight;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // Read once per frame by the vertex input, device local host visible memory avoids the PCIe fetch where it exists
+    m_ring = allocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    m_pending.reserve(capacity);
+}
+
+void InstanceBatcher::destroy() {
+    if (m_allocator == nullptr) {
+        return;
+    }
+
+    m_allocator->destroyBuffer(m_ring);
+    m_allocator = nullptr;
+
+    m_batchIndices.clear();
+    m_batches.clear();
+    m_pending.clear();
+}
+
+void InstanceBatcher::begin(uint32_t frameSlot) {
+    m_currentSlot = frameSlot;
+
+    m_batchIndices.clear();
+    m_batches.clear();
+    m_pending.clear();
+}
+
+void InstanceBatcher::add(uint32_t pipeline, uint32_t firstIndex, uint32_t indexCount, const InstanceData& instance) {
+    if (m_pending.size() >= m_capacity) {
+        throw std::runtime_error("Instance ring buffer is full");
+    }
+
+    auto [it, inserted] = m_batchIndices.try_emplace(BatchKey { pipeline, firstIndex, indexCount },
+                                                      static_cast<uint32_t>(m_batches.size()));
+    if (inserted) {
+        InstanceBatch batch;
+        batch.pipeline = pipeline;
+        batch.firstIndex = firstIndex;
+        batch.indexCount = indexCount;
+        m_batches.push_back(batch);
+    }
+
+    m_batches[it->second].instanceCount++;
+    m_pending.push_back({ it->second, instance });
+}
+
+const std::vector<InstanceBatch>& InstanceBatcher::flush() {
+    uint32_t regionBase = m_currentSlot * m_capacity;
+
+    // Counting sort by batch, every batch gets a contiguous instance range
+    std::vector<uint32_t> cursors(m_batches.size());
+    uint32_t firstInstance = 0;
+    for (size_t batchIdx = 0; batchIdx < m_batches.size(); ++batchIdx) {
+        m_batches[batchIdx].firstInstance = regionBase + firstInstance;
+        cursors[batchIdx] = firstInstance;
+        firstInstance += m_batches[batchIdx].instanceCount;
+    }
+
+    InstanceData* region = static_cast<InstanceData*>(m_ring.allocation.mapped) + regionBase;
+    for (const auto& pending : m_pending) {
+        region[cursors[pending.batch]++] = pending.data;
+    }
+
+    m_allocator->flush(m_ring.allocation, sizeof(InstanceData) * regionBase, sizeof(InstanceData) * m_pending.size());
+
+    return m_batches;
+}
+
+void InstanceBatcher::record(VkCommandBuffer commandBuffer, const std::vector<PipelineHandle>& pipelines) const {
+    // firstInstance addresses the frame's region, so the stream is bound once at offset 0
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, &m_ring.buffer, &offset);
+
+    uint32_t boundPipeline = ~0u;
+    for (const auto& batch : m_batches) {
+        if (batch.pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[batch.pipeline].wait());
+            boundPipeline = batch.pipeline;
+        }
+
+        vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, 0, batch.firstInstance);
+    }
+}
+
+} // namespace nex
@@ -0,0 +1,95 @@
+#ifndef __VulkanApp_InstanceBatcher_H__
+#define __VulkanApp_InstanceBatcher_H__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.h"
+#include "PipelineRegistry.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+// Instanced draw emitted for every distinct pipeline and index range of a frame
+struct InstanceBatch {
+    uint32_t pipeline = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t firstInstance = 0;
+    uint32_t instanceCount = 0;
+};
+
+// Collects the objects of a frame as individual draws and merges the ones that
+// share pipeline and geometry into instanced draws. Instance data is written
+// to a host visible ring with one region per frame in flight, so a frame never
+// overwrites instances the GPU may still read.
+class InstanceBatcher {
+public:
+    InstanceBatcher() = default;
+    ~InstanceBatcher();
+
+    InstanceBatcher(const InstanceBatcher&) = delete;
+    InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+    // Capacity is in instances per frame
+    void init(VkMemoryAllocator& allocator, uint32_t framesInFlight, uint32_t capacity);
+    void destroy();
+
+    // The slot's fence must have been waited on before
+    void begin(uint32_t frameSlot);
+
+    // Not thread safe, throws when the frame's region is full
+    void add(uint32_t pipeline, uint32_t firstIndex, uint32_t indexCount, const InstanceData& instance);
+
+    // Writes the instances grouped by batch and returns the batches in first use order
+    const std::vector<InstanceBatch>& flush();
+
+    // Binds the frame's region as the per-instance stream and draws every batch,
+    // pipelines are indexed by InstanceBatch::pipeline
+    void record(VkCommandBuffer commandBuffer, const std::vector<PipelineHandle>& pipelines) const;
+
+    uint32_t instanceCount() const {
+        return static_cast<uint32_t>(m_pending.size());
+    }
+
+    uint32_t batchCount() const {
+        return static_cast<uint32_t>(m_batches.size());
+    }
+
+private:
+    struct BatchKey {
+        uint32_t pipeline = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+
+        bool operator==(const BatchKey& other) const {
+            return pipeline == other.pipeline && firstIndex == other.firstIndex && indexCount == other.indexCount;
+        }
+    };
+
+    struct BatchKeyHasher {
+        size_t operator()(const BatchKey& key) const;
+    };
+
+    struct PendingInstance {
+        uint32_t batch = 0;
+        InstanceData data;
+    };
+
+private:
+    VkMemoryAllocator* m_allocator = nullptr;
+    AllocatedBuffer m_ring;
+    uint32_t m_capacity = 0;
+    uint32_t m_currentSlot = 0;
+
+    std::unordered_map<BatchKey, uint32_t, BatchKeyHasher> m_batchIndices;
+    std::vector<InstanceBatch> m_batches;
+    std::vector<PendingInstance> m_pending;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_InstanceBatcher_H__
@@ -0,0 +1,164 @@
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace nex {
+
+namespace {
+
+constexpr size_t MinMatch = 4;
+// The block format requires the last 5 bytes to be literals and the last
+// match to start at least 12 bytes before the end
+constexpr size_t LastLiterals = 5;
+constexpr size_t MatchSearchLimit = 12;
+constexpr size_t MaxOffset = 65535;
+constexpr uint32_t HashBits = 12;
+
+uint32_t Read32(const char* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+uint32_t HashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+void WriteLength(std::vector<char>& dst, size_t length) {
+    while (length >= 255) {
+        dst.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    dst.push_back(static_cast<char>(length));
+}
+
+void WriteSequence(std::vector<char>& dst, const char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength > 0 ? matchLength - MinMatch : 0;
+    dst.push_back(static_cast<char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        WriteLength(dst, literalLength - 15);
+    }
+    dst.insert(dst.end(), literals, literals + literalLength);
+
+    // The last sequence has literals only
+    if (matchLength == 0) {
+        return;
+    }
+
+    dst.push_back(static_cast<char>(offset & 0xFF));
+    dst.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        WriteLength(dst, matchCode - 15);
+    }
+}
+
+} // namespace
+
+std::vector<char> Lz4CompressBlock(const char* src, size_t size) {
+    std::vector<char> dst;
+    dst.reserve(size / 2 + 16);
+
+    // Last position each hashed 4 byte sequence was seen at, plus one so zero means none
+    std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + MatchSearchLimit < size) {
+        uint32_t sequence = Read32(src + pos);
+        uint32_t& entry = table[HashSequence(sequence)];
+        size_t candidate = entry;
+        entry = static_cast<uint32_t>(pos + 1);
+
+        if (candidate == 0 || pos - (candidate - 1) > MaxOffset || Read32(src + candidate - 1) != sequence) {
+            ++pos;
+            continue;
+        }
+        --candidate;
+
+        size_t matchLength = MinMatch;
+        while (pos + matchLength < size - LastLiterals && src[candidate + matchLength] == src[pos + matchLength]) {
+            ++matchLength;
+        }
+
+        WriteSequence(dst, src + anchor, pos - anchor, pos - candidate, matchLength);
+        pos += matchLength;
+        anchor = pos;
+    }
+
+    WriteSequence(dst, src + anchor, size - anchor, 0, 0);
+    return dst;
+}
+
+size_t Lz4MaxDecompressedSize(size_t compressedSize) {
+    // A sequence of n > 0 bytes outputs at most its literals plus 19 + 255 * (n - 3 - literals) match bytes
+    return compressedSize * 255;
+}
+
+void Lz4DecompressBlock(const char* src, size_t srcSize, char* dst, size_t dstSize) {
+    size_t in = 0;
+    size_t out = 0;
+
+    auto readLength = [src, srcSize, &in](size_t length) {
+        if (length != 15) {
+            return length;
+        }
+        uint8_t byte = 255;
+        while (byte == 255) {
+            if (in >= srcSize) {
+                throw std::runtime_error("Truncated LZ4 block");
+            }
+            byte = static_cast<uint8_t>(src[in++]);
+            length += byte;
+        }
+        return length;
+    };
+
+    while (true) {
+        if (in >= srcSize) {
+            throw std::runtime_error("Truncated LZ4 block");
+        }
+        uint8_t token = static_cast<uint8_t>(src[in++]);
+
+        size_t literalLength = readLength(token >> 4);
+        if (literalLength > srcSize - in || literalLength > dstSize - out) {
+            throw std::runtime_error("LZ4 literals overrun the block");
+        }
+        std::memcpy(dst + out, src + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        if (in == srcSize) {
+            break;
+        }
+
+        if (srcSize - in < 2) {
+            throw std::runtime_error("Truncated LZ4 block");
+        }
+        size_t offset = static_cast<uint8_t>(src[in]) | (size_t(static_cast<uint8_t>(src[in + 1])) << 8);
+        in += 2;
+        if (offset == 0 || offset > out) {
+            throw std::runtime_error("LZ4 match offset out of range");
+        }
+
+        size_t matchLength = readLength(token & 0xF) + MinMatch;
+        if (matchLength > dstSize - out) {
+            throw std::runtime_error("LZ4 match overruns the output");
+        }
+
+        // Matches may overlap their own output, which repeats the last offset bytes
+        const char* match = dst + out - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            dst[out + i] = match[i];
+        }
+        out += matchLength;
+    }
+
+    if (out != dstSize) {
+        throw std::runtime_error("LZ4 block decompressed to an unexpected size");
+    }
+}
+
+} // namespace nex
@@ -0,0 +1,23 @@
+#ifndef __VulkanApp_Lz4_H__
+#define __VulkanApp_Lz4_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace nex {
+
+// Raw LZ4 blocks without the frame format, the sizes are kept by the caller.
+// The compressor is a plain greedy single-probe matcher: slower and weaker
+// than liblz4's, but its output decodes with any LZ4 block decoder.
+std::vector<char> Lz4CompressBlock(const char* src, size_t size);
+
+// Most a valid block of compressedSize bytes can decompress to. Every 255
+// bytes of a match cost at least one length byte, so this is 255 times the input.
+size_t Lz4MaxDecompressedSize(size_t compressedSize);
+
+// Throws when src is not a valid block decompressing to exactly dstSize bytes
+void Lz4DecompressBlock(const char* src, size_t srcSize, char* dst, size_t dstSize);
+
+} // namespace nex
+
+#endif // __VulkanApp_Lz4_H__
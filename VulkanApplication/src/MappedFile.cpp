@@ -0,0 +1,154 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nex {
+
+namespace {
+
+int AdviceFor(FileAccess access) {
+    switch (access) {
+    case FileAccess::Sequential:
+        return MADV_SEQUENTIAL;
+    case FileAccess::Random:
+        return MADV_RANDOM;
+    case FileAccess::Prefault:
+        return MADV_WILLNEED;
+    }
+    return MADV_NORMAL;
+}
+
+MappedFile::Version VersionOf(const struct stat& fileStat) {
+    MappedFile::Version version;
+    version.device = fileStat.st_dev;
+    version.inode = fileStat.st_ino;
+    version.size = fileStat.st_size;
+    version.modifiedNs = int64_t(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+    return version;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string& filepath, FileAccess access) : m_filepath(filepath) {
+    int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + filepath + ": " + std::strerror(errno));
+    }
+
+    struct stat fileStat {};
+    if (::fstat(fd, &fileStat) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat " + filepath + ": " + std::strerror(error));
+    }
+    m_version = VersionOf(fileStat);
+    m_size = static_cast<size_t>(fileStat.st_size);
+
+    // Zero length mappings are invalid, an empty file is an empty view
+    if (m_size > 0) {
+        int flags = MAP_PRIVATE | (access == FileAccess::Prefault ? MAP_POPULATE : 0);
+        void* mapping = ::mmap(nullptr, m_size, PROT_READ, flags, fd, 0);
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to map " + filepath + ": " + std::strerror(error));
+        }
+        m_data = static_cast<char*>(mapping);
+    }
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+
+    advise(access);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        ::munmap(m_data, m_size);
+    }
+}
+
+void MappedFile::advise(FileAccess access) const {
+    if (m_data != nullptr) {
+        // Only a hint, failing to apply it changes nothing observable
+        ::madvise(m_data, m_size, AdviceFor(access));
+    }
+}
+
+void MappedFile::evict() const {
+    if (m_data != nullptr) {
+        ::madvise(m_data, m_size, MADV_DONTNEED);
+    }
+}
+
+bool MappedFile::CurrentVersion(const std::string& filepath, Version& version) {
+    struct stat fileStat {};
+    if (::stat(filepath.c_str(), &fileStat) != 0) {
+        return false;
+    }
+
+    version = VersionOf(fileStat);
+    return true;
+}
+
+std::shared_ptr<const MappedFile> MappedFileCache::open(const std::string& filepath, FileAccess access) {
+    MappedFile::Version currentVersion;
+    bool exists = MappedFile::CurrentVersion(filepath, currentVersion);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (auto iter = m_entries.find(filepath); iter != m_entries.end()) {
+            if (exists && iter->second.file->version() == currentVersion) {
+                m_recency.splice(m_recency.begin(), m_recency, iter->second.recency);
+                ++m_hits;
+
+                std::shared_ptr<const MappedFile> file = iter->second.file;
+                file->advise(access);
+                return file;
+            }
+
+            // Changed on disk, holders of the old mapping keep the old contents
+            m_recency.erase(iter->second.recency);
+            m_entries.erase(iter);
+        }
+        ++m_misses;
+    }
+
+    // Mapped outside the lock, Prefault reads the whole file
+    auto file = std::make_shared<const MappedFile>(filepath, access);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Another thread may have mapped the same file meanwhile, keep the first one
+    if (auto iter = m_entries.find(filepath); iter != m_entries.end() && iter->second.file->version() == file->version()) {
+        return iter->second.file;
+    } else if (iter != m_entries.end()) {
+        m_recency.erase(iter->second.recency);
+        m_entries.erase(iter);
+    }
+
+    m_recency.push_front(filepath);
+    m_entries.emplace(filepath, Entry { file, m_recency.begin() });
+
+    while (m_entries.size() > m_capacity) {
+        m_entries.erase(m_recency.back());
+        m_recency.pop_back();
+    }
+
+    return file;
+}
+
+void MappedFileCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_recency.clear();
+}
+
+} // namespace nex
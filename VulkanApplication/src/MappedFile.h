@@ -0,0 +1,141 @@
+#ifndef __VulkanApp_MappedFile_H__
+#define __VulkanApp_MappedFile_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace nex {
+
+// madvise hints for how a mapping is going to be read
+enum class FileAccess {
+    // Read front to back once, aggressive readahead and early reclaim
+    Sequential,
+    // Scattered small reads, no readahead
+    Random,
+    // Read the whole file into memory before the constructor returns, for
+    // background I/O threads that keep the page faults off the workers
+    Prefault,
+};
+
+// Read-only mapping of a whole file. Pages come straight from the page cache
+// on first touch, nothing is copied and untouched ranges never become
+// resident. The mapping starts on a page boundary, so data at offsets aligned
+// for T can be read as T in place.
+//
+// Files are replaced by renaming a new file over them, which leaves existing
+// mappings intact. Truncating a mapped file in place raises SIGBUS on access.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filepath, FileAccess access = FileAccess::Sequential);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    const std::string& filepath() const {
+        return m_filepath;
+    }
+
+    // Reads count elements of T at offset, throws when misaligned or out of bounds
+    template <typename T>
+    const T* dataAs(size_t offset = 0, size_t count = 1) const {
+        if (offset % alignof(T) != 0 || offset > m_size || count > (m_size - offset) / sizeof(T)) {
+            throw std::runtime_error("Invalid typed access to mapped file " + m_filepath);
+        }
+        return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+    void advise(FileAccess access) const;
+
+    // Drops the resident pages of the mapping, e.g. once their contents were uploaded.
+    // Reading them again faults them back in from the page cache.
+    void evict() const;
+
+    // Identity of the file on disk when it was mapped, changes when it is replaced or rewritten
+    struct Version {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t size = 0;
+        int64_t modifiedNs = 0;
+
+        bool operator==(const Version& other) const {
+            return device == other.device && inode == other.inode && size == other.size && modifiedNs == other.modifiedNs;
+        }
+    };
+
+    const Version& version() const {
+        return m_version;
+    }
+
+    // Returns false when the file cannot be stat'ed
+    static bool CurrentVersion(const std::string& filepath, Version& version);
+
+private:
+    std::string m_filepath;
+    char* m_data = nullptr;
+    size_t m_size = 0;
+    Version m_version;
+};
+
+// Keeps the most recently opened files mapped, so assets opened repeatedly
+// (shared shaders, archives read entry by entry) are mapped once. A hit is
+// only served while the file on disk is unchanged.
+class MappedFileCache {
+public:
+    static constexpr size_t DefaultCapacity = 64;
+
+    explicit MappedFileCache(size_t capacity = DefaultCapacity) : m_capacity(capacity) {}
+
+    MappedFileCache(const MappedFileCache&) = delete;
+    MappedFileCache& operator=(const MappedFileCache&) = delete;
+
+    // Thread safe. An evicted file stays mapped while handles to it exist.
+    std::shared_ptr<const MappedFile> open(const std::string& filepath, FileAccess access = FileAccess::Sequential);
+
+    void clear();
+
+    uint64_t hits() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+
+    uint64_t misses() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_misses;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const MappedFile> file;
+        // Position in m_recency
+        std::list<std::string>::iterator recency;
+    };
+
+private:
+    size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    // Most recently used first
+    std::list<std::string> m_recency;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_MappedFile_H__
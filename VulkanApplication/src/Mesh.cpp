@@ -0,0 +1,99 @@
+#include "Mesh.h"
+
+#include <cstddef>
+
+namespace nex {
+
+VertexLayout Vertex::Layout() {
+    VertexLayout layout;
+
+    VkVertexInputBindingDescription binding {};
+    binding.binding = 0;
+    binding.stride = sizeof(Vertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    layout.bindings.push_back(binding);
+
+    VkVertexInputAttributeDescription position {};
+    position.location = 0;
+    position.binding = 0;
+    position.format = VK_FORMAT_R32G32_SFLOAT;
+    position.offset = offsetof(Vertex, position);
+    layout.attributes.push_back(position);
+
+    VkVertexInputAttributeDescription color {};
+    color.location = 1;
+    color.binding = 0;
+    color.format = VK_FORMAT_R32G32B32_SFLOAT;
+    color.offset = offsetof(Vertex, color);
+    layout.attributes.push_back(color);
+
+    return layout;
+}
+
+void InstanceData::AppendLayout(VertexLayout& layout) {
+    VkVertexInputBindingDescription binding {};
+    binding.binding = 1;
+    binding.stride = sizeof(InstanceData);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    layout.bindings.push_back(binding);
+
+    VkVertexInputAttributeDescription offset {};
+    offset.location = 2;
+    offset.binding = 1;
+    offset.format = VK_FORMAT_R32G32_SFLOAT;
+    offset.offset = offsetof(InstanceData, offset);
+    layout.attributes.push_back(offset);
+
+    VkVertexInputAttributeDescription scale {};
+    scale.location = 3;
+    scale.binding = 1;
+    scale.format = VK_FORMAT_R32_SFLOAT;
+    scale.offset = offsetof(InstanceData, scale);
+    layout.attributes.push_back(scale);
+
+    VkVertexInputAttributeDescription drawIndex {};
+    drawIndex.location = 4;
+    drawIndex.binding = 1;
+    drawIndex.format = VK_FORMAT_R32_UINT;
+    drawIndex.offset = offsetof(InstanceData, drawIndex);
+    layout.attributes.push_back(drawIndex);
+}
+
+void Mesh::create(VkMemoryAllocator& allocator, StagingUploader& uploader,
+                  const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    bufferCreateInfo.size = vertexBufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    m_vertexBuffer = allocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    bufferCreateInfo.size = indexBufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    m_indexBuffer = allocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    uploader.uploadBuffer(m_vertexBuffer.buffer, 0, vertices.data(), vertexBufferSize,
+                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    uploader.uploadBuffer(m_indexBuffer.buffer, 0, indices.data(), indexBufferSize,
+                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+
+    m_indexCount = static_cast<uint32_t>(indices.size());
+}
+
+void Mesh::destroy(VkMemoryAllocator& allocator) {
+    allocator.destroyBuffer(m_vertexBuffer);
+    allocator.destroyBuffer(m_indexBuffer);
+    m_indexCount = 0;
+}
+
+void Mesh::bind(VkCommandBuffer commandBuffer) const {
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer.buffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+} // namespace nex
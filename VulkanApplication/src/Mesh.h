@@ -0,0 +1,57 @@
+#ifndef __VulkanApp_Mesh_H__
+#define __VulkanApp_Mesh_H__
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "PipelineRegistry.h"
+#include "StagingUploader.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+struct Vertex {
+    glm::vec2 position;
+    glm::vec3 color;
+
+    // Binding 0, per vertex; locations match the vertex shader inputs
+    static VertexLayout Layout();
+};
+
+// Per-instance stream, placed at an offset and scale in normalized device coordinates
+struct InstanceData {
+    glm::vec2 offset { 0.0f };
+    float scale = 1.0f;
+    // Element of the per-draw storage buffer the instance reads
+    uint32_t drawIndex = 0;
+
+    // Binding 1, per instance; appended to the vertex layout
+    static void AppendLayout(VertexLayout& layout);
+};
+
+// Indexed geometry in DEVICE_LOCAL memory, filled through the staging uploader
+class Mesh {
+public:
+    void create(VkMemoryAllocator& allocator, StagingUploader& uploader,
+                const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    void destroy(VkMemoryAllocator& allocator);
+
+    void bind(VkCommandBuffer commandBuffer) const;
+
+    uint32_t indexCount() const {
+        return m_indexCount;
+    }
+
+private:
+    AllocatedBuffer m_vertexBuffer;
+    AllocatedBuffer m_indexBuffer;
+    uint32_t m_indexCount = 0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_Mesh_H__
@@ -0,0 +1,106 @@
+#include "MultiDevice.h"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "Profiler.h"
+#include "Utils.h"
+
+namespace nex {
+
+namespace {
+
+// pipeline_cache.bin becomes pipeline_cache.device1.bin, a cache only validates against one device
+std::string DevicePath(const std::string& path, uint32_t deviceIndex) {
+    if (path.empty() || deviceIndex == 0) {
+        return path;
+    }
+
+    std::string suffix = ".device" + std::to_string(deviceIndex);
+    size_t extension = path.find_last_of('.');
+    size_t directory = path.find_last_of('/');
+    if (extension == std::string::npos || (directory != std::string::npos && extension < directory)) {
+        return path + suffix;
+    }
+    return path.substr(0, extension) + suffix + path.substr(extension);
+}
+
+} // namespace
+
+std::vector<RunStats> RunOnDevices(std::string_view title, int width, int height, const ApplicationConfig& config, uint32_t deviceCount) {
+    if (!config.headless) {
+        throw std::invalid_argument("Rendering on several devices is only supported headless");
+    }
+    if (config.frameLimit == 0 || config.frameLimit <= config.warmupFrames) {
+        throw std::invalid_argument("Rendering on several devices needs a frame limit past the warmup frames");
+    }
+
+    FrameBudget frameBudget(config.frameLimit - config.warmupFrames);
+
+    // The profiler is process wide: capture for all devices, report and write the trace once they are done
+    if (!config.tracePath.empty()) {
+        Profiler::Get().setTraceCapture(true);
+    }
+
+    std::vector<RunStats> stats(deviceCount);
+    std::vector<std::exception_ptr> errors(deviceCount);
+    std::vector<std::thread> threads;
+
+    utils::Stopwatch stopwatch;
+
+    for (uint32_t deviceIndex = 0; deviceIndex < deviceCount; ++deviceIndex) {
+        ApplicationConfig deviceConfig = config;
+        deviceConfig.deviceIndex = deviceIndex;
+        deviceConfig.frameLimit = 0;
+        deviceConfig.frameBudget = &frameBudget;
+        deviceConfig.pipelineCachePath = DevicePath(config.pipelineCachePath, deviceIndex);
+        deviceConfig.tracePath.clear();
+        deviceConfig.profilerReport = false;
+
+        threads.emplace_back([&, deviceIndex, deviceConfig]() {
+            try {
+                Application app(title, width, height, deviceConfig);
+                app.run();
+                stats[deviceIndex] = app.runStats();
+            } catch (...) {
+                errors[deviceIndex] = std::current_exception();
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double wallMs = stopwatch.elapsedMs();
+
+    if (config.profilerReport) {
+        Profiler::Get().report(std::cout);
+    }
+    if (!config.tracePath.empty()) {
+        Profiler::Get().writeChromeTrace(config.tracePath);
+        std::cout << "[profile] Chrome trace of " << deviceCount << " devices written to " << config.tracePath << std::endl;
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t totalFrames = 0;
+    for (uint32_t deviceIndex = 0; deviceIndex < deviceCount; ++deviceIndex) {
+        const RunStats& deviceStats = stats[deviceIndex];
+        totalFrames += deviceStats.cpuFrameMs.size();
+        std::cout << "[devices] Device " << deviceIndex << " (" << deviceStats.deviceName << "): "
+                  << deviceStats.cpuFrameMs.size() << " frames, startup " << deviceStats.startupMs << " ms" << std::endl;
+    }
+    std::cout << "[devices] " << totalFrames << " frames on " << deviceCount << " devices in " << wallMs << " ms" << std::endl;
+
+    return stats;
+}
+
+} // namespace nex
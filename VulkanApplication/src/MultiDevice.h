@@ -0,0 +1,23 @@
+#ifndef __VulkanApp_MultiDevice_H__
+#define __VulkanApp_MultiDevice_H__
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "application.h"
+
+namespace nex {
+
+// Renders a headless run on the best deviceCount physical devices at once. Each
+// device gets an application of its own on its own thread, with its own queues,
+// memory and pipeline cache file. The measured frames of config.frameLimit are
+// shared out as the devices become ready for them, so faster devices take more.
+// The profiler report and the trace, with a GPU track per device, are written
+// once all of them have stopped. Returns the stats of every device in rank
+// order, rethrows the first failure.
+std::vector<RunStats> RunOnDevices(std::string_view title, int width, int height, const ApplicationConfig& config, uint32_t deviceCount);
+
+} // namespace nex
+
+#endif // __VulkanApp_MultiDevice_H__
@@ -0,0 +1,128 @@
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Profiler.h"
+#include "TaskScheduler.h"
+
+namespace nex {
+
+ParallelCommandRecorder::~ParallelCommandRecorder() {
+    destroy();
+}
+
+void ParallelCommandRecorder::init(VkDevice device, uint32_t queueFamily, TaskScheduler& scheduler, uint32_t framesInFlight, uint32_t workerCount) {
+    m_vkDevice = device;
+    m_scheduler = &scheduler;
+    m_workerCount = workerCount == 0 ? scheduler.threadCount() : workerCount;
+    m_pools.resize(framesInFlight * m_workerCount);
+
+    // Buffers are only ever reset together with their pool
+    VkCommandPoolCreateInfo commandPoolCreateInfo {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamily;
+
+    for (auto& pool : m_pools) {
+        if (VkResult result = vkCreateCommandPool(m_vkDevice, &commandPoolCreateInfo, nullptr, &pool.commandPool); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create worker command pool");
+        }
+    }
+}
+
+void ParallelCommandRecorder::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Destroying a pool frees its command buffers
+    for (auto& pool : m_pools) {
+        vkDestroyCommandPool(m_vkDevice, pool.commandPool, nullptr);
+    }
+    m_pools.clear();
+
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+void ParallelCommandRecorder::beginFrame(uint32_t frameSlot) {
+    m_currentSlot = frameSlot;
+
+    for (uint32_t worker = 0; worker < m_workerCount; ++worker) {
+        WorkerPool& pool = m_pools[frameSlot * m_workerCount + worker];
+
+        if (pool.usedCount > 0) {
+            vkResetCommandPool(m_vkDevice, pool.commandPool, 0);
+            pool.usedCount = 0;
+        }
+    }
+}
+
+std::vector<VkCommandBuffer> ParallelCommandRecorder::record(const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                                                             uint32_t chunkCount, const RecordFunc& recordFunc) {
+    std::vector<VkCommandBuffer> commandBuffers(chunkCount, VK_NULL_HANDLE);
+    std::vector<TaskHandle> tasks;
+    TaskCounter counter;
+
+    // Chunks are dealt round robin so each worker task sticks to its own pool;
+    // every chunk writes only its own slot of the result, which keeps the order fixed
+    uint32_t taskCount = std::min(m_workerCount, chunkCount);
+
+    for (uint32_t worker = 0; worker < taskCount; ++worker) {
+        WorkerPool& pool = m_pools[m_currentSlot * m_workerCount + worker];
+
+        tasks.push_back(m_scheduler->spawn([this, &pool, &commandBuffers, &inheritanceInfo, &recordFunc, worker, chunkCount]() {
+            ScopedCpuTimer recordTimer("recordSecondary");
+
+            VkCommandBufferBeginInfo commandBufferBeginInfo {};
+            commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            for (uint32_t chunkIdx = worker; chunkIdx < chunkCount; chunkIdx += m_workerCount) {
+                VkCommandBuffer commandBuffer = acquireCommandBuffer(pool);
+
+                if (VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo); result != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to begin secondary command buffer");
+                }
+
+                recordFunc(commandBuffer, chunkIdx);
+
+                if (VkResult result = vkEndCommandBuffer(commandBuffer); result != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to record secondary command buffer");
+                }
+
+                commandBuffers[chunkIdx] = commandBuffer;
+            }
+        }, &counter));
+    }
+
+    // Waits for every task before rethrowing, the tasks reference locals of this frame.
+    // The calling thread records chunks itself while it waits.
+    m_scheduler->wait(counter);
+    for (const auto& task : tasks) {
+        m_scheduler->wait(task);
+    }
+
+    return commandBuffers;
+}
+
+VkCommandBuffer ParallelCommandRecorder::acquireCommandBuffer(WorkerPool& pool) {
+    if (pool.usedCount == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo {};
+        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.commandPool = pool.commandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (VkResult result = vkAllocateCommandBuffers(m_vkDevice, &commandBufferAllocateInfo, &commandBuffer); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate secondary command buffer");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+
+    return pool.commandBuffers[pool.usedCount++];
+}
+
+} // namespace nex
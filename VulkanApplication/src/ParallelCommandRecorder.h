@@ -0,0 +1,65 @@
+#ifndef __VulkanApp_ParallelCommandRecorder_H__
+#define __VulkanApp_ParallelCommandRecorder_H__
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <vector>
+
+namespace nex {
+
+class TaskScheduler;
+
+// Records secondary command buffers for one render pass on the task scheduler.
+// Every (frame slot, worker) pair owns a command pool, so workers never share
+// a pool and a slot's pools are reset as a whole once its fence has signaled
+// instead of freeing buffers one by one.
+class ParallelCommandRecorder {
+public:
+    // Records chunk chunkIdx into a secondary command buffer that continues the render pass
+    using RecordFunc = std::function<void(VkCommandBuffer commandBuffer, uint32_t chunkIdx)>;
+
+    ParallelCommandRecorder() = default;
+    ~ParallelCommandRecorder();
+
+    ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+    ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+    void init(VkDevice device, uint32_t queueFamily, TaskScheduler& scheduler, uint32_t framesInFlight, uint32_t workerCount);
+    void destroy();
+
+    // Resets every pool of the slot, the slot's fence must have been waited on
+    void beginFrame(uint32_t frameSlot);
+
+    // Blocks until all chunks are recorded. The result is in chunk order, independent
+    // of which worker recorded which chunk, ready for vkCmdExecuteCommands.
+    std::vector<VkCommandBuffer> record(const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                                        uint32_t chunkCount, const RecordFunc& recordFunc);
+
+    uint32_t workerCount() const {
+        return m_workerCount;
+    }
+
+private:
+    struct WorkerPool {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        // Allocated once and reused after every pool reset
+        std::vector<VkCommandBuffer> commandBuffers;
+        size_t usedCount = 0;
+    };
+
+    VkCommandBuffer acquireCommandBuffer(WorkerPool& pool);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    TaskScheduler* m_scheduler = nullptr;
+    uint32_t m_workerCount = 0;
+
+    // Indexed [frameSlot * workerCount + worker]
+    std::vector<WorkerPool> m_pools;
+    uint32_t m_currentSlot = 0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_ParallelCommandRecorder_H__
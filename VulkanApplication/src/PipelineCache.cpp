@@ -0,0 +1,141 @@
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+namespace nex {
+
+namespace {
+
+// Layout of VkPipelineCacheHeaderVersionOne as it is stored at the start of the data
+struct PipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+} // namespace
+
+void PipelineCache::create(VkPhysicalDevice physicalDevice, VkDevice device, std::string_view filepath) {
+    m_vkDevice = device;
+    m_filepath = filepath;
+
+    vkGetPhysicalDeviceProperties(physicalDevice, &m_deviceProperties);
+
+    // Handed to the driver straight from the mapping, which is dropped once the cache is created
+    std::unique_ptr<MappedFile> initialData = loadValidData();
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo {};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = initialData ? initialData->size() : 0;
+    pipelineCacheCreateInfo.pInitialData = initialData ? initialData->data() : nullptr;
+
+    if (VkResult result = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, nullptr, &m_vkPipelineCache); result == VK_SUCCESS) {
+        m_warm = initialData != nullptr;
+        return;
+    }
+
+    // The header may be fine while the payload is not, the driver is the final judge
+    pipelineCacheCreateInfo.initialDataSize = 0;
+    pipelineCacheCreateInfo.pInitialData = nullptr;
+
+    if (VkResult result = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, nullptr, &m_vkPipelineCache); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+    m_warm = false;
+}
+
+void PipelineCache::destroy() {
+    if (m_vkPipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyPipelineCache(m_vkDevice, m_vkPipelineCache, nullptr);
+    m_vkPipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save() {
+    if (m_vkPipelineCache == VK_NULL_HANDLE || m_filepath.empty()) {
+        return;
+    }
+
+    size_t dataSize = 0;
+    vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, nullptr);
+
+    std::vector<char> data(dataSize);
+    if (VkResult result = vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, data.data()); result != VK_SUCCESS) {
+        std::cerr << "Failed to get pipeline cache data, code " << result << std::endl;
+        return;
+    }
+    data.resize(dataSize);
+
+    std::string tmpFilepath = m_filepath + ".tmp";
+
+    FILE* file = std::fopen(tmpFilepath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to open \"" << tmpFilepath << "\" for writing" << std::endl;
+        return;
+    }
+
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size()
+                && std::fflush(file) == 0
+                && fsync(fileno(file)) == 0;
+    std::fclose(file);
+
+    std::error_code errorCode;
+    if (written) {
+        std::filesystem::rename(tmpFilepath, m_filepath, errorCode);
+    }
+
+    if (!written || errorCode) {
+        std::cerr << "Failed to write pipeline cache \"" << m_filepath << "\"" << std::endl;
+        std::filesystem::remove(tmpFilepath, errorCode);
+    }
+}
+
+std::unique_ptr<MappedFile> PipelineCache::loadValidData() const {
+    if (m_filepath.empty() || !std::filesystem::exists(m_filepath)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> data;
+    try {
+        // The driver parses the whole blob
+        data = std::make_unique<MappedFile>(m_filepath, FileAccess::Sequential);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to read pipeline cache \"" << m_filepath << "\": " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    if (!headerMatchesDevice(*data)) {
+        std::cerr << "Pipeline cache \"" << m_filepath << "\" is stale or corrupt, ignoring it" << std::endl;
+        return nullptr;
+    }
+
+    return data;
+}
+
+bool PipelineCache::headerMatchesDevice(const MappedFile& data) const {
+    if (data.size() < sizeof(PipelineCacheHeader)) {
+        return false;
+    }
+
+    const PipelineCacheHeader& header = *data.dataAs<PipelineCacheHeader>();
+
+    return header.headerSize >= sizeof(PipelineCacheHeader)
+        && header.headerSize <= data.size()
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == m_deviceProperties.vendorID
+        && header.deviceID == m_deviceProperties.deviceID
+        && std::memcmp(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace nex
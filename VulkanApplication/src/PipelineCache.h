@@ -0,0 +1,52 @@
+#ifndef __VulkanApp_PipelineCache_H__
+#define __VulkanApp_PipelineCache_H__
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "MappedFile.h"
+
+namespace nex {
+
+// VkPipelineCache backed by a file on disk. The file is validated against the
+// device it was produced on and silently ignored when stale or corrupt.
+class PipelineCache {
+public:
+    PipelineCache() = default;
+
+    void create(VkPhysicalDevice physicalDevice, VkDevice device, std::string_view filepath);
+    void destroy();
+
+    // Writes the cache next to the target file and renames it over, so a crash
+    // mid-write never leaves a truncated cache behind
+    void save();
+
+public:
+    VkPipelineCache handle() const {
+        return m_vkPipelineCache;
+    }
+
+    bool warm() const {
+        return m_warm;
+    }
+
+private:
+    // Null without a usable cache file
+    std::unique_ptr<MappedFile> loadValidData() const;
+    bool headerMatchesDevice(const MappedFile& data) const;
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkPipelineCache m_vkPipelineCache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_deviceProperties {};
+
+    std::string m_filepath;
+    bool m_warm = false;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_PipelineCache_H__
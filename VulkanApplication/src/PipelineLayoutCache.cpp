@@ -0,0 +1,239 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "ShaderReflection.h"
+#include "Utils.h"
+
+namespace nex {
+
+namespace {
+
+struct MergedBinding {
+    VkDescriptorSetLayoutBinding binding {};
+    std::string name;
+};
+
+// Non-dispatchable handles are pointers on 64-bit platforms and integers elsewhere
+template <typename Handle>
+uint64_t HandleKey(Handle handle) {
+    if constexpr (std::is_pointer_v<Handle>) {
+        return reinterpret_cast<uintptr_t>(handle);
+    } else {
+        return handle;
+    }
+}
+
+std::string BindingLocation(const MergedBinding& merged, uint32_t set) {
+    return merged.name + " (set " + std::to_string(set) + ", binding " + std::to_string(merged.binding.binding) + ")";
+}
+
+} // namespace
+
+size_t PipelineLayoutCache::KeyHasher::operator()(const std::vector<uint64_t>& key) const {
+    size_t seed = 0;
+    for (uint64_t value : key) {
+        utils::HashCombine(seed, value);
+    }
+    return seed;
+}
+
+PipelineLayoutCache::~PipelineLayoutCache() {
+    destroy();
+}
+
+void PipelineLayoutCache::init(VkDevice device, std::vector<SharedDescriptorSet> sharedSets, std::optional<VkPushConstantRange> sharedPushConstants) {
+    m_vkDevice = device;
+    m_sharedSets = std::move(sharedSets);
+    m_sharedPushConstants = sharedPushConstants;
+}
+
+void PipelineLayoutCache::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    for (auto& [key, pipelineLayout] : m_pipelineLayouts) {
+        vkDestroyPipelineLayout(m_vkDevice, pipelineLayout, nullptr);
+    }
+    m_pipelineLayouts.clear();
+
+    // Shared sets are owned by whoever created them
+    for (auto& [key, setLayout] : m_setLayouts) {
+        vkDestroyDescriptorSetLayout(m_vkDevice, setLayout, nullptr);
+    }
+    m_setLayouts.clear();
+
+    m_sharedSets.clear();
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+VkPipelineLayout PipelineLayoutCache::acquire(const std::vector<const ShaderReflection*>& shaders) {
+    // Union of every stage's bindings, keyed by set and binding
+    std::map<std::pair<uint32_t, uint32_t>, MergedBinding> bindings;
+    VkShaderStageFlags pushConstantStages = 0;
+    uint32_t pushConstantSize = 0;
+    uint32_t setCount = 0;
+
+    for (const ShaderReflection* shader : shaders) {
+        for (const auto& reflected : shader->bindings) {
+            auto [iter, inserted] = bindings.try_emplace({ reflected.set, reflected.binding });
+            MergedBinding& merged = iter->second;
+
+            if (inserted) {
+                merged.binding.binding = reflected.binding;
+                merged.binding.descriptorType = reflected.type;
+                merged.binding.descriptorCount = reflected.count;
+                merged.binding.stageFlags = shader->stage;
+                merged.name = reflected.name;
+            } else {
+                if (merged.binding.descriptorType != reflected.type) {
+                    throw std::runtime_error(BindingLocation(merged, reflected.set) + " has different descriptor types in different stages");
+                }
+                uint32_t& count = merged.binding.descriptorCount;
+                count = count == 0 || reflected.count == 0 ? 0 : std::max(count, reflected.count);
+                merged.binding.stageFlags |= shader->stage;
+            }
+            setCount = std::max(setCount, reflected.set + 1);
+        }
+
+        if (shader->pushConstantSize > 0) {
+            pushConstantStages |= shader->stage;
+            pushConstantSize = std::max(pushConstantSize, shader->pushConstantSize);
+        }
+    }
+
+    for (const auto& shared : m_sharedSets) {
+        setCount = std::max(setCount, shared.set + 1);
+    }
+
+    // Shader bindings must be a subset of the shared sets they use
+    for (const auto& [key, merged] : bindings) {
+        const SharedDescriptorSet* shared = sharedSet(key.first);
+        if (shared == nullptr) {
+            if (merged.binding.descriptorCount == 0) {
+                throw std::runtime_error(BindingLocation(merged, key.first) + " is a runtime sized array outside a shared descriptor set");
+            }
+            continue;
+        }
+
+        auto sharedBinding = std::find_if(shared->bindings.begin(), shared->bindings.end(),
+                                          [&](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == key.second; });
+        if (sharedBinding == shared->bindings.end()) {
+            throw std::runtime_error(BindingLocation(merged, key.first) + " is not part of the shared descriptor set");
+        }
+        if (sharedBinding->descriptorType != merged.binding.descriptorType) {
+            throw std::runtime_error(BindingLocation(merged, key.first) + " has a different descriptor type than the shared descriptor set");
+        }
+        if (merged.binding.descriptorCount > sharedBinding->descriptorCount) {
+            throw std::runtime_error(BindingLocation(merged, key.first) + " declares " + std::to_string(merged.binding.descriptorCount)
+                                     + " descriptors, the shared descriptor set has " + std::to_string(sharedBinding->descriptorCount));
+        }
+        if ((merged.binding.stageFlags & ~sharedBinding->stageFlags) != 0) {
+            throw std::runtime_error(BindingLocation(merged, key.first) + " is used by a stage the shared descriptor set does not cover");
+        }
+    }
+
+    std::optional<VkPushConstantRange> pushConstantRange;
+    if (m_sharedPushConstants) {
+        if (pushConstantSize > m_sharedPushConstants->offset + m_sharedPushConstants->size) {
+            throw std::runtime_error("Push constant block of " + std::to_string(pushConstantSize) + " bytes exceeds the shared range of "
+                                     + std::to_string(m_sharedPushConstants->size) + " bytes");
+        }
+        if ((pushConstantStages & ~m_sharedPushConstants->stageFlags) != 0) {
+            throw std::runtime_error("Push constants are used by a stage the shared range does not cover");
+        }
+        pushConstantRange = m_sharedPushConstants;
+    } else if (pushConstantSize > 0) {
+        pushConstantRange = VkPushConstantRange { pushConstantStages, 0, pushConstantSize };
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    for (uint32_t set = 0; set < setCount; ++set) {
+        if (const SharedDescriptorSet* shared = sharedSet(set)) {
+            setLayouts.push_back(shared->layout);
+            continue;
+        }
+
+        // Sets between used ones still need a layout, an empty one
+        std::vector<VkDescriptorSetLayoutBinding> setBindings;
+        for (auto iter = bindings.lower_bound({ set, 0 }); iter != bindings.end() && iter->first.first == set; ++iter) {
+            setBindings.push_back(iter->second.binding);
+        }
+        setLayouts.push_back(setLayout(setBindings));
+    }
+
+    std::vector<uint64_t> key;
+    for (VkDescriptorSetLayout setLayout : setLayouts) {
+        key.push_back(HandleKey(setLayout));
+    }
+    if (pushConstantRange) {
+        key.push_back(pushConstantRange->stageFlags);
+        key.push_back(pushConstantRange->offset);
+        key.push_back(pushConstantRange->size);
+    }
+
+    if (auto iter = m_pipelineLayouts.find(key); iter != m_pipelineLayouts.end()) {
+        return iter->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = setLayouts.size();
+    pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantRange ? 1 : 0;
+    pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRange ? &*pushConstantRange : nullptr;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    if (VkResult result = vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create VkPipelineLayout");
+    }
+
+    m_pipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+size_t PipelineLayoutCache::layoutCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_pipelineLayouts.size();
+}
+
+const SharedDescriptorSet* PipelineLayoutCache::sharedSet(uint32_t set) const {
+    auto iter = std::find_if(m_sharedSets.begin(), m_sharedSets.end(), [set](const SharedDescriptorSet& shared) { return shared.set == set; });
+    return iter != m_sharedSets.end() ? &*iter : nullptr;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::setLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    std::vector<uint64_t> key;
+    for (const auto& binding : bindings) {
+        key.push_back(binding.binding);
+        key.push_back(binding.descriptorType);
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+    }
+
+    if (auto iter = m_setLayouts.find(key); iter != m_setLayouts.end()) {
+        return iter->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = bindings.size();
+    setLayoutCreateInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateDescriptorSetLayout(m_vkDevice, &setLayoutCreateInfo, nullptr, &setLayout); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create VkDescriptorSetLayout");
+    }
+
+    m_setLayouts.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+} // namespace nex
@@ -0,0 +1,68 @@
+#ifndef __VulkanApp_PipelineLayoutCache_H__
+#define __VulkanApp_PipelineLayoutCache_H__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace nex {
+
+struct ShaderReflection;
+
+// Descriptor set created outside the cache, like the bindless set, that every
+// layout includes at its set number
+struct SharedDescriptorSet {
+    uint32_t set = 0;
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+};
+
+// Builds pipeline layouts from the reflected interface of a pipeline's shaders.
+// Shader bindings in a shared set are validated against it; other sets get a
+// layout of exactly what the shaders declare. Set layouts and pipeline layouts
+// are deduplicated, so pipelines with the same interface share one
+// VkPipelineLayout and stay compatible for descriptor and push constant binds.
+class PipelineLayoutCache {
+public:
+    PipelineLayoutCache() = default;
+    ~PipelineLayoutCache();
+
+    PipelineLayoutCache(const PipelineLayoutCache&) = delete;
+    PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+    // With a shared push constant range every layout uses it and shader blocks must fit in it
+    void init(VkDevice device, std::vector<SharedDescriptorSet> sharedSets,
+              std::optional<VkPushConstantRange> sharedPushConstants = std::nullopt);
+    void destroy();
+
+    // Thread safe, throws when the shaders disagree with each other or with a shared set
+    VkPipelineLayout acquire(const std::vector<const ShaderReflection*>& shaders);
+
+    size_t layoutCount() const;
+
+private:
+    struct KeyHasher {
+        size_t operator()(const std::vector<uint64_t>& key) const;
+    };
+
+    const SharedDescriptorSet* sharedSet(uint32_t set) const;
+    // Called with the mutex held
+    VkDescriptorSetLayout setLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    std::vector<SharedDescriptorSet> m_sharedSets;
+    std::optional<VkPushConstantRange> m_sharedPushConstants;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::vector<uint64_t>, VkDescriptorSetLayout, KeyHasher> m_setLayouts;
+    std::unordered_map<std::vector<uint64_t>, VkPipelineLayout, KeyHasher> m_pipelineLayouts;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_PipelineLayoutCache_H__
@@ -0,0 +1,684 @@
+#include "PipelineRegistry.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "AssetStore.h"
+#include "Profiler.h"
+#include "ShaderReflection.h"
+#include "TaskScheduler.h"
+#include "Utils.h"
+
+namespace nex {
+
+namespace {
+
+bool bindingsEqual(const VkVertexInputBindingDescription& lhs, const VkVertexInputBindingDescription& rhs) {
+    return lhs.binding == rhs.binding && lhs.stride == rhs.stride && lhs.inputRate == rhs.inputRate;
+}
+
+bool attributesEqual(const VkVertexInputAttributeDescription& lhs, const VkVertexInputAttributeDescription& rhs) {
+    return lhs.location == rhs.location && lhs.binding == rhs.binding && lhs.format == rhs.format && lhs.offset == rhs.offset;
+}
+
+void validateStage(const std::string& name, const ShaderReflection& reflection, VkShaderStageFlagBits stage) {
+    if (reflection.stage != stage) {
+        throw std::runtime_error("Shader " + name + " is used for a different stage than its entry point");
+    }
+}
+
+// Constants the shader does not declare are silently ignored by the driver
+void validatePermutation(const std::string& name, const ShaderReflection& reflection, const ShaderPermutation& permutation) {
+    for (uint32_t id : permutation.constantIds()) {
+        auto declared = std::find_if(reflection.specConstants.begin(), reflection.specConstants.end(),
+                                     [id](const ReflectedSpecConstant& constant) { return constant.id == id; });
+        if (declared == reflection.specConstants.end()) {
+            throw std::runtime_error("Shader " + name + " has no specialization constant " + std::to_string(id));
+        }
+    }
+}
+
+// Strides, offsets and input rates come from the C++ vertex structs; the shader
+// decides which locations must be fed and with which numeric type. Component
+// counts may differ, missing components read as 0 or 1.
+void validateVertexInputs(const std::string& name, const ShaderReflection& reflection, const VertexLayout& layout) {
+    for (const auto& input : reflection.inputs) {
+        auto attribute = std::find_if(layout.attributes.begin(), layout.attributes.end(),
+                                      [&](const VkVertexInputAttributeDescription& attribute) { return attribute.location == input.location; });
+        if (attribute == layout.attributes.end()) {
+            throw std::runtime_error("Vertex shader " + name + " reads " + input.name + " at location " + std::to_string(input.location)
+                                     + ", which the vertex layout does not provide");
+        }
+
+        ShaderBaseType formatType = FormatBaseType(attribute->format);
+        if (formatType != ShaderBaseType::Unknown && formatType != input.baseType) {
+            throw std::runtime_error("Vertex shader " + name + " reads " + input.name + " as " + ShaderBaseTypeName(input.baseType)
+                                     + ", the vertex layout provides " + ShaderBaseTypeName(formatType));
+        }
+
+        bool bindingDescribed = std::any_of(layout.bindings.begin(), layout.bindings.end(),
+                                            [&](const VkVertexInputBindingDescription& binding) { return binding.binding == attribute->binding; });
+        if (!bindingDescribed) {
+            throw std::runtime_error("Vertex layout attribute at location " + std::to_string(input.location) + " uses undescribed binding "
+                                     + std::to_string(attribute->binding));
+        }
+    }
+}
+
+} // namespace
+
+ShaderPermutation& ShaderPermutation::setFlag(uint32_t constantId, bool enabled) {
+    return setUint(constantId, enabled ? VK_TRUE : VK_FALSE);
+}
+
+ShaderPermutation& ShaderPermutation::setUint(uint32_t constantId, uint32_t value) {
+    auto iter = std::lower_bound(m_constants.begin(), m_constants.end(), constantId,
+                                 [](const Constant& constant, uint32_t id) { return constant.id < id; });
+    if (iter != m_constants.end() && iter->id == constantId) {
+        iter->value = value;
+    } else {
+        m_constants.insert(iter, { constantId, value });
+    }
+    return *this;
+}
+
+ShaderPermutation& ShaderPermutation::setFloat(uint32_t constantId, float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return setUint(constantId, bits);
+}
+
+std::vector<uint32_t> ShaderPermutation::constantIds() const {
+    std::vector<uint32_t> ids;
+    for (const auto& constant : m_constants) {
+        ids.push_back(constant.id);
+    }
+    return ids;
+}
+
+VkSpecializationInfo ShaderPermutation::specializationInfo(std::vector<VkSpecializationMapEntry>& entries) const {
+    entries.clear();
+    for (size_t i = 0; i < m_constants.size(); ++i) {
+        entries.push_back({ m_constants[i].id, static_cast<uint32_t>(i * sizeof(Constant) + offsetof(Constant, value)), sizeof(uint32_t) });
+    }
+
+    VkSpecializationInfo specializationInfo {};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(entries.size());
+    specializationInfo.pMapEntries = entries.data();
+    specializationInfo.dataSize = m_constants.size() * sizeof(Constant);
+    specializationInfo.pData = m_constants.data();
+    return specializationInfo;
+}
+
+bool ShaderPermutation::operator==(const ShaderPermutation& other) const {
+    return std::equal(m_constants.begin(), m_constants.end(), other.m_constants.begin(), other.m_constants.end(),
+                      [](const Constant& lhs, const Constant& rhs) { return lhs.id == rhs.id && lhs.value == rhs.value; });
+}
+
+size_t ShaderPermutation::hash() const {
+    size_t seed = 0;
+    for (const auto& constant : m_constants) {
+        utils::HashCombine(seed, constant.id);
+        utils::HashCombine(seed, constant.value);
+    }
+    return seed;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), bindingsEqual)
+        && std::equal(attributes.begin(), attributes.end(), other.attributes.begin(), other.attributes.end(), attributesEqual);
+}
+
+bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const {
+    return vertexShader == other.vertexShader
+        && fragmentShader == other.fragmentShader
+        && vertexPermutation == other.vertexPermutation
+        && fragmentPermutation == other.fragmentPermutation
+        && vertexLayout == other.vertexLayout
+        && topology == other.topology
+        && polygonMode == other.polygonMode
+        && cullMode == other.cullMode
+        && frontFace == other.frontFace
+        && blendEnable == other.blendEnable
+        && srcColorBlendFactor == other.srcColorBlendFactor
+        && dstColorBlendFactor == other.dstColorBlendFactor
+        && srcAlphaBlendFactor == other.srcAlphaBlendFactor
+        && dstAlphaBlendFactor == other.dstAlphaBlendFactor
+        && depthTest == other.depthTest
+        && depthWrite == other.depthWrite
+        && depthCompareOp == other.depthCompareOp
+        && layout == other.layout
+        && renderPass == other.renderPass
+        && subpass == other.subpass;
+}
+
+size_t GraphicsPipelineDesc::hash() const {
+    size_t seed = 0;
+
+    utils::HashCombine(seed, vertexShader);
+    utils::HashCombine(seed, fragmentShader);
+    utils::HashCombine(seed, vertexPermutation.hash());
+    utils::HashCombine(seed, fragmentPermutation.hash());
+
+    for (const auto& binding : vertexLayout.bindings) {
+        utils::HashCombine(seed, binding.binding);
+        utils::HashCombine(seed, binding.stride);
+        utils::HashCombine(seed, static_cast<int>(binding.inputRate));
+    }
+    for (const auto& attribute : vertexLayout.attributes) {
+        utils::HashCombine(seed, attribute.location);
+        utils::HashCombine(seed, attribute.binding);
+        utils::HashCombine(seed, static_cast<int>(attribute.format));
+        utils::HashCombine(seed, attribute.offset);
+    }
+
+    utils::HashCombine(seed, static_cast<int>(topology));
+    utils::HashCombine(seed, static_cast<int>(polygonMode));
+    utils::HashCombine(seed, cullMode);
+    utils::HashCombine(seed, static_cast<int>(frontFace));
+    utils::HashCombine(seed, blendEnable);
+    utils::HashCombine(seed, static_cast<int>(srcColorBlendFactor));
+    utils::HashCombine(seed, static_cast<int>(dstColorBlendFactor));
+    utils::HashCombine(seed, static_cast<int>(srcAlphaBlendFactor));
+    utils::HashCombine(seed, static_cast<int>(dstAlphaBlendFactor));
+    utils::HashCombine(seed, depthTest);
+    utils::HashCombine(seed, depthWrite);
+    utils::HashCombine(seed, static_cast<int>(depthCompareOp));
+    utils::HashCombine(seed, layout);
+    utils::HashCombine(seed, renderPass);
+    utils::HashCombine(seed, subpass);
+
+    return seed;
+}
+
+bool ComputePipelineDesc::operator==(const ComputePipelineDesc& other) const {
+    return computeShader == other.computeShader
+        && computePermutation == other.computePermutation
+        && layout == other.layout;
+}
+
+size_t ComputePipelineDesc::hash() const {
+    size_t seed = 0;
+
+    utils::HashCombine(seed, computeShader);
+    utils::HashCombine(seed, computePermutation.hash());
+    utils::HashCombine(seed, layout);
+
+    return seed;
+}
+
+PipelineRegistry::~PipelineRegistry() {
+    destroy();
+}
+
+void PipelineRegistry::init(TaskScheduler& scheduler, const AssetStore& assets) {
+    m_scheduler = &scheduler;
+    m_assets = &assets;
+}
+
+void PipelineRegistry::attachDevice(VkDevice device, VkPipelineCache pipelineCache) {
+    m_vkDevice = device;
+    m_vkPipelineCache = pipelineCache;
+}
+
+void PipelineRegistry::destroy() {
+    if (m_scheduler == nullptr) {
+        return;
+    }
+
+    // Nothing but shader code exists before the device is attached
+    if (m_vkDevice != VK_NULL_HANDLE) {
+        auto destroyPipeline = [this](const PipelineHandle& handle) {
+            try {
+                vkDestroyPipeline(m_vkDevice, handle.wait(), nullptr);
+            } catch (const std::exception&) {
+                // Failed compilations have nothing to destroy
+            }
+        };
+
+        for (auto& [desc, handle] : m_pipelines) {
+            destroyPipeline(handle);
+        }
+        m_pipelines.clear();
+
+        for (auto& [desc, handle] : m_computePipelines) {
+            destroyPipeline(handle);
+        }
+        m_computePipelines.clear();
+
+        for (const auto& reload : m_pendingReloads) {
+            try {
+                vkDestroyPipeline(m_vkDevice, reload.rebuilt.get(), nullptr);
+            } catch (const std::exception&) {
+            }
+        }
+        m_pendingReloads.clear();
+
+        for (const auto& retired : m_retiredPipelines) {
+            vkDestroyPipeline(m_vkDevice, retired.pipeline, nullptr);
+        }
+        m_retiredPipelines.clear();
+
+        for (auto& [name, shader] : m_shaders) {
+            m_retiredShaders.push_back(shader);
+        }
+        m_shaders.clear();
+
+        for (const auto& shader : m_retiredShaders) {
+            try {
+                vkDestroyShaderModule(m_vkDevice, shader.get().module, nullptr);
+            } catch (const std::exception&) {
+            }
+        }
+        m_retiredShaders.clear();
+    }
+
+    m_shaderCode.clear();
+    m_vkDevice = VK_NULL_HANDLE;
+    m_scheduler = nullptr;
+}
+
+PipelineHandle PipelineRegistry::request(const GraphicsPipelineDesc& desc) {
+    return request(desc, m_pipelines);
+}
+
+PipelineHandle PipelineRegistry::request(const ComputePipelineDesc& desc) {
+    return request(desc, m_computePipelines);
+}
+
+template <typename Desc>
+PipelineHandle PipelineRegistry::request(const Desc& desc, std::unordered_map<Desc, PipelineHandle, PipelineDescHasher>& pipelines) {
+    std::lock_guard lock(m_mutex);
+
+    if (m_stats.requested == 0) {
+        m_firstRequestTime = std::chrono::steady_clock::now();
+    }
+    ++m_stats.requested;
+
+    if (auto iter = pipelines.find(desc); iter != pipelines.end()) {
+        ++m_stats.deduplicated;
+        return iter->second;
+    }
+
+    PipelineHandle handle(m_scheduler->submit([this, desc]() { return compile(desc); }).share());
+    pipelines.emplace(desc, handle);
+
+    return handle;
+}
+
+std::shared_ptr<const ShaderReflection> PipelineRegistry::reflect(const std::string& name) {
+    return loadShaderCode(name).reflection;
+}
+
+void PipelineRegistry::waitAll() {
+    std::vector<PipelineHandle> handles;
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto& [desc, handle] : m_pipelines) {
+            handles.push_back(handle);
+        }
+        for (const auto& [desc, handle] : m_computePipelines) {
+            handles.push_back(handle);
+        }
+    }
+
+    for (const auto& handle : handles) {
+        handle.wait();
+    }
+}
+
+size_t PipelineRegistry::reloadShaders(const std::vector<std::string>& names) {
+    std::lock_guard lock(m_mutex);
+
+    for (const auto& name : names) {
+        m_shaderCode.erase(name);
+        if (auto iter = m_shaders.find(name); iter != m_shaders.end()) {
+            m_retiredShaders.push_back(iter->second);
+            m_shaders.erase(iter);
+        }
+    }
+
+    auto usesReloaded = [&names](const std::string& shader) {
+        return std::find(names.begin(), names.end(), shader) != names.end();
+    };
+
+    auto rebuild = [this](const auto& desc, const PipelineHandle& handle) {
+        for (auto& reload : m_pendingReloads) {
+            if (reload.handle.m_future == handle.m_future) {
+                reload.superseded = true;
+            }
+        }
+
+        // Goes through the pipeline cache like the first build
+        PendingReload reload;
+        reload.handle = handle;
+        reload.rebuilt = m_scheduler->submit([this, desc]() { return compile(desc); }).share();
+        m_pendingReloads.push_back(std::move(reload));
+    };
+
+    size_t rebuilding = 0;
+    for (const auto& [desc, handle] : m_pipelines) {
+        if (usesReloaded(desc.vertexShader) || usesReloaded(desc.fragmentShader)) {
+            rebuild(desc, handle);
+            ++rebuilding;
+        }
+    }
+    for (const auto& [desc, handle] : m_computePipelines) {
+        if (usesReloaded(desc.computeShader)) {
+            rebuild(desc, handle);
+            ++rebuilding;
+        }
+    }
+
+    return rebuilding;
+}
+
+size_t PipelineRegistry::swapReloaded(uint64_t frameCounter, uint32_t framesInFlight) {
+    std::lock_guard lock(m_mutex);
+
+    auto retiredEnd = std::remove_if(m_retiredPipelines.begin(), m_retiredPipelines.end(), [&](const RetiredPipeline& retired) {
+        if (frameCounter < retired.retiredAtFrame + framesInFlight) {
+            return false;
+        }
+        vkDestroyPipeline(m_vkDevice, retired.pipeline, nullptr);
+        return true;
+    });
+    m_retiredPipelines.erase(retiredEnd, m_retiredPipelines.end());
+
+    size_t swapped = 0;
+    auto pendingEnd = std::remove_if(m_pendingReloads.begin(), m_pendingReloads.end(), [&](PendingReload& reload) {
+        // The previous pipeline is only retired once its own compilation is done
+        if (reload.rebuilt.wait_for(std::chrono::seconds(0)) != std::future_status::ready || !reload.handle.ready()) {
+            return false;
+        }
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = reload.rebuilt.get();
+        } catch (const std::exception& e) {
+            std::cerr << "[reload] Failed to rebuild a pipeline, keeping the previous one: " << e.what() << std::endl;
+            return true;
+        }
+
+        // Never bound, so it can go right away
+        if (reload.superseded) {
+            vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+            return true;
+        }
+
+        try {
+            m_retiredPipelines.push_back({ reload.handle.wait(), frameCounter });
+        } catch (const std::exception&) {
+            // The previous build had failed, there is nothing to retire
+        }
+        *reload.handle.m_future = reload.rebuilt;
+        ++swapped;
+        return true;
+    });
+    m_pendingReloads.erase(pendingEnd, m_pendingReloads.end());
+
+    return swapped;
+}
+
+PipelineRegistryStats PipelineRegistry::stats() {
+    std::lock_guard lock(m_mutex);
+
+    PipelineRegistryStats stats = m_stats;
+    if (stats.compiled > 0) {
+        stats.wallMs = std::chrono::duration<double, std::milli>(m_lastCompiledTime - m_firstRequestTime).count();
+    }
+
+    return stats;
+}
+
+VkPipeline PipelineRegistry::compile(const GraphicsPipelineDesc& desc) {
+    ScopedCpuTimer compileTimer("compilePipeline");
+    utils::Stopwatch stopwatch;
+
+    VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo {};
+    vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageCreateInfo.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageCreateInfo.pName = "main";
+    const LoadedShader& vertexShader = loadShader(desc.vertexShader);
+    validateStage(desc.vertexShader, *vertexShader.reflection, VK_SHADER_STAGE_VERTEX_BIT);
+    validatePermutation(desc.vertexShader, *vertexShader.reflection, desc.vertexPermutation);
+    validateVertexInputs(desc.vertexShader, *vertexShader.reflection, desc.vertexLayout);
+    vertShaderStageCreateInfo.module = vertexShader.module;
+
+    std::vector<VkSpecializationMapEntry> vertSpecializationEntries;
+    VkSpecializationInfo vertSpecializationInfo = desc.vertexPermutation.specializationInfo(vertSpecializationEntries);
+    if (!desc.vertexPermutation.empty()) {
+        vertShaderStageCreateInfo.pSpecializationInfo = &vertSpecializationInfo;
+    }
+
+    VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo {};
+    fragShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageCreateInfo.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageCreateInfo.pName = "main";
+    const LoadedShader& fragmentShader = loadShader(desc.fragmentShader);
+    validateStage(desc.fragmentShader, *fragmentShader.reflection, VK_SHADER_STAGE_FRAGMENT_BIT);
+    validatePermutation(desc.fragmentShader, *fragmentShader.reflection, desc.fragmentPermutation);
+    fragShaderStageCreateInfo.module = fragmentShader.module;
+
+    std::vector<VkSpecializationMapEntry> fragSpecializationEntries;
+    VkSpecializationInfo fragSpecializationInfo = desc.fragmentPermutation.specializationInfo(fragSpecializationEntries);
+    if (!desc.fragmentPermutation.empty()) {
+        fragShaderStageCreateInfo.pSpecializationInfo = &fragSpecializationInfo;
+    }
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStageCreateInfos { vertShaderStageCreateInfo, fragShaderStageCreateInfo };
+
+    std::array<VkDynamicState, 2> dynamicStates = {
+        VkDynamicState::VK_DYNAMIC_STATE_VIEWPORT,
+        VkDynamicState::VK_DYNAMIC_STATE_SCISSOR,
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo {};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo {};
+    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount = desc.vertexLayout.bindings.size();
+    vertexInputStateCreateInfo.pVertexBindingDescriptions = desc.vertexLayout.bindings.data();
+    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = desc.vertexLayout.attributes.size();
+    vertexInputStateCreateInfo.pVertexAttributeDescriptions = desc.vertexLayout.attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo {};
+    inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyCreateInfo.topology = desc.topology;
+    inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportStateCreateInfo {};
+    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCreateInfo.viewportCount = 1;
+    viewportStateCreateInfo.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo {};
+    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
+    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+    rasterizationStateCreateInfo.polygonMode = desc.polygonMode;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+    rasterizationStateCreateInfo.cullMode = desc.cullMode;
+    rasterizationStateCreateInfo.frontFace = desc.frontFace;
+    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
+    rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
+    rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
+    rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisableStateCreateInfo {};
+    multisableStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisableStateCreateInfo.sampleShadingEnable = VK_FALSE;
+    multisableStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisableStateCreateInfo.minSampleShading = 1.0f;
+    multisableStateCreateInfo.pSampleMask = nullptr;
+    multisableStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
+    multisableStateCreateInfo.alphaToOneEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = desc.srcColorBlendFactor;
+    colorBlendAttachment.dstColorBlendFactor = desc.dstColorBlendFactor;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = desc.srcAlphaBlendFactor;
+    colorBlendAttachment.dstAlphaBlendFactor = desc.dstAlphaBlendFactor;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo {};
+    colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
+    colorBlendStateCreateInfo.attachmentCount = 1;
+    colorBlendStateCreateInfo.pAttachments = &colorBlendAttachment;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo {};
+    depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilStateCreateInfo.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencilStateCreateInfo.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencilStateCreateInfo.depthCompareOp = desc.depthCompareOp;
+    depthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;
+    depthStencilStateCreateInfo.stencilTestEnable = VK_FALSE;
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stageCount = shaderStageCreateInfos.size();
+    pipelineCreateInfo.pStages = shaderStageCreateInfos.data();
+    pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
+    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+    pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+    pipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
+    pipelineCreateInfo.pMultisampleState = &multisableStateCreateInfo;
+    pipelineCreateInfo.pDepthStencilState = desc.depthTest ? &depthStencilStateCreateInfo : nullptr;
+    pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
+    pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+
+    pipelineCreateInfo.layout = desc.layout;
+
+    pipelineCreateInfo.renderPass = desc.renderPass;
+    pipelineCreateInfo.subpass = desc.subpass;
+
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    // The pipeline cache is internally synchronized, workers may share it freely
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create graphics pipeline");
+    }
+
+    recordCompiled(stopwatch.elapsedMs());
+
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::compile(const ComputePipelineDesc& desc) {
+    ScopedCpuTimer compileTimer("compilePipeline");
+    utils::Stopwatch stopwatch;
+
+    VkComputePipelineCreateInfo pipelineCreateInfo {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.pName = "main";
+    const LoadedShader& computeShader = loadShader(desc.computeShader);
+    validateStage(desc.computeShader, *computeShader.reflection, VK_SHADER_STAGE_COMPUTE_BIT);
+    validatePermutation(desc.computeShader, *computeShader.reflection, desc.computePermutation);
+    pipelineCreateInfo.stage.module = computeShader.module;
+
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    VkSpecializationInfo specializationInfo = desc.computePermutation.specializationInfo(specializationEntries);
+    if (!desc.computePermutation.empty()) {
+        pipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
+    }
+    pipelineCreateInfo.layout = desc.layout;
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline");
+    }
+
+    recordCompiled(stopwatch.elapsedMs());
+
+    return pipeline;
+}
+
+void PipelineRegistry::recordCompiled(double compileMs) {
+    std::lock_guard lock(m_mutex);
+    ++m_stats.compiled;
+    m_stats.compileMs += compileMs;
+    m_lastCompiledTime = std::chrono::steady_clock::now();
+}
+
+template <typename Value, typename Load>
+Value PipelineRegistry::loadOnce(std::unordered_map<std::string, std::shared_future<Value>>& cache, const std::string& name, Load&& load) {
+    std::promise<Value> promise;
+    std::shared_future<Value> loaded;
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (auto iter = cache.find(name); iter != cache.end()) {
+            // Another worker is already loading (or has loaded) the same file
+            loaded = iter->second;
+        } else {
+            cache.emplace(name, promise.get_future().share());
+        }
+    }
+
+    if (loaded.valid()) {
+        return loaded.get();
+    }
+
+    try {
+        Value value = load();
+        promise.set_value(value);
+        return value;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+PipelineRegistry::ShaderCode PipelineRegistry::loadShaderCode(const std::string& name) {
+    return loadOnce(m_shaderCode, name, [this, &name]() {
+        auto spirv = std::make_shared<const Asset>(m_assets->load(name));
+        if (spirv->size() == 0 || spirv->size() % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Shader " + name + " is not a SPIR-V binary");
+        }
+
+        ShaderCode code;
+        code.reflection = std::make_shared<const ShaderReflection>(ReflectSpirv(spirv->dataAs<uint32_t>(0, spirv->size() / sizeof(uint32_t)),
+                                                                                spirv->size() / sizeof(uint32_t)));
+        code.spirv = std::move(spirv);
+        return code;
+    });
+}
+
+PipelineRegistry::LoadedShader PipelineRegistry::loadShader(const std::string& name) {
+    return loadOnce(m_shaders, name, [this, &name]() {
+        ShaderCode code = loadShaderCode(name);
+
+        // The driver reads the words straight from the mapped pages, or the decompressed copy
+        VkShaderModuleCreateInfo shaderModuleCreateInfo {};
+        shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shaderModuleCreateInfo.codeSize = code.spirv->size();
+        shaderModuleCreateInfo.pCode = code.spirv->dataAs<uint32_t>(0, code.spirv->size() / sizeof(uint32_t));
+
+        LoadedShader loaded;
+        loaded.reflection = code.reflection;
+        if (VkResult result = vkCreateShaderModule(m_vkDevice, &shaderModuleCreateInfo, nullptr, &loaded.module); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create VkShaderModule");
+        }
+        return loaded;
+    });
+}
+
+} // namespace nex
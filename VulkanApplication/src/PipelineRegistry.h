@@ -0,0 +1,259 @@
+#ifndef __VulkanApp_PipelineRegistry_H__
+#define __VulkanApp_PipelineRegistry_H__
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nex {
+
+class TaskScheduler;
+class AssetStore;
+class Asset;
+struct ShaderReflection;
+
+struct VertexLayout {
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+
+    bool operator==(const VertexLayout& other) const;
+};
+
+// Specialization constant values of one shader stage. Shaders declare their
+// feature switches and loop counts as layout(constant_id = N) constants with
+// a default; a permutation overrides some of them, and the driver folds the
+// branches they guard away when it compiles the pipeline. Permutations are
+// part of the pipeline description, so the registry's hashed description
+// table doubles as the variant table: equal keys share one pipeline.
+class ShaderPermutation {
+public:
+    // Every specialization constant is 32 bits wide
+    ShaderPermutation& setFlag(uint32_t constantId, bool enabled);
+    ShaderPermutation& setUint(uint32_t constantId, uint32_t value);
+    ShaderPermutation& setFloat(uint32_t constantId, float value);
+
+    bool empty() const {
+        return m_constants.empty();
+    }
+
+    std::vector<uint32_t> constantIds() const;
+
+    // Points into this permutation and entries, both must outlive the returned info
+    VkSpecializationInfo specializationInfo(std::vector<VkSpecializationMapEntry>& entries) const;
+
+    bool operator==(const ShaderPermutation& other) const;
+    size_t hash() const;
+
+private:
+    struct Constant {
+        uint32_t id = 0;
+        uint32_t value = 0;
+    };
+
+    // Sorted by id, so equal permutations compare equal however they were built
+    std::vector<Constant> m_constants;
+};
+
+// Everything that identifies a graphics pipeline. Viewport and scissor are
+// always dynamic, so they are not part of the description.
+struct GraphicsPipelineDesc {
+    // SPIR-V asset names
+    std::string vertexShader;
+    std::string fragmentShader;
+    ShaderPermutation vertexPermutation;
+    ShaderPermutation fragmentPermutation;
+
+    VertexLayout vertexLayout;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Rasterization
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    // Blending of the single color attachment
+    bool blendEnable = false;
+    VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+
+    // Requires a depth attachment in the subpass
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    bool operator==(const GraphicsPipelineDesc& other) const;
+    size_t hash() const;
+};
+
+struct ComputePipelineDesc {
+    // SPIR-V asset name
+    std::string computeShader;
+    ShaderPermutation computePermutation;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    bool operator==(const ComputePipelineDesc& other) const;
+    size_t hash() const;
+};
+
+// Works for both description types
+struct PipelineDescHasher {
+    template <typename Desc>
+    size_t operator()(const Desc& desc) const {
+        return desc.hash();
+    }
+};
+
+// Shared handle to a pipeline that may still be compiling. Copies share one
+// state, so a pipeline rebuilt by a shader reload reaches every holder at once.
+class PipelineHandle {
+public:
+    PipelineHandle() = default;
+    explicit PipelineHandle(std::shared_future<VkPipeline> future)
+        : m_future(std::make_shared<std::shared_future<VkPipeline>>(std::move(future))) {}
+
+    // Blocks until the pipeline is compiled, rethrows compilation errors
+    VkPipeline wait() const {
+        return m_future->get();
+    }
+
+    bool ready() const {
+        return valid() && m_future->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    bool valid() const {
+        return m_future && m_future->valid();
+    }
+
+private:
+    friend class PipelineRegistry;
+
+    // Replaced by PipelineRegistry::swapReloaded between frames, while nothing records
+    std::shared_ptr<std::shared_future<VkPipeline>> m_future;
+};
+
+struct PipelineRegistryStats {
+    size_t requested = 0;
+    size_t deduplicated = 0;
+    size_t compiled = 0;
+    // Sum of per-pipeline compile times across all workers
+    double compileMs = 0.0;
+    // From the first request to the last finished compilation
+    double wallMs = 0.0;
+};
+
+// Compiles graphics and compute pipelines on the task scheduler. Identical descriptions share
+// one pipeline, and all pipelines go through the same VkPipelineCache. Shaders are reflected
+// when their module is created; compilation checks the vertex layout and the permutations
+// against the reflected interface and throws on mismatches the driver would not report.
+class PipelineRegistry {
+public:
+    PipelineRegistry() = default;
+    ~PipelineRegistry();
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    // Shaders can be loaded and reflected from here on, before the device exists
+    void init(TaskScheduler& scheduler, const AssetStore& assets);
+    // Pipelines can be requested from here on. Shader modules are created
+    // straight from the assets' mapped pages.
+    void attachDevice(VkDevice device, VkPipelineCache pipelineCache);
+    void destroy();
+
+    PipelineHandle request(const GraphicsPipelineDesc& desc);
+    PipelineHandle request(const ComputePipelineDesc& desc);
+
+    // Loads the shader if needed, throws when it is missing or not valid SPIR-V.
+    // Needs no device. Stays valid after a reload, which reflects the new code separately.
+    std::shared_ptr<const ShaderReflection> reflect(const std::string& name);
+
+    // Waits for every requested pipeline, rethrows the first compilation error
+    void waitAll();
+
+    // Drops the cached modules of the named shaders and rebuilds every pipeline
+    // using them in the background. Returns how many pipelines are rebuilding.
+    size_t reloadShaders(const std::vector<std::string>& names);
+    // Called at a frame boundary: hands rebuilt pipelines to their handles and
+    // destroys replaced ones once the frames that used them are done. Failed
+    // rebuilds are reported and keep the previous pipeline. Returns how many
+    // pipelines were swapped.
+    size_t swapReloaded(uint64_t frameCounter, uint32_t framesInFlight);
+
+    PipelineRegistryStats stats();
+
+private:
+    template <typename Desc>
+    PipelineHandle request(const Desc& desc, std::unordered_map<Desc, PipelineHandle, PipelineDescHasher>& pipelines);
+
+    VkPipeline compile(const GraphicsPipelineDesc& desc);
+    VkPipeline compile(const ComputePipelineDesc& desc);
+    void recordCompiled(double compileMs);
+
+    struct ShaderCode {
+        std::shared_ptr<const Asset> spirv;
+        std::shared_ptr<const ShaderReflection> reflection;
+    };
+
+    struct LoadedShader {
+        VkShaderModule module = VK_NULL_HANDLE;
+        std::shared_ptr<const ShaderReflection> reflection;
+    };
+
+    // Runs load once per name, concurrent callers wait for the first one
+    template <typename Value, typename Load>
+    Value loadOnce(std::unordered_map<std::string, std::shared_future<Value>>& cache, const std::string& name, Load&& load);
+
+    ShaderCode loadShaderCode(const std::string& name);
+    LoadedShader loadShader(const std::string& name);
+
+    struct PendingReload {
+        PipelineHandle handle;
+        std::shared_future<VkPipeline> rebuilt;
+        // A newer reload of the same pipeline was started, this result is never used
+        bool superseded = false;
+    };
+
+    struct RetiredPipeline {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        uint64_t retiredAtFrame = 0;
+    };
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkPipelineCache m_vkPipelineCache = VK_NULL_HANDLE;
+    TaskScheduler* m_scheduler = nullptr;
+    const AssetStore* m_assets = nullptr;
+
+    std::mutex m_mutex;
+    std::unordered_map<GraphicsPipelineDesc, PipelineHandle, PipelineDescHasher> m_pipelines;
+    std::unordered_map<ComputePipelineDesc, PipelineHandle, PipelineDescHasher> m_computePipelines;
+    std::unordered_map<std::string, std::shared_future<ShaderCode>> m_shaderCode;
+    std::unordered_map<std::string, std::shared_future<LoadedShader>> m_shaders;
+
+    // Shader reloads. Replaced modules may still be in use by a running compilation,
+    // they are kept until destroy().
+    std::vector<PendingReload> m_pendingReloads;
+    std::vector<RetiredPipeline> m_retiredPipelines;
+    std::vector<std::shared_future<LoadedShader>> m_retiredShaders;
+
+    PipelineRegistryStats m_stats;
+    std::chrono::steady_clock::time_point m_firstRequestTime;
+    std::chrono::steady_clock::time_point m_lastCompiledTime;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_PipelineRegistry_H__
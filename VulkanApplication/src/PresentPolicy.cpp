@@ -0,0 +1,84 @@
+#include "PresentPolicy.h"
+
+#include <algorithm>
+#include <array>
+
+namespace nex {
+
+namespace {
+
+struct PolicyInfo {
+    PresentPolicy policy;
+    std::string_view name;
+    uint32_t framesInFlight;
+    // Present modes by preference, FIFO is always supported as the last resort
+    std::array<VkPresentModeKHR, 2> preferredModes;
+};
+
+constexpr std::array<PolicyInfo, 3> Policies {{
+    { PresentPolicy::LowLatency, "low-latency", 1, { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR } },
+    { PresentPolicy::PowerSave, "power-save", 2, { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_KHR } },
+    { PresentPolicy::Benchmark, "benchmark", 3, { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR } },
+}};
+
+const PolicyInfo& Info(PresentPolicy policy) {
+    return *std::find_if(Policies.begin(), Policies.end(), [policy](const PolicyInfo& info) {
+        return info.policy == policy;
+    });
+}
+
+} // namespace
+
+std::string_view PresentPolicyName(PresentPolicy policy) {
+    return Info(policy).name;
+}
+
+std::optional<PresentPolicy> ParsePresentPolicy(std::string_view name) {
+    for (const auto& info : Policies) {
+        if (info.name == name) {
+            return info.policy;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view PresentModeName(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+        default: return "UNKNOWN";
+    }
+}
+
+uint32_t PolicyFramesInFlight(PresentPolicy policy) {
+    return Info(policy).framesInFlight;
+}
+
+PresentConfiguration ChoosePresentConfiguration(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities,
+                                                const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    PresentConfiguration configuration;
+
+    for (VkPresentModeKHR presentMode : Info(policy).preferredModes) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end()) {
+            configuration.presentMode = presentMode;
+            break;
+        }
+    }
+
+    // MAILBOX needs a spare image to replace while one is displayed and one is
+    // rendered; FIFO and IMMEDIATE never block with the minimum
+    configuration.imageCount = capabilities.minImageCount;
+    if (configuration.presentMode == VK_PRESENT_MODE_MAILBOX_KHR || policy == PresentPolicy::Benchmark) {
+        configuration.imageCount += 1;
+    }
+
+    if (capabilities.maxImageCount > 0) {
+        configuration.imageCount = std::min(configuration.imageCount, capabilities.maxImageCount);
+    }
+
+    return configuration;
+}
+
+} // namespace nex
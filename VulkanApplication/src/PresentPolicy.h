@@ -0,0 +1,41 @@
+#ifndef __VulkanApp_PresentPolicy_H__
+#define __VulkanApp_PresentPolicy_H__
+
+#include <vulkan/vulkan.h>
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace nex {
+
+// Trade-off between latency, power and throughput for presentation. A policy
+// decides the present mode, the swapchain image count and the frames in flight
+// together, since each of them adds a frame of queueing on its own.
+enum class PresentPolicy {
+    // MAILBOX (or IMMEDIATE) with the fewest images and a single frame in flight
+    LowLatency,
+    // FIFO with the fewest images, the display rate caps the frame rate
+    PowerSave,
+    // IMMEDIATE with enough frames in flight to never stall on the CPU
+    Benchmark,
+};
+
+struct PresentConfiguration {
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t imageCount = 0;
+};
+
+std::string_view PresentPolicyName(PresentPolicy policy);
+std::optional<PresentPolicy> ParsePresentPolicy(std::string_view name);
+
+std::string_view PresentModeName(VkPresentModeKHR presentMode);
+
+uint32_t PolicyFramesInFlight(PresentPolicy policy);
+
+PresentConfiguration ChoosePresentConfiguration(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities,
+                                                const std::vector<VkPresentModeKHR>& availablePresentModes);
+
+} // namespace nex
+
+#endif // __VulkanApp_PresentPolicy_H__
@@ -0,0 +1,174 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+
+namespace nex {
+
+namespace {
+
+void WriteJsonString(std::ostream& out, std::string_view str) {
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void RollingHistogram::add(double ms) {
+    if (m_samples.size() < WindowSize) {
+        m_samples.push_back(ms);
+    } else {
+        m_samples[m_next] = ms;
+    }
+    m_next = (m_next + 1) % WindowSize;
+}
+
+double RollingHistogram::percentile(double p) const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+
+    std::vector<double> sorted = m_samples;
+    size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(p / 100.0 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+    return sorted[rank];
+}
+
+double RollingHistogram::averageMs() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(m_samples.begin(), m_samples.end(), 0.0) / m_samples.size();
+}
+
+double RollingHistogram::maxMs() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+    return *std::max_element(m_samples.begin(), m_samples.end());
+}
+
+Profiler::Profiler()
+    : m_epoch(std::chrono::steady_clock::now())
+{}
+
+Profiler& Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setTraceCapture(bool capture) {
+    std::lock_guard lock(m_mutex);
+    m_traceCapture = capture;
+}
+
+double Profiler::nowUs() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+uint32_t Profiler::CurrentThreadId() {
+    static std::atomic<uint32_t> nextThreadId { 0 };
+    thread_local uint32_t threadId = nextThreadId++;
+    return threadId;
+}
+
+void Profiler::addEvent(TraceEvent event) {
+    std::lock_guard lock(m_mutex);
+    if (m_traceCapture && m_events.size() < MaxTraceEvents) {
+        m_events.push_back(std::move(event));
+    }
+}
+
+void Profiler::addSample(std::string_view series, double ms) {
+    std::lock_guard lock(m_mutex);
+
+    auto iter = m_histograms.find(series);
+    if (iter == m_histograms.end()) {
+        iter = m_histograms.emplace(std::string(series), RollingHistogram {}).first;
+    }
+    iter->second.add(ms);
+}
+
+void Profiler::report(std::ostream& out) const {
+    std::lock_guard lock(m_mutex);
+
+    out << "[profile] Last " << RollingHistogram::WindowSize << " samples per series (ms):\n";
+    for (const auto& [series, histogram] : m_histograms) {
+        out << "  " << std::left << std::setw(32) << series << std::right << std::fixed << std::setprecision(3)
+            << " avg " << std::setw(9) << histogram.averageMs()
+            << " p50 " << std::setw(9) << histogram.percentile(50.0)
+            << " p95 " << std::setw(9) << histogram.percentile(95.0)
+            << " p99 " << std::setw(9) << histogram.percentile(99.0)
+            << " max " << std::setw(9) << histogram.maxMs()
+            << " (" << histogram.count() << ")\n";
+    }
+    out << std::defaultfloat;
+}
+
+void Profiler::writeChromeTrace(const std::string& filepath) const {
+    std::ofstream file(filepath, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open trace file " + filepath);
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    std::set<uint32_t> gpuThreadIds { GpuThreadId };
+    for (const auto& event : m_events) {
+        if (event.threadId >= GpuThreadId) {
+            gpuThreadIds.insert(event.threadId);
+        }
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (uint32_t threadId : gpuThreadIds) {
+        file << (threadId == GpuThreadId ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadId
+             << ",\"args\":{\"name\":\"GPU";
+        if (threadId != GpuThreadId) {
+            file << ' ' << threadId - GpuThreadId;
+        }
+        file << "\"}}";
+    }
+    file << std::fixed << std::setprecision(3);
+
+    for (const auto& event : m_events) {
+        file << ",\n{\"name\":";
+        WriteJsonString(file, event.name);
+        file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadId
+             << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+    }
+
+    file << "\n]}\n";
+
+    if (!file) {
+        throw std::runtime_error("Failed to write trace file " + filepath);
+    }
+}
+
+ScopedCpuTimer::ScopedCpuTimer(const char* name)
+    : m_name(name)
+    , m_startUs(Profiler::Get().nowUs())
+{}
+
+ScopedCpuTimer::~ScopedCpuTimer() {
+    Profiler& profiler = Profiler::Get();
+
+    double durationUs = profiler.nowUs() - m_startUs;
+
+    profiler.addEvent({ m_name, Profiler::CurrentThreadId(), m_startUs, durationUs });
+    profiler.addSample(std::string("cpu/") + m_name, durationUs / 1000.0);
+}
+
+} // namespace nex
@@ -0,0 +1,96 @@
+#ifndef __VulkanApp_Profiler_H__
+#define __VulkanApp_Profiler_H__
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nex {
+
+// Percentiles over the last WindowSize samples of a series
+class RollingHistogram {
+public:
+    static constexpr size_t WindowSize = 256;
+
+    void add(double ms);
+
+    size_t count() const {
+        return m_samples.size();
+    }
+
+    double percentile(double p) const;
+    double averageMs() const;
+    double maxMs() const;
+
+private:
+    std::vector<double> m_samples;
+    size_t m_next = 0;
+};
+
+struct TraceEvent {
+    std::string name;
+    uint32_t threadId = 0;
+    double startUs = 0.0;
+    double durationUs = 0.0;
+};
+
+// Process wide sink for CPU scopes from every thread and for resolved GPU
+// scopes. Keeps a rolling histogram per series and, when capture is enabled,
+// the raw events for a Chrome trace (chrome://tracing, Perfetto).
+class Profiler {
+public:
+    // Trace thread id GPU timestamps are reported on, the GPU of device n uses GpuThreadId + n
+    static constexpr uint32_t GpuThreadId = 1000;
+    // Bounds trace memory for long runs, later events are dropped
+    static constexpr size_t MaxTraceEvents = 1 << 20;
+
+    static Profiler& Get();
+
+    void setTraceCapture(bool capture);
+
+    // Microseconds since the profiler was created, the time base of all events
+    double nowUs() const;
+
+    // Small stable id of the calling thread, the main thread is the first to ask
+    static uint32_t CurrentThreadId();
+
+    void addEvent(TraceEvent event);
+    void addSample(std::string_view series, double ms);
+
+    void report(std::ostream& out) const;
+    void writeChromeTrace(const std::string& filepath) const;
+
+private:
+    Profiler();
+
+private:
+    std::chrono::steady_clock::time_point m_epoch;
+
+    mutable std::mutex m_mutex;
+    bool m_traceCapture = false;
+    std::vector<TraceEvent> m_events;
+    std::map<std::string, RollingHistogram, std::less<>> m_histograms;
+};
+
+// Records the enclosing scope as a CPU event and a "cpu/<name>" sample
+class ScopedCpuTimer {
+public:
+    explicit ScopedCpuTimer(const char* name);
+    ~ScopedCpuTimer();
+
+    ScopedCpuTimer(const ScopedCpuTimer&) = delete;
+    ScopedCpuTimer& operator=(const ScopedCpuTimer&) = delete;
+
+private:
+    const char* m_name;
+    double m_startUs;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_Profiler_H__
@@ -0,0 +1,506 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "GpuProfiler.h"
+
+namespace nex {
+
+void RenderPassBuilder::colorAttachment(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor) {
+    RenderGraph::Attachment attachment;
+    attachment.image = image.index;
+    attachment.access = ImageAccess::ColorAttachment;
+    attachment.loadOp = loadOp;
+    attachment.clearValue.color = clearColor;
+    m_graph.m_passes[m_passIdx].colorAttachments.push_back(attachment);
+
+    bool load = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+    m_graph.addUse(m_passIdx, { image.index, ImageAccess::ColorAttachment, load, !load });
+}
+
+void RenderPassBuilder::depthAttachment(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearDepth, bool depthWrite) {
+    RenderGraph::PassNode& pass = m_graph.m_passes[m_passIdx];
+    if (pass.depthAttachment) {
+        throw std::runtime_error("Render graph pass " + pass.name + " has more than one depth attachment");
+    }
+
+    RenderGraph::Attachment attachment;
+    attachment.image = image.index;
+    attachment.access = depthWrite ? ImageAccess::DepthAttachment : ImageAccess::DepthRead;
+    attachment.loadOp = loadOp;
+    attachment.clearValue.depthStencil = clearDepth;
+    pass.depthAttachment = attachment;
+
+    bool load = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+    m_graph.addUse(m_passIdx, { image.index, attachment.access, load, depthWrite && !load });
+}
+
+void RenderPassBuilder::read(RenderGraphImage image, ImageAccess access) {
+    m_graph.addUse(m_passIdx, { image.index, access, true, false });
+}
+
+void RenderPassBuilder::write(RenderGraphImage image, ImageAccess access) {
+    // Storage and transfer writes may leave parts of the image untouched
+    m_graph.addUse(m_passIdx, { image.index, access, false, false });
+}
+
+void RenderPassBuilder::setSubpassContents(VkSubpassContents contents) {
+    m_graph.m_passes[m_passIdx].contents = contents;
+}
+
+void RenderPassBuilder::setSideEffects() {
+    m_graph.m_planPasses[m_passIdx].sideEffects = true;
+}
+
+RenderGraph::~RenderGraph() {
+    destroy();
+}
+
+void RenderGraph::init(VkMemoryAllocator& allocator) {
+    m_vkDevice = allocator.device();
+    m_renderTargetAllocator.init(allocator);
+}
+
+void RenderGraph::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    RenderGraphResources resources = std::move(m_resources);
+    for (auto& [key, framebuffer] : m_framebuffers) {
+        resources.framebuffers.push_back(framebuffer);
+    }
+    m_framebuffers.clear();
+    destroyResources(resources);
+
+    for (auto& pass : m_passes) {
+        vkDestroyRenderPass(m_vkDevice, pass.renderPass, nullptr);
+    }
+    m_passes.clear();
+    m_images.clear();
+    m_planPasses.clear();
+    m_planImages.clear();
+    m_order.clear();
+    m_barrierPlan = {};
+    m_compiled = false;
+
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+RenderGraphImage RenderGraph::createImage(const std::string& name, const RenderImageDesc& desc) {
+    ImageNode node;
+    node.name = name;
+    node.desc = desc;
+    m_images.push_back(std::move(node));
+    m_planImages.emplace_back();
+
+    return { static_cast<uint32_t>(m_images.size() - 1) };
+}
+
+RenderGraphImage RenderGraph::importImage(const std::string& name, const ImportedImageDesc& desc) {
+    ImageNode node;
+    node.name = name;
+    node.desc.format = desc.format;
+    node.desc.samples = desc.samples;
+    m_images.push_back(std::move(node));
+
+    PlanImage planImage;
+    planImage.imported = true;
+    planImage.initialLayout = desc.initialLayout;
+    planImage.initialStages = desc.initialStages;
+    planImage.initialAccess = desc.initialAccess;
+    planImage.finalLayout = desc.finalLayout;
+    m_planImages.push_back(planImage);
+
+    return { static_cast<uint32_t>(m_images.size() - 1) };
+}
+
+RenderGraphPass RenderGraph::addPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute) {
+    if (m_compiled) {
+        throw std::runtime_error("Render graph pass " + name + " added after compile");
+    }
+
+    PassNode node;
+    node.name = name;
+    node.execute = std::move(execute);
+    m_passes.push_back(std::move(node));
+    m_planPasses.emplace_back();
+
+    uint32_t passIdx = static_cast<uint32_t>(m_passes.size() - 1);
+    RenderPassBuilder builder(*this, passIdx);
+    setup(builder);
+
+    return { passIdx };
+}
+
+void RenderGraph::addUse(uint32_t passIdx, const ImageUse& use) {
+    const PassNode& pass = m_passes[passIdx];
+    PlanPass& planPass = m_planPasses[passIdx];
+
+    if (use.image >= m_images.size()) {
+        throw std::runtime_error("Render graph pass " + pass.name + " uses an unknown image");
+    }
+
+    // One layout per image and pass, the barriers are placed before the pass begins
+    for (const auto& other : planPass.uses) {
+        if (other.image == use.image) {
+            throw std::runtime_error("Render graph pass " + pass.name + " uses image " + m_images[use.image].name + " more than once");
+        }
+    }
+
+    planPass.uses.push_back(use);
+}
+
+void RenderGraph::compile() {
+    m_order = CullPasses(m_planPasses, m_planImages);
+
+    for (uint32_t imageIdx = 0; imageIdx < m_images.size(); ++imageIdx) {
+        ImageNode& image = m_images[imageIdx];
+        image.usage = 0;
+        image.firstUse = ~0u;
+        image.lastUse = 0;
+        image.transientContents = !m_planImages[imageIdx].imported;
+    }
+
+    // Every image read must have been produced by an earlier pass that survived culling
+    std::vector<bool> written(m_images.size(), false);
+
+    for (uint32_t position = 0; position < m_order.size(); ++position) {
+        const PassNode& pass = m_passes[m_order[position]];
+
+        for (const auto& use : m_planPasses[m_order[position]].uses) {
+            ImageNode& image = m_images[use.image];
+
+            if (use.readsContents && !m_planImages[use.image].imported && !written[use.image]) {
+                throw std::runtime_error("Render graph pass " + pass.name + " reads " + image.name + " before any pass writes it");
+            }
+            written[use.image] = written[use.image] || GetImageAccessInfo(use.access).write;
+
+            image.usage |= GetImageAccessInfo(use.access).usage;
+            image.firstUse = std::min(image.firstUse, position);
+            image.lastUse = std::max(image.lastUse, position);
+        }
+    }
+
+    for (uint32_t position = 0; position < m_order.size(); ++position) {
+        PassNode& pass = m_passes[m_order[position]];
+
+        for (auto& attachment : pass.colorAttachments) {
+            attachment.storeOp = contentsNeededAfter(attachment.image, position) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+        if (pass.depthAttachment) {
+            pass.depthAttachment->storeOp = contentsNeededAfter(pass.depthAttachment->image, position) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+
+        // Anything but an attachment that is neither loaded nor stored has to live in memory
+        for (const auto& use : m_planPasses[m_order[position]].uses) {
+            ImageAccess access = use.access;
+            bool attachment = access == ImageAccess::ColorAttachment || access == ImageAccess::DepthAttachment || access == ImageAccess::DepthRead;
+            if (!attachment || use.readsContents || contentsNeededAfter(use.image, position)) {
+                m_images[use.image].transientContents = false;
+            }
+        }
+
+        createRenderPass(pass);
+    }
+
+    m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+    m_stats.culledPassCount = static_cast<uint32_t>(m_passes.size() - m_order.size());
+
+    m_compiled = true;
+}
+
+bool RenderGraph::contentsNeededAfter(uint32_t image, uint32_t position) const {
+    return ContentsNeededAfter(m_planPasses, m_order, m_planImages, image, position);
+}
+
+void RenderGraph::createRenderPass(PassNode& pass) {
+    if (pass.colorAttachments.empty() && !pass.depthAttachment) {
+        return;
+    }
+
+    std::vector<VkAttachmentDescription> attachmentDescriptions;
+    std::vector<VkAttachmentReference> colorAttachmentRefs;
+    VkAttachmentReference depthAttachmentRef {};
+
+    // The graph's barriers move attachments into their layout before the render pass
+    // begins, so the render pass itself never transitions and needs no dependencies
+    auto addAttachment = [&](const Attachment& attachment) {
+        const ImageNode& image = m_images[attachment.image];
+        VkImageLayout layout = GetImageAccessInfo(attachment.access).layout;
+
+        VkAttachmentDescription attachmentDescription {};
+        attachmentDescription.format = image.desc.format;
+        attachmentDescription.samples = image.desc.samples;
+        attachmentDescription.loadOp = attachment.loadOp;
+        attachmentDescription.storeOp = attachment.storeOp;
+        attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachmentDescription.initialLayout = layout;
+        attachmentDescription.finalLayout = layout;
+        attachmentDescriptions.push_back(attachmentDescription);
+
+        return VkAttachmentReference { static_cast<uint32_t>(attachmentDescriptions.size() - 1), layout };
+    };
+
+    for (const auto& attachment : pass.colorAttachments) {
+        colorAttachmentRefs.push_back(addAttachment(attachment));
+    }
+    if (pass.depthAttachment) {
+        depthAttachmentRef = addAttachment(*pass.depthAttachment);
+    }
+
+    VkSubpassDescription subpass {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = colorAttachmentRefs.size();
+    subpass.pColorAttachments = colorAttachmentRefs.data();
+    subpass.pDepthStencilAttachment = pass.depthAttachment ? &depthAttachmentRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassCreateInfo {};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = attachmentDescriptions.size();
+    renderPassCreateInfo.pAttachments = attachmentDescriptions.data();
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpass;
+
+    if (VkResult result = vkCreateRenderPass(m_vkDevice, &renderPassCreateInfo, nullptr, &pass.renderPass); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render pass for " + pass.name);
+    }
+}
+
+RenderGraphResources RenderGraph::resize(VkExtent2D extent) {
+    if (!m_compiled) {
+        throw std::runtime_error("Render graph resized before compile");
+    }
+
+    RenderGraphResources retired = std::move(m_resources);
+    m_resources = {};
+    for (auto& [key, framebuffer] : m_framebuffers) {
+        retired.framebuffers.push_back(framebuffer);
+    }
+    m_framebuffers.clear();
+
+    m_extent = extent;
+
+    for (uint32_t passIdx : m_order) {
+        PassNode& pass = m_passes[passIdx];
+
+        // Render area of the pass, taken from its first attachment
+        VkExtent2D imageExtent {};
+        if (!pass.colorAttachments.empty()) {
+            imageExtent = m_images[pass.colorAttachments.front().image].desc.extent;
+        } else if (pass.depthAttachment) {
+            imageExtent = m_images[pass.depthAttachment->image].desc.extent;
+        }
+        pass.extent = imageExtent.width != 0 ? imageExtent : m_extent;
+    }
+
+    allocateTransientImages();
+    planBarriers();
+
+    return retired;
+}
+
+void RenderGraph::allocateTransientImages() {
+    std::vector<RenderTargetDesc> descs;
+    std::vector<uint32_t> targetImages;
+
+    for (uint32_t imageIdx = 0; imageIdx < m_images.size(); ++imageIdx) {
+        ImageNode& image = m_images[imageIdx];
+        m_planImages[imageIdx].aliasPredecessor = imageIdx;
+
+        if (m_planImages[imageIdx].imported) {
+            continue;
+        }
+
+        image.image = VK_NULL_HANDLE;
+        image.imageView = VK_NULL_HANDLE;
+
+        // Images whose passes were all culled are never created
+        if (image.usage == 0) {
+            continue;
+        }
+
+        RenderTargetDesc desc;
+        desc.name = image.name;
+        desc.format = image.desc.format;
+        desc.extent = image.desc.extent.width != 0 ? image.desc.extent : m_extent;
+        desc.samples = image.desc.samples;
+        desc.usage = image.usage;
+        desc.firstUse = image.firstUse;
+        desc.lastUse = image.lastUse;
+        desc.transientContents = image.transientContents;
+
+        descs.push_back(desc);
+        targetImages.push_back(imageIdx);
+    }
+
+    std::vector<RenderTarget> targets = m_renderTargetAllocator.allocate(descs, m_resources.renderTargets);
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        ImageNode& image = m_images[targetImages[i]];
+        image.image = targets[i].image;
+        image.imageView = targets[i].imageView;
+        m_planImages[targetImages[i]].aliasPredecessor = targetImages[targets[i].aliasPredecessor];
+    }
+
+    m_stats.renderTargets = m_renderTargetAllocator.stats();
+}
+
+void RenderGraph::planBarriers() {
+    m_barrierPlan = PlanBarriers(m_planPasses, m_order, m_planImages);
+
+    m_stats.barrierCount = static_cast<uint32_t>(m_barrierPlan.finalBarriers.barriers.size());
+    for (const auto& batch : m_barrierPlan.passBarriers) {
+        m_stats.barrierCount += static_cast<uint32_t>(batch.barriers.size());
+    }
+}
+
+void RenderGraph::destroyResources(RenderGraphResources& resources) {
+    for (auto& framebuffer : resources.framebuffers) {
+        vkDestroyFramebuffer(m_vkDevice, framebuffer, nullptr);
+    }
+    m_renderTargetAllocator.destroy(resources.renderTargets);
+
+    resources = {};
+}
+
+void RenderGraph::setImportedImage(RenderGraphImage image, VkImage vkImage, VkImageView imageView) {
+    ImageNode& node = m_images[image.index];
+    if (!m_planImages[image.index].imported) {
+        throw std::runtime_error("Render graph image " + node.name + " is not imported");
+    }
+
+    node.image = vkImage;
+    node.imageView = imageView;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, GpuProfiler* profiler) {
+    for (uint32_t position = 0; position < m_order.size(); ++position) {
+        uint32_t passIdx = m_order[position];
+        PassNode& pass = m_passes[passIdx];
+
+        recordBarriers(commandBuffer, m_barrierPlan.passBarriers[position]);
+
+        uint32_t scope = profiler ? profiler->beginScope(commandBuffer, pass.name.c_str()) : 0;
+
+        RenderPassContext context;
+        context.commandBuffer = commandBuffer;
+        context.extent = pass.extent;
+
+        if (pass.renderPass == VK_NULL_HANDLE) {
+            pass.execute(context);
+        } else {
+            context.renderPass = pass.renderPass;
+            context.framebuffer = framebuffer(passIdx);
+
+            std::vector<VkClearValue> clearValues;
+            for (const auto& attachment : pass.colorAttachments) {
+                clearValues.push_back(attachment.clearValue);
+            }
+            if (pass.depthAttachment) {
+                clearValues.push_back(pass.depthAttachment->clearValue);
+            }
+
+            VkRenderPassBeginInfo renderPassBeginInfo {};
+            renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassBeginInfo.renderPass = pass.renderPass;
+            renderPassBeginInfo.framebuffer = context.framebuffer;
+            renderPassBeginInfo.renderArea.offset = { 0, 0 };
+            renderPassBeginInfo.renderArea.extent = pass.extent;
+            renderPassBeginInfo.clearValueCount = clearValues.size();
+            renderPassBeginInfo.pClearValues = clearValues.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, pass.contents);
+            pass.execute(context);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+
+        if (profiler) {
+            profiler->endScope(commandBuffer, scope);
+        }
+    }
+
+    recordBarriers(commandBuffer, m_barrierPlan.finalBarriers);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) {
+    if (batch.barriers.empty()) {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(batch.barriers.size());
+
+    for (const auto& barrier : batch.barriers) {
+        const ImageNode& image = m_images[barrier.image];
+        if (image.image == VK_NULL_HANDLE) {
+            throw std::runtime_error("Render graph image " + image.name + " has no image this frame");
+        }
+
+        VkImageMemoryBarrier imageBarrier {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = image.image;
+        imageBarrier.subresourceRange.aspectMask = FormatAspectMask(image.desc.format);
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    // Nothing to wait for is expressed as top of pipe
+    VkPipelineStageFlags srcStages = batch.srcStages != 0 ? batch.srcStages : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, batch.dstStages, 0, 0, nullptr, 0, nullptr, imageBarriers.size(), imageBarriers.data());
+}
+
+VkFramebuffer RenderGraph::framebuffer(uint32_t passIdx) {
+    const PassNode& pass = m_passes[passIdx];
+
+    std::vector<VkImageView> attachments;
+    for (const auto& attachment : pass.colorAttachments) {
+        attachments.push_back(m_images[attachment.image].imageView);
+    }
+    if (pass.depthAttachment) {
+        attachments.push_back(m_images[pass.depthAttachment->image].imageView);
+    }
+
+    // Imported images change every frame, so there is one framebuffer per combination seen
+    auto key = std::make_pair(passIdx, attachments);
+    if (auto iter = m_framebuffers.find(key); iter != m_framebuffers.end()) {
+        return iter->second;
+    }
+
+    VkFramebufferCreateInfo framebufferCreateInfo {};
+    framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferCreateInfo.renderPass = pass.renderPass;
+    framebufferCreateInfo.attachmentCount = attachments.size();
+    framebufferCreateInfo.pAttachments = attachments.data();
+    framebufferCreateInfo.width = pass.extent.width;
+    framebufferCreateInfo.height = pass.extent.height;
+    framebufferCreateInfo.layers = 1;
+
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateFramebuffer(m_vkDevice, &framebufferCreateInfo, nullptr, &framebuffer); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create framebuffer for " + pass.name);
+    }
+    m_framebuffers.emplace(std::move(key), framebuffer);
+
+    return framebuffer;
+}
+
+VkRenderPass RenderGraph::renderPass(RenderGraphPass pass) const {
+    return m_passes[pass.index].renderPass;
+}
+
+VkImageView RenderGraph::imageView(RenderGraphImage image) const {
+    return m_images[image.index].imageView;
+}
+
+} // namespace nex
@@ -0,0 +1,235 @@
+#ifndef __VulkanApp_RenderGraph_H__
+#define __VulkanApp_RenderGraph_H__
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RenderGraphPlan.h"
+#include "RenderTargetAllocator.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+class GpuProfiler;
+class RenderGraph;
+
+struct RenderGraphImage {
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    uint32_t index = InvalidIndex;
+
+    bool valid() const {
+        return index != InvalidIndex;
+    }
+};
+
+struct RenderGraphPass {
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    uint32_t index = InvalidIndex;
+
+    bool valid() const {
+        return index != InvalidIndex;
+    }
+};
+
+// Image created and owned by the graph, only valid while the graph executes
+struct RenderImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    // 0 follows the extent passed to RenderGraph::resize()
+    VkExtent2D extent { 0, 0 };
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+// Image owned outside the graph, such as a swapchain image. It has the graph's
+// extent; the actual image is supplied every frame with setImportedImage().
+struct ImportedImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    // State the image is in when the graph starts executing
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags initialAccess = 0;
+
+    // Layout the graph leaves the image in
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+};
+
+class RenderPassBuilder {
+public:
+    void colorAttachment(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+    void depthAttachment(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearDepth = { 1.0f, 0 },
+                         bool depthWrite = true);
+
+    void read(RenderGraphImage image, ImageAccess access);
+    void write(RenderGraphImage image, ImageAccess access);
+
+    // Whether the pass records its draws inline or executes secondary command buffers
+    void setSubpassContents(VkSubpassContents contents);
+
+    // The pass is kept even when nothing reads what it writes
+    void setSideEffects();
+
+private:
+    friend class RenderGraph;
+
+    RenderPassBuilder(RenderGraph& graph, uint32_t passIdx) : m_graph(graph), m_passIdx(passIdx) {}
+
+private:
+    RenderGraph& m_graph;
+    uint32_t m_passIdx = 0;
+};
+
+struct RenderPassContext {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+    // Null for passes without attachments; otherwise the render pass has already begun
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent {};
+};
+
+// Objects created for one extent. Frames in flight may still use them after
+// a resize, so they are handed back to the caller for deferred destruction.
+struct RenderGraphResources {
+    RenderTargetSet renderTargets;
+    std::vector<VkFramebuffer> framebuffers;
+};
+
+struct RenderGraphStats {
+    uint32_t passCount = 0;
+    uint32_t culledPassCount = 0;
+    uint32_t barrierCount = 0;
+    RenderTargetStats renderTargets;
+};
+
+// Frame described as passes that declare the images they read and write.
+// Passes are declared in submission order and may only consume images produced
+// by earlier passes, so the declaration order is a valid execution order. From
+// the declared accesses the graph culls passes whose results are never used,
+// places batched barriers and layout transitions between passes, stores
+// attachments only when a later pass or the caller needs their contents and
+// hands the transient images to a RenderTargetAllocator.
+class RenderGraph {
+public:
+    using SetupFunc = std::function<void(RenderPassBuilder& builder)>;
+    using ExecuteFunc = std::function<void(const RenderPassContext& context)>;
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    void init(VkMemoryAllocator& allocator);
+    void destroy();
+
+    RenderGraphImage createImage(const std::string& name, const RenderImageDesc& desc);
+    RenderGraphImage importImage(const std::string& name, const ImportedImageDesc& desc);
+
+    // setup runs immediately and declares what the pass accesses
+    RenderGraphPass addPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute);
+
+    // Culls passes, validates accesses and creates the render passes. Called once
+    // after all passes are added; the render passes are valid from then on.
+    void compile();
+
+    // Creates the transient images and plans the barriers for a new extent.
+    // Returns the objects created for the previous extent.
+    RenderGraphResources resize(VkExtent2D extent);
+    void destroyResources(RenderGraphResources& resources);
+
+    void setImportedImage(RenderGraphImage image, VkImage vkImage, VkImageView imageView);
+
+    // Records every pass that survived culling, each one timed when a profiler is given
+    void execute(VkCommandBuffer commandBuffer, GpuProfiler* profiler = nullptr);
+
+    VkRenderPass renderPass(RenderGraphPass pass) const;
+    VkImageView imageView(RenderGraphImage image) const;
+
+    const RenderGraphStats& stats() const {
+        return m_stats;
+    }
+
+private:
+    friend class RenderPassBuilder;
+
+    struct Attachment {
+        uint32_t image = 0;
+        ImageAccess access = ImageAccess::ColorAttachment;
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        VkClearValue clearValue {};
+    };
+
+    struct PassNode {
+        std::string name;
+        ExecuteFunc execute;
+
+        std::vector<Attachment> colorAttachments;
+        std::optional<Attachment> depthAttachment;
+
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkExtent2D extent {};
+    };
+
+    struct ImageNode {
+        std::string name;
+        RenderImageDesc desc;
+
+        VkImageUsageFlags usage = 0;
+
+        // Positions in m_order of the first and last pass using the image
+        uint32_t firstUse = ~0u;
+        uint32_t lastUse = 0;
+
+        // Only ever a loaded-nothing, stored-nothing attachment
+        bool transientContents = true;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+    };
+
+    void addUse(uint32_t passIdx, const ImageUse& use);
+    // Whether a pass after position reads what the image holds at that point
+    bool contentsNeededAfter(uint32_t image, uint32_t position) const;
+    void createRenderPass(PassNode& pass);
+    void allocateTransientImages();
+    void planBarriers();
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+    VkFramebuffer framebuffer(uint32_t passIdx);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    RenderTargetAllocator m_renderTargetAllocator;
+
+    std::vector<PassNode> m_passes;
+    std::vector<ImageNode> m_images;
+    // What the planning functions see of m_passes and m_images, index for index
+    std::vector<PlanPass> m_planPasses;
+    std::vector<PlanImage> m_planImages;
+    // Indices of the passes that survived culling, in execution order
+    std::vector<uint32_t> m_order;
+    bool m_compiled = false;
+
+    VkExtent2D m_extent {};
+    RenderGraphResources m_resources;
+    std::map<std::pair<uint32_t, std::vector<VkImageView>>, VkFramebuffer> m_framebuffers;
+
+    BarrierPlan m_barrierPlan;
+
+    RenderGraphStats m_stats;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_RenderGraph_H__
@@ -0,0 +1,229 @@
+#include "RenderGraphPlan.h"
+
+#include <optional>
+#include <stdexcept>
+
+namespace nex {
+
+ImageAccessInfo GetImageAccessInfo(ImageAccess access) {
+    switch (access) {
+        case ImageAccess::ColorAttachment:
+            return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                     VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+        case ImageAccess::DepthAttachment:
+            return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true };
+        case ImageAccess::DepthRead:
+            return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false };
+        case ImageAccess::FragmentSampled:
+            return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        case ImageAccess::ComputeSampled:
+            return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        case ImageAccess::ComputeStorageRead:
+            return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT, false };
+        case ImageAccess::ComputeStorageWrite:
+            return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT, true };
+        case ImageAccess::TransferSrc:
+            return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false };
+        case ImageAccess::TransferDst:
+            return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true };
+    }
+
+    throw std::runtime_error("Unknown render graph image access");
+}
+
+std::vector<uint32_t> CullPasses(const std::vector<PlanPass>& passes, const std::vector<PlanImage>& images) {
+    // A pass survives when a later consumer needs one of the images it writes,
+    // and then needs whatever it reads in turn
+    std::vector<bool> needed(images.size(), false);
+    for (size_t i = 0; i < images.size(); ++i) {
+        needed[i] = images[i].imported;
+    }
+
+    std::vector<bool> culled(passes.size(), false);
+    for (size_t passIdx = passes.size(); passIdx-- > 0;) {
+        const PlanPass& pass = passes[passIdx];
+
+        bool producesNeeded = false;
+        for (const auto& use : pass.uses) {
+            producesNeeded = producesNeeded || (GetImageAccessInfo(use.access).write && needed[use.image]);
+        }
+
+        culled[passIdx] = !pass.sideEffects && !producesNeeded;
+        if (culled[passIdx]) {
+            continue;
+        }
+
+        // Whatever an overwrite replaces is dead, unless this pass reads it too
+        for (const auto& use : pass.uses) {
+            if (use.overwrites) {
+                needed[use.image] = false;
+            }
+        }
+        for (const auto& use : pass.uses) {
+            if (use.readsContents) {
+                needed[use.image] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t passIdx = 0; passIdx < passes.size(); ++passIdx) {
+        if (!culled[passIdx]) {
+            order.push_back(passIdx);
+        }
+    }
+    return order;
+}
+
+bool ContentsNeededAfter(const std::vector<PlanPass>& passes, const std::vector<uint32_t>& order,
+                         const std::vector<PlanImage>& images, uint32_t image, uint32_t position) {
+    for (uint32_t later = position + 1; later < order.size(); ++later) {
+        for (const auto& use : passes[order[later]].uses) {
+            if (use.image != image) {
+                continue;
+            }
+
+            // A partial write keeps what it does not touch, which may be read further on
+            if (use.readsContents || !use.overwrites) {
+                return true;
+            }
+            return false;
+        }
+    }
+
+    // Imported images are consumed outside the graph
+    return images[image].imported;
+}
+
+BarrierPlan PlanBarriers(const std::vector<PlanPass>& passes, const std::vector<uint32_t>& order, const std::vector<PlanImage>& images) {
+    struct ImageState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Last write, or the layout transitions since, which later uses synchronize with
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        // Reads since the last write, the next write or transition waits for them
+        VkPipelineStageFlags readStages = 0;
+        // Stages and accesses the barriers since the last write made it visible to
+        VkPipelineStageFlags visibleStages = 0;
+        VkAccessFlags visibleAccess = 0;
+    };
+    std::vector<ImageState> states(images.size());
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (images[i].imported) {
+            states[i].layout = images[i].initialLayout;
+            states[i].writeStages = images[i].initialStages;
+            states[i].writeAccess = images[i].initialAccess;
+        }
+    }
+
+    // Where each transient image is first transitioned, to be completed below once
+    // it is known what used its memory last
+    struct FirstUse {
+        uint32_t position = 0;
+        size_t barrier = 0;
+    };
+    std::vector<std::optional<FirstUse>> firstUses(images.size());
+
+    BarrierPlan plan;
+    plan.passBarriers.resize(order.size());
+
+    for (uint32_t position = 0; position < order.size(); ++position) {
+        BarrierBatch& batch = plan.passBarriers[position];
+
+        for (const auto& use : passes[order[position]].uses) {
+            ImageAccessInfo info = GetImageAccessInfo(use.access);
+            ImageState& state = states[use.image];
+
+            // A read in the current layout needs no barrier when nothing was written
+            // before it or an earlier read barrier already covers its stages and access.
+            // Its stages are remembered so the next write waits for them too.
+            bool transition = state.layout != info.layout;
+            bool covered = (info.stages & ~state.visibleStages) == 0 && (info.access & ~state.visibleAccess) == 0;
+            if (!transition && !info.write && (state.writeStages == 0 || covered)) {
+                state.readStages |= info.stages;
+                continue;
+            }
+
+            if (!images[use.image].imported && !firstUses[use.image]) {
+                firstUses[use.image] = FirstUse { position, batch.barriers.size() };
+            }
+
+            ImageBarrier barrier;
+            barrier.image = use.image;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = info.layout;
+            barrier.srcAccess = state.writeAccess;
+            barrier.dstAccess = info.access;
+            batch.barriers.push_back(barrier);
+
+            // Writes and transitions also wait for the reads before them, a read only for the write
+            batch.srcStages |= info.write || transition ? state.writeStages | state.readStages : state.writeStages;
+            batch.dstStages |= info.stages;
+
+            if (info.write) {
+                state = { info.layout, info.stages, info.access, 0, 0, 0 };
+            } else {
+                // The transition finishes before this barrier's stages, later reads chain through them
+                // and stay behind it even where an earlier barrier made the contents visible.
+                // The write it synchronized remains the source of their barriers.
+                if (transition) {
+                    state.layout = info.layout;
+                    state.writeStages |= info.stages;
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    state.visibleAccess = 0;
+                }
+                state.readStages |= info.stages;
+                state.visibleStages |= info.stages;
+                state.visibleAccess |= info.access;
+            }
+        }
+    }
+
+    // A transient image starts out undefined, but it has to wait for the image that
+    // used its memory before: an earlier alias, or its own use in the previous frame
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (!firstUses[i]) {
+            continue;
+        }
+
+        const ImageState& predecessor = states[images[i].aliasPredecessor];
+        BarrierBatch& batch = plan.passBarriers[firstUses[i]->position];
+
+        batch.barriers[firstUses[i]->barrier].srcAccess = predecessor.writeAccess;
+        batch.srcStages |= predecessor.writeStages | predecessor.readStages;
+    }
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        const PlanImage& image = images[i];
+        const ImageState& state = states[i];
+
+        if (!image.imported || state.layout == image.finalLayout) {
+            continue;
+        }
+
+        ImageBarrier barrier;
+        barrier.image = static_cast<uint32_t>(i);
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = image.finalLayout;
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstAccess = 0;
+        plan.finalBarriers.barriers.push_back(barrier);
+
+        plan.finalBarriers.srcStages |= state.writeStages | state.readStages;
+        plan.finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+
+    return plan;
+}
+
+} // namespace nex
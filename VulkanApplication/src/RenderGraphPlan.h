@@ -0,0 +1,105 @@
+#ifndef __VulkanApp_RenderGraphPlan_H__
+#define __VulkanApp_RenderGraphPlan_H__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace nex {
+
+// How a pass uses an image, which decides the layout, stages and access masks
+// of the barriers the graph places around the pass
+enum class ImageAccess {
+    ColorAttachment,
+    DepthAttachment,
+    // Depth tested against, not written
+    DepthRead,
+    FragmentSampled,
+    ComputeSampled,
+    ComputeStorageRead,
+    ComputeStorageWrite,
+    TransferSrc,
+    TransferDst,
+};
+
+struct ImageAccessInfo {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stages = 0;
+    VkAccessFlags access = 0;
+    VkImageUsageFlags usage = 0;
+    bool write = false;
+};
+
+ImageAccessInfo GetImageAccessInfo(ImageAccess access);
+
+// The part of a render graph that decides which passes run and which barriers
+// go between them. It works on image and pass indices only and creates no
+// Vulkan objects; RenderGraph keeps one PlanPass per pass and one PlanImage per
+// image and turns the results into render passes and vkCmdPipelineBarrier calls.
+
+struct ImageUse {
+    uint32_t image = 0;
+    ImageAccess access = ImageAccess::ColorAttachment;
+    // Attachments loaded with LOAD_OP_LOAD and all reads depend on earlier contents
+    bool readsContents = false;
+    // Replaces the whole image, earlier contents are dead afterwards
+    bool overwrites = false;
+};
+
+struct PlanPass {
+    std::vector<ImageUse> uses;
+    // The pass is kept even when nothing reads what it writes
+    bool sideEffects = false;
+};
+
+struct PlanImage {
+    // Owned outside the graph, its contents leave the graph after the last pass
+    bool imported = false;
+
+    // State an imported image is in when the graph starts executing, and the layout it is left in
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags initialAccess = 0;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    // Transient image that used the same memory before this one, itself when it has the memory alone
+    uint32_t aliasPredecessor = 0;
+};
+
+struct ImageBarrier {
+    uint32_t image = 0;
+    VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkAccessFlags srcAccess = 0;
+    VkAccessFlags dstAccess = 0;
+};
+
+// Barriers recorded in one vkCmdPipelineBarrier
+struct BarrierBatch {
+    std::vector<ImageBarrier> barriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+};
+
+struct BarrierPlan {
+    // Recorded before the pass at the same position of the execution order
+    std::vector<BarrierBatch> passBarriers;
+    // Moves imported images into their final layout after the last pass
+    BarrierBatch finalBarriers;
+};
+
+// Indices of the passes that survive culling, in execution order. Walks the
+// passes backwards from what leaves the graph: imported images and passes with
+// side effects.
+std::vector<uint32_t> CullPasses(const std::vector<PlanPass>& passes, const std::vector<PlanImage>& images);
+
+// Whether a pass after position in order reads what the image holds at that point
+bool ContentsNeededAfter(const std::vector<PlanPass>& passes, const std::vector<uint32_t>& order,
+                         const std::vector<PlanImage>& images, uint32_t image, uint32_t position);
+
+BarrierPlan PlanBarriers(const std::vector<PlanPass>& passes, const std::vector<uint32_t>& order, const std::vector<PlanImage>& images);
+
+} // namespace nex
+
+#endif // __VulkanApp_RenderGraphPlan_H__
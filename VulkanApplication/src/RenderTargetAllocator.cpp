@@ -0,0 +1,198 @@
+#include "RenderTargetAllocator.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace nex {
+
+VkImageAspectFlags FormatAspectMask(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+void RenderTargetAllocator::init(VkMemoryAllocator& allocator) {
+    m_allocator = &allocator;
+    m_vkDevice = allocator.device();
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = allocator.memoryProperties();
+    for (uint32_t memoryTypeIdx = 0; memoryTypeIdx < memoryProperties.memoryTypeCount; ++memoryTypeIdx) {
+        if (memoryProperties.memoryTypes[memoryTypeIdx].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            m_lazyMemoryTypeBits |= 1u << memoryTypeIdx;
+        }
+    }
+}
+
+std::vector<RenderTarget> RenderTargetAllocator::allocate(const std::vector<RenderTargetDesc>& descs, RenderTargetSet& set) {
+    m_stats = {};
+
+    std::vector<RenderTarget> targets(descs.size());
+    std::vector<VkMemoryRequirements> requirements(descs.size());
+
+    for (size_t i = 0; i < descs.size(); ++i) {
+        const RenderTargetDesc& desc = descs[i];
+
+        bool lazy = desc.transientContents && supportsLazyAllocation();
+
+        VkImageCreateInfo imageCreateInfo {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = desc.format;
+        imageCreateInfo.extent = { desc.extent.width, desc.extent.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = desc.samples;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = desc.usage | (lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (VkResult result = vkCreateImage(m_vkDevice, &imageCreateInfo, nullptr, &targets[i].image); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render target " + desc.name);
+        }
+        set.images.push_back(targets[i].image);
+
+        vkGetImageMemoryRequirements(m_vkDevice, targets[i].image, &requirements[i]);
+
+        // The transient usage may still rule out every lazily allocated type
+        targets[i].lazilyAllocated = lazy && (requirements[i].memoryTypeBits & m_lazyMemoryTypeBits) != 0;
+        targets[i].aliasPredecessor = static_cast<uint32_t>(i);
+
+        ++m_stats.targetCount;
+        m_stats.requestedBytes += requirements[i].size;
+    }
+
+    // Lazily allocated targets get memory of their own: it costs nothing until a
+    // tile spills, and sharing it would only make the spills collide
+    for (size_t i = 0; i < descs.size(); ++i) {
+        if (!targets[i].lazilyAllocated) {
+            continue;
+        }
+
+        MemoryAllocation allocation = m_allocator->allocate(requirements[i], AllocationKind::Optimal, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        set.memory.push_back(allocation);
+
+        if (VkResult result = vkBindImageMemory(m_vkDevice, targets[i].image, allocation.memory, allocation.offset); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to bind render target " + descs[i].name);
+        }
+
+        ++m_stats.lazilyAllocatedCount;
+        m_stats.lazilyAllocatedBytes += requirements[i].size;
+    }
+
+    // Largest first, each target goes into the first memory region none of whose
+    // targets is alive at the same time and whose memory types it can live in
+    std::vector<uint32_t> order(descs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&requirements](uint32_t lhs, uint32_t rhs) {
+        return requirements[lhs].size > requirements[rhs].size;
+    });
+
+    struct MemoryRegion {
+        VkMemoryRequirements requirements {};
+        std::vector<uint32_t> targets;
+    };
+    std::vector<MemoryRegion> regions;
+
+    for (uint32_t targetIdx : order) {
+        if (targets[targetIdx].lazilyAllocated) {
+            continue;
+        }
+
+        const RenderTargetDesc& desc = descs[targetIdx];
+
+        auto fits = [&](const MemoryRegion& region) {
+            if ((region.requirements.memoryTypeBits & requirements[targetIdx].memoryTypeBits) == 0) {
+                return false;
+            }
+            return std::none_of(region.targets.begin(), region.targets.end(), [&](uint32_t other) {
+                return desc.firstUse <= descs[other].lastUse && descs[other].firstUse <= desc.lastUse;
+            });
+        };
+
+        auto iter = std::find_if(regions.begin(), regions.end(), fits);
+        if (iter == regions.end()) {
+            regions.push_back({ requirements[targetIdx], {} });
+            iter = regions.end() - 1;
+        }
+
+        iter->requirements.size = std::max(iter->requirements.size, requirements[targetIdx].size);
+        iter->requirements.alignment = std::max(iter->requirements.alignment, requirements[targetIdx].alignment);
+        iter->requirements.memoryTypeBits &= requirements[targetIdx].memoryTypeBits;
+        iter->targets.push_back(targetIdx);
+    }
+
+    for (auto& region : regions) {
+        MemoryAllocation allocation = m_allocator->allocate(region.requirements, AllocationKind::Optimal, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        set.memory.push_back(allocation);
+
+        ++m_stats.memoryRegionCount;
+        m_stats.allocatedBytes += region.requirements.size;
+
+        std::sort(region.targets.begin(), region.targets.end(), [&descs](uint32_t lhs, uint32_t rhs) {
+            return descs[lhs].firstUse < descs[rhs].firstUse;
+        });
+
+        for (size_t i = 0; i < region.targets.size(); ++i) {
+            uint32_t targetIdx = region.targets[i];
+            targets[targetIdx].aliasPredecessor = region.targets[(i + region.targets.size() - 1) % region.targets.size()];
+
+            if (VkResult result = vkBindImageMemory(m_vkDevice, targets[targetIdx].image, allocation.memory, allocation.offset); result != VK_SUCCESS) {
+                throw std::runtime_error("Failed to bind render target " + descs[targetIdx].name);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < descs.size(); ++i) {
+        targets[i].imageView = createImageView(targets[i].image, descs[i].format);
+        set.imageViews.push_back(targets[i].imageView);
+    }
+
+    return targets;
+}
+
+void RenderTargetAllocator::destroy(RenderTargetSet& set) {
+    for (auto& imageView : set.imageViews) {
+        vkDestroyImageView(m_vkDevice, imageView, nullptr);
+    }
+    for (auto& image : set.images) {
+        vkDestroyImage(m_vkDevice, image, nullptr);
+    }
+    for (auto& allocation : set.memory) {
+        m_allocator->free(allocation);
+    }
+
+    set = {};
+}
+
+VkImageView RenderTargetAllocator::createImageView(VkImage image, VkFormat format) {
+    VkImageViewCreateInfo imageViewCreateInfo {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = format;
+    imageViewCreateInfo.subresourceRange.aspectMask = FormatAspectMask(format);
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateImageView(m_vkDevice, &imageViewCreateInfo, nullptr, &imageView); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render target image view");
+    }
+
+    return imageView;
+}
+
+} // namespace nex
@@ -0,0 +1,105 @@
+#ifndef __VulkanApp_RenderTargetAllocator_H__
+#define __VulkanApp_RenderTargetAllocator_H__
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+// Transient image needed by the render graph during a frame
+struct RenderTargetDesc {
+    std::string name;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent {};
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageUsageFlags usage = 0;
+
+    // Positions in execution order of the first and last pass using the target
+    uint32_t firstUse = 0;
+    uint32_t lastUse = 0;
+
+    // Only ever used as an attachment that is neither loaded nor stored, so its
+    // contents never leave tile memory on tiled GPUs
+    bool transientContents = false;
+};
+
+struct RenderTarget {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    bool lazilyAllocated = false;
+
+    // Index of the target that used the same memory before this one; the first
+    // one follows the last, which used the memory during the previous frame.
+    // A target with memory of its own is its own predecessor.
+    uint32_t aliasPredecessor = 0;
+};
+
+// Vulkan objects of one allocate() call, destroyed together
+struct RenderTargetSet {
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+    std::vector<MemoryAllocation> memory;
+};
+
+struct RenderTargetStats {
+    uint32_t targetCount = 0;
+    uint32_t lazilyAllocatedCount = 0;
+    uint32_t memoryRegionCount = 0;
+    // Memory the targets would take with one allocation each
+    VkDeviceSize requestedBytes = 0;
+    // Regular device memory actually allocated once targets share memory; lazily
+    // allocated targets are not included and count as saved
+    VkDeviceSize allocatedBytes = 0;
+    // Lazily allocated memory, only backed when a tile has to be spilled
+    VkDeviceSize lazilyAllocatedBytes = 0;
+
+    VkDeviceSize savedBytes() const {
+        return requestedBytes - allocatedBytes;
+    }
+};
+
+// Creates the render graph's transient images. Targets whose contents never
+// leave a render pass get TRANSIENT_ATTACHMENT usage and lazily allocated
+// memory where the device has it. The rest share memory regions whenever
+// their pass ranges do not overlap.
+class RenderTargetAllocator {
+public:
+    RenderTargetAllocator() = default;
+
+    void init(VkMemoryAllocator& allocator);
+
+    // Returns the targets in the order of descs, their objects are added to set
+    std::vector<RenderTarget> allocate(const std::vector<RenderTargetDesc>& descs, RenderTargetSet& set);
+    void destroy(RenderTargetSet& set);
+
+    // Whether any memory type is lazily allocated, which in practice means a tiled GPU
+    bool supportsLazyAllocation() const {
+        return m_lazyMemoryTypeBits != 0;
+    }
+
+    // Of the last allocate() call
+    const RenderTargetStats& stats() const {
+        return m_stats;
+    }
+
+private:
+    VkImageView createImageView(VkImage image, VkFormat format);
+
+private:
+    VkMemoryAllocator* m_allocator = nullptr;
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    uint32_t m_lazyMemoryTypeBits = 0;
+
+    RenderTargetStats m_stats;
+};
+
+// Depth and stencil aspects for depth formats, color otherwise
+VkImageAspectFlags FormatAspectMask(VkFormat format);
+
+} // namespace nex
+
+#endif // __VulkanApp_RenderTargetAllocator_H__
@@ -0,0 +1,223 @@
+#include "ShaderHotReloader.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace nex {
+
+namespace {
+
+// Editors save in several steps, changes are collected until the directory is quiet this long
+constexpr int DebounceMs = 100;
+// How often the watcher checks for destroy()
+constexpr int StopPollMs = 250;
+
+// Matches the names add_compileShaders_target gives the SPIR-V
+constexpr std::string_view AssetPrefix = "assets/";
+constexpr std::string_view SpirvExtension = ".spv";
+
+constexpr std::array<std::string_view, 6> StageExtensions { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+
+bool IsStageFile(const std::filesystem::path& filepath) {
+    return std::find(StageExtensions.begin(), StageExtensions.end(), filepath.extension().string()) != StageExtensions.end();
+}
+
+// Editor swap, backup and probe files
+bool IsIgnored(std::string_view filename) {
+    return filename.empty() || filename.front() == '.' || filename.back() == '~' || filename.find('.') == std::string_view::npos;
+}
+
+// Runs a program without a shell, returns true when it exits with 0. Output holds its stdout and stderr.
+bool RunProcess(const std::vector<std::string>& args, std::string& output) {
+    int pipeFds[2];
+    if (::pipe2(pipeFds, O_CLOEXEC) != 0) {
+        output = std::string("Failed to create a pipe: ") + std::strerror(errno);
+        return false;
+    }
+
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_adddup2(&fileActions, pipeFds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, pipeFds[1], STDERR_FILENO);
+
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    int error = ::posix_spawnp(&pid, argv[0], &fileActions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    ::close(pipeFds[1]);
+
+    if (error != 0) {
+        ::close(pipeFds[0]);
+        output = "Failed to run " + args[0] + ": " + std::strerror(error);
+        return false;
+    }
+
+    char buffer[4096];
+    ssize_t bytesRead = 0;
+    while ((bytesRead = ::read(pipeFds[0], buffer, sizeof(buffer))) > 0 || (bytesRead < 0 && errno == EINTR)) {
+        if (bytesRead > 0) {
+            output.append(buffer, static_cast<size_t>(bytesRead));
+        }
+    }
+    ::close(pipeFds[0]);
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace
+
+ShaderHotReloader::~ShaderHotReloader() {
+    destroy();
+}
+
+void ShaderHotReloader::init(const std::string& sourceDirectory, const std::string& outputDirectory, const std::string& compilerPath) {
+    m_sourceDirectory = sourceDirectory;
+    m_outputDirectory = outputDirectory;
+    m_compilerPath = compilerPath;
+
+    std::filesystem::create_directories(m_outputDirectory);
+
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        throw std::runtime_error(std::string("Failed to initialize inotify: ") + std::strerror(errno));
+    }
+
+    // Written in place or renamed over the old file, depending on the editor
+    if (::inotify_add_watch(m_inotifyFd, m_sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        int error = errno;
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+        throw std::runtime_error("Failed to watch " + m_sourceDirectory + ": " + std::strerror(error));
+    }
+
+    m_stop = false;
+    m_thread = std::thread([this]() { watchLoop(); });
+}
+
+void ShaderHotReloader::destroy() {
+    if (m_inotifyFd < 0) {
+        return;
+    }
+
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    ::close(m_inotifyFd);
+    m_inotifyFd = -1;
+}
+
+std::vector<CompiledShader> ShaderHotReloader::takeCompiled() {
+    std::vector<CompiledShader> compiled;
+
+    std::lock_guard<std::mutex> lock(m_compiledMutex);
+    compiled.swap(m_compiled);
+    return compiled;
+}
+
+void ShaderHotReloader::watchLoop() {
+    // Large enough for several events with maximum length names
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    std::set<std::string> changedFiles;
+
+    while (!m_stop) {
+        pollfd pollFd { m_inotifyFd, POLLIN, 0 };
+        int ready = ::poll(&pollFd, 1, changedFiles.empty() ? StopPollMs : DebounceMs);
+
+        if (ready > 0) {
+            ssize_t length = 0;
+            while ((length = ::read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (ssize_t offset = 0; offset < length;) {
+                    const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                    if (event->len > 0 && !IsIgnored(event->name)) {
+                        changedFiles.insert(event->name);
+                    }
+                    offset += sizeof(inotify_event) + event->len;
+                }
+            }
+        } else if (ready == 0 && !changedFiles.empty()) {
+            compileChanged(changedFiles);
+            changedFiles.clear();
+        }
+    }
+}
+
+void ShaderHotReloader::compileChanged(const std::set<std::string>& changedFiles) {
+    std::set<std::string> stageFiles;
+    for (const auto& filename : changedFiles) {
+        if (IsStageFile(filename)) {
+            stageFiles.insert(filename);
+            continue;
+        }
+
+        // An include, which any shader may use
+        std::error_code errorCode;
+        for (const auto& entry : std::filesystem::directory_iterator(m_sourceDirectory, errorCode)) {
+            if (entry.is_regular_file() && IsStageFile(entry.path())) {
+                stageFiles.insert(entry.path().filename().string());
+            }
+        }
+    }
+
+    for (const auto& filename : stageFiles) {
+        CompiledShader compiled;
+        if (compile(filename, compiled)) {
+            std::cout << "[reload] Recompiled " << filename << std::endl;
+
+            std::lock_guard<std::mutex> lock(m_compiledMutex);
+            m_compiled.push_back(std::move(compiled));
+        }
+    }
+}
+
+bool ShaderHotReloader::compile(const std::string& sourceFilename, CompiledShader& compiled) {
+    std::string spirvFilename = sourceFilename + std::string(SpirvExtension);
+    std::string sourcePath = (std::filesystem::path(m_sourceDirectory) / sourceFilename).string();
+    std::string outputPath = (std::filesystem::path(m_outputDirectory) / spirvFilename).string();
+    std::string tmpOutputPath = outputPath + ".tmp";
+
+    std::string output;
+    if (!RunProcess({ m_compilerPath, "--target-env=vulkan1.2", sourcePath, "-o", tmpOutputPath }, output)) {
+        std::cerr << "[reload] " << sourceFilename << " failed to compile, keeping the previous version:\n" << output << std::flush;
+        return false;
+    }
+
+    // Renamed over the previous output, so its existing mappings stay valid
+    std::error_code errorCode;
+    std::filesystem::rename(tmpOutputPath, outputPath, errorCode);
+    if (errorCode) {
+        std::cerr << "[reload] Failed to write " << outputPath << ": " << errorCode.message() << std::endl;
+        return false;
+    }
+
+    compiled.name = std::string(AssetPrefix) + spirvFilename;
+    compiled.filepath = outputPath;
+    return true;
+}
+
+} // namespace nex
@@ -0,0 +1,60 @@
+#ifndef __VulkanApp_ShaderHotReloader_H__
+#define __VulkanApp_ShaderHotReloader_H__
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nex {
+
+// SPIR-V written by a runtime recompilation
+struct CompiledShader {
+    // Asset name the pipelines refer to, e.g. assets/triangle.vert.spv
+    std::string name;
+    std::string filepath;
+};
+
+// Watches the GLSL sources with inotify and recompiles changed shaders with
+// glslc on a background thread, the same way the build does. A changed
+// include recompiles every shader in the directory. Compile errors are
+// printed and leave the previous SPIR-V in use.
+class ShaderHotReloader {
+public:
+    ShaderHotReloader() = default;
+    ~ShaderHotReloader();
+
+    ShaderHotReloader(const ShaderHotReloader&) = delete;
+    ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+    // Compiled SPIR-V goes to outputDirectory, throws when the sources cannot be watched
+    void init(const std::string& sourceDirectory, const std::string& outputDirectory, const std::string& compilerPath);
+    void destroy();
+
+    // Shaders recompiled since the last call
+    std::vector<CompiledShader> takeCompiled();
+
+private:
+    void watchLoop();
+    void compileChanged(const std::set<std::string>& changedFiles);
+    // Returns false and prints the compiler output on failure
+    bool compile(const std::string& sourceFilename, CompiledShader& compiled);
+
+private:
+    std::string m_sourceDirectory;
+    std::string m_outputDirectory;
+    std::string m_compilerPath;
+
+    int m_inotifyFd = -1;
+    std::atomic<bool> m_stop = false;
+    std::thread m_thread;
+
+    std::mutex m_compiledMutex;
+    std::vector<CompiledShader> m_compiled;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_ShaderHotReloader_H__
@@ -0,0 +1,637 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace nex {
+
+namespace {
+
+constexpr uint32_t SpirvMagic = 0x07230203;
+constexpr size_t HeaderWords = 5;
+
+// Opcodes, decorations and enumerants of the SPIR-V specification that the reflection reads
+enum Op : uint32_t {
+    OpName = 5,
+    OpEntryPoint = 15,
+    OpExecutionMode = 16,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpConstantComposite = 44,
+    OpSpecConstantTrue = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant = 50,
+    OpSpecConstantComposite = 51,
+    OpFunction = 54,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+};
+
+enum Decoration : uint32_t {
+    DecorationSpecId = 1,
+    DecorationBufferBlock = 3,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationLocation = 30,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+    StorageClassUniformConstant = 0,
+    StorageClassInput = 1,
+    StorageClassUniform = 2,
+    StorageClassPushConstant = 9,
+    StorageClassStorageBuffer = 12,
+};
+
+constexpr uint32_t ExecutionModeLocalSize = 17;
+constexpr uint32_t BuiltInWorkgroupSize = 25;
+constexpr uint32_t DimBuffer = 5;
+constexpr uint32_t DimSubpassData = 6;
+
+struct Decorations {
+    std::optional<uint32_t> location;
+    std::optional<uint32_t> binding;
+    std::optional<uint32_t> set;
+    std::optional<uint32_t> specId;
+    std::optional<uint32_t> builtIn;
+    bool bufferBlock = false;
+    uint32_t arrayStride = 0;
+};
+
+struct MemberDecorations {
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+    bool builtIn = false;
+};
+
+struct Type {
+    uint32_t op = 0;
+    // Int and float width, int signedness
+    uint32_t width = 0;
+    bool isSigned = false;
+    // Vector, matrix and array element, pointer pointee
+    uint32_t elementType = 0;
+    // Vector components, matrix columns, array length id
+    uint32_t count = 0;
+    uint32_t storageClass = 0;
+    // Image
+    uint32_t dim = 0;
+    uint32_t sampled = 0;
+    std::vector<uint32_t> members;
+};
+
+struct Variable {
+    uint32_t id = 0;
+    uint32_t pointerType = 0;
+    uint32_t storageClass = 0;
+};
+
+class SpirvModule {
+public:
+    SpirvModule(const uint32_t* code, size_t wordCount) {
+        if (wordCount < HeaderWords || code[0] != SpirvMagic) {
+            throw std::runtime_error("Not a SPIR-V module");
+        }
+
+        for (size_t pos = HeaderWords; pos < wordCount;) {
+            uint32_t length = code[pos] >> 16;
+            uint32_t opcode = code[pos] & 0xFFFF;
+            if (length == 0 || length > wordCount - pos) {
+                throw std::runtime_error("Truncated SPIR-V instruction");
+            }
+
+            // Everything describing the interface precedes the function bodies
+            if (opcode == OpFunction) {
+                break;
+            }
+            parse(opcode, code + pos, length);
+            pos += length;
+        }
+
+        if (!m_entryPoint) {
+            throw std::runtime_error("SPIR-V module has no entry point");
+        }
+    }
+
+    ShaderReflection reflect() const {
+        ShaderReflection reflection;
+        reflection.stage = m_stage;
+        reflection.localSize = m_localSize;
+        if (m_workgroupSize) {
+            for (size_t i = 0; i < reflection.localSize.size(); ++i) {
+                uint32_t component = (*m_workgroupSize)[i];
+                reflection.localSize[i] = m_specConstants.count(component) > 0 ? 0 : constantValue(component);
+            }
+        }
+
+        for (const auto& variable : m_variables) {
+            const Decorations& decorations = decorationsOf(variable.id);
+            uint32_t pointee = type(variable.pointerType).elementType;
+
+            switch (variable.storageClass) {
+            case StorageClassInput:
+                if (m_interface.count(variable.id) > 0 && decorations.location && !decorations.builtIn && !hasBuiltInMember(pointee)) {
+                    reflection.inputs.push_back(reflectInput(variable, pointee, *decorations.location));
+                }
+                break;
+            case StorageClassUniformConstant:
+            case StorageClassUniform:
+            case StorageClassStorageBuffer:
+                if (decorations.binding) {
+                    reflection.bindings.push_back(reflectBinding(variable, pointee, decorations));
+                }
+                break;
+            case StorageClassPushConstant:
+                reflection.pushConstantSize = std::max(reflection.pushConstantSize, sizeOf(pointee));
+                break;
+            }
+        }
+
+        for (const auto& [id, decorations] : m_decorations) {
+            if (decorations.specId && m_specConstants.count(id) > 0) {
+                reflection.specConstants.push_back({ *decorations.specId, nameOf(id) });
+            }
+        }
+        std::sort(reflection.specConstants.begin(), reflection.specConstants.end(),
+                  [](const ReflectedSpecConstant& lhs, const ReflectedSpecConstant& rhs) { return lhs.id < rhs.id; });
+
+        std::sort(reflection.inputs.begin(), reflection.inputs.end(),
+                  [](const ReflectedInput& lhs, const ReflectedInput& rhs) { return lhs.location < rhs.location; });
+
+        mergeAliasedBindings(reflection.bindings);
+
+        return reflection;
+    }
+
+private:
+    void parse(uint32_t opcode, const uint32_t* words, uint32_t length) {
+        switch (opcode) {
+        case OpName:
+            if (length >= 2) {
+                m_names[words[1]] = readString(words + 2, length - 2);
+            }
+            break;
+        case OpEntryPoint:
+            // Only the first entry point is reflected
+            if (!m_entryPoint && length >= 4) {
+                m_stage = stageOf(words[1]);
+                m_entryPoint = words[2];
+                size_t nameWords = readString(words + 3, length - 3).size() / 4 + 1;
+                for (size_t i = 3 + nameWords; i < length; ++i) {
+                    m_interface.insert(words[i]);
+                }
+            }
+            break;
+        case OpExecutionMode:
+            if (length >= 6 && m_entryPoint && words[1] == *m_entryPoint && words[2] == ExecutionModeLocalSize) {
+                m_localSize = { words[3], words[4], words[5] };
+            }
+            break;
+        case OpTypeBool:
+        case OpTypeSampler:
+            defineType(words, length, {});
+            break;
+        case OpTypeInt:
+        case OpTypeFloat: {
+            Type scalar;
+            scalar.width = length >= 3 ? words[2] : 0;
+            scalar.isSigned = opcode == OpTypeInt && length >= 4 && words[3] != 0;
+            defineType(words, length, scalar);
+            break;
+        }
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeArray: {
+            Type composite;
+            composite.elementType = length >= 3 ? words[2] : 0;
+            composite.count = length >= 4 ? words[3] : 0;
+            defineType(words, length, composite);
+            break;
+        }
+        case OpTypeRuntimeArray:
+        case OpTypeSampledImage: {
+            Type wrapper;
+            wrapper.elementType = length >= 3 ? words[2] : 0;
+            defineType(words, length, wrapper);
+            break;
+        }
+        case OpTypeImage: {
+            Type image;
+            image.dim = length >= 4 ? words[3] : 0;
+            image.sampled = length >= 8 ? words[7] : 0;
+            defineType(words, length, image);
+            break;
+        }
+        case OpTypeStruct: {
+            Type structure;
+            if (length >= 2) {
+                structure.members.assign(words + 2, words + length);
+            }
+            defineType(words, length, structure);
+            break;
+        }
+        case OpTypePointer: {
+            Type pointer;
+            pointer.storageClass = length >= 3 ? words[2] : 0;
+            pointer.elementType = length >= 4 ? words[3] : 0;
+            defineType(words, length, pointer);
+            break;
+        }
+        case OpConstant:
+        case OpSpecConstant:
+            if (length >= 4) {
+                m_constants[words[2]] = words[3];
+            }
+            if (opcode == OpSpecConstant && length >= 3) {
+                m_specConstants.insert(words[2]);
+            }
+            break;
+        case OpSpecConstantTrue:
+        case OpSpecConstantFalse:
+            if (length >= 3) {
+                m_specConstants.insert(words[2]);
+            }
+            break;
+        case OpConstantComposite:
+        case OpSpecConstantComposite:
+            // A WorkgroupSize builtin overrides the LocalSize execution mode
+            if (length >= 6 && decorationsOf(words[2]).builtIn == BuiltInWorkgroupSize) {
+                m_workgroupSize = { words[3], words[4], words[5] };
+            }
+            break;
+        case OpVariable:
+            if (length >= 4) {
+                m_variables.push_back({ words[2], words[1], words[3] });
+            }
+            break;
+        case OpDecorate:
+            if (length >= 3) {
+                decorate(words[1], words[2], length >= 4 ? words[3] : 0);
+            }
+            break;
+        case OpMemberDecorate:
+            if (length >= 4) {
+                MemberDecorations& member = m_memberDecorations[words[1]][words[2]];
+                uint32_t value = length >= 5 ? words[4] : 0;
+                if (words[3] == DecorationOffset) {
+                    member.offset = value;
+                } else if (words[3] == DecorationMatrixStride) {
+                    member.matrixStride = value;
+                } else if (words[3] == DecorationBuiltIn) {
+                    member.builtIn = true;
+                }
+            }
+            break;
+        }
+    }
+
+    void defineType(const uint32_t* words, uint32_t length, Type type) {
+        if (length < 2) {
+            throw std::runtime_error("Truncated SPIR-V type");
+        }
+        type.op = words[0] & 0xFFFF;
+        m_types[words[1]] = std::move(type);
+    }
+
+    void decorate(uint32_t id, uint32_t decoration, uint32_t value) {
+        Decorations& decorations = m_decorations[id];
+        switch (decoration) {
+        case DecorationSpecId:
+            decorations.specId = value;
+            break;
+        case DecorationBufferBlock:
+            decorations.bufferBlock = true;
+            break;
+        case DecorationArrayStride:
+            decorations.arrayStride = value;
+            break;
+        case DecorationBuiltIn:
+            decorations.builtIn = value;
+            break;
+        case DecorationLocation:
+            decorations.location = value;
+            break;
+        case DecorationBinding:
+            decorations.binding = value;
+            break;
+        case DecorationDescriptorSet:
+            decorations.set = value;
+            break;
+        }
+    }
+
+    static std::string readString(const uint32_t* words, size_t wordCount) {
+        std::string string;
+        for (size_t i = 0; i < wordCount; ++i) {
+            for (uint32_t byte = 0; byte < 4; ++byte) {
+                char c = static_cast<char>((words[i] >> (8 * byte)) & 0xFF);
+                if (c == '\0') {
+                    return string;
+                }
+                string.push_back(c);
+            }
+        }
+        throw std::runtime_error("Unterminated SPIR-V string");
+    }
+
+    static VkShaderStageFlagBits stageOf(uint32_t executionModel) {
+        switch (executionModel) {
+        case 0:
+            return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1:
+            return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2:
+            return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3:
+            return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4:
+            return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5:
+            return VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        throw std::runtime_error("Unsupported SPIR-V execution model " + std::to_string(executionModel));
+    }
+
+    const Type& type(uint32_t id) const {
+        auto iter = m_types.find(id);
+        if (iter == m_types.end()) {
+            throw std::runtime_error("SPIR-V references undefined type %" + std::to_string(id));
+        }
+        return iter->second;
+    }
+
+    const Decorations& decorationsOf(uint32_t id) const {
+        static const Decorations None;
+        auto iter = m_decorations.find(id);
+        return iter != m_decorations.end() ? iter->second : None;
+    }
+
+    const MemberDecorations& memberDecorationsOf(uint32_t structId, uint32_t member) const {
+        static const MemberDecorations None;
+        auto structIter = m_memberDecorations.find(structId);
+        if (structIter == m_memberDecorations.end()) {
+            return None;
+        }
+        auto memberIter = structIter->second.find(member);
+        return memberIter != structIter->second.end() ? memberIter->second : None;
+    }
+
+    std::string nameOf(uint32_t id) const {
+        auto iter = m_names.find(id);
+        return iter != m_names.end() ? iter->second : std::string();
+    }
+
+    uint32_t constantValue(uint32_t id) const {
+        auto iter = m_constants.find(id);
+        if (iter == m_constants.end()) {
+            throw std::runtime_error("SPIR-V array length is not a constant");
+        }
+        return iter->second;
+    }
+
+    // Blocks like gl_PerVertex carry the builtin decorations on their members
+    bool hasBuiltInMember(uint32_t typeId) const {
+        const Type& structure = type(typeId);
+        if (structure.op != OpTypeStruct) {
+            return false;
+        }
+        for (uint32_t member = 0; member < structure.members.size(); ++member) {
+            if (memberDecorationsOf(typeId, member).builtIn) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Bytes the type occupies in an explicitly laid out block
+    uint32_t sizeOf(uint32_t typeId) const {
+        const Type& t = type(typeId);
+        switch (t.op) {
+        case OpTypeBool:
+            return 4;
+        case OpTypeInt:
+        case OpTypeFloat:
+            return t.width / 8;
+        case OpTypeVector:
+            return t.count * sizeOf(t.elementType);
+        case OpTypeMatrix:
+            return t.count * sizeOf(t.elementType);
+        case OpTypeArray: {
+            uint32_t stride = decorationsOf(typeId).arrayStride;
+            return constantValue(t.count) * (stride > 0 ? stride : sizeOf(t.elementType));
+        }
+        case OpTypeRuntimeArray:
+            return 0;
+        case OpTypeStruct: {
+            uint32_t size = 0;
+            for (uint32_t member = 0; member < t.members.size(); ++member) {
+                const MemberDecorations& decorations = memberDecorationsOf(typeId, member);
+                const Type& memberType = type(t.members[member]);
+                uint32_t memberSize = memberType.op == OpTypeMatrix && decorations.matrixStride > 0
+                                    ? memberType.count * decorations.matrixStride
+                                    : sizeOf(t.members[member]);
+                size = std::max(size, decorations.offset + memberSize);
+            }
+            return size;
+        }
+        }
+        return 0;
+    }
+
+    ReflectedInput reflectInput(const Variable& variable, uint32_t typeId, uint32_t location) const {
+        ReflectedInput input;
+        input.location = location;
+        input.name = nameOf(variable.id);
+
+        const Type* t = &type(typeId);
+        input.componentCount = 1;
+        if (t->op == OpTypeVector) {
+            input.componentCount = t->count;
+            t = &type(t->elementType);
+        }
+
+        switch (t->op) {
+        case OpTypeFloat:
+            input.baseType = ShaderBaseType::Float;
+            break;
+        case OpTypeInt:
+            input.baseType = t->isSigned ? ShaderBaseType::Int : ShaderBaseType::Uint;
+            break;
+        case OpTypeBool:
+            input.baseType = ShaderBaseType::Bool;
+            break;
+        default:
+            input.componentCount = 0;
+            break;
+        }
+        return input;
+    }
+
+    ReflectedBinding reflectBinding(const Variable& variable, uint32_t typeId, const Decorations& decorations) const {
+        ReflectedBinding binding;
+        binding.set = decorations.set.value_or(0);
+        binding.binding = *decorations.binding;
+        binding.name = nameOf(variable.id);
+
+        const Type* t = &type(typeId);
+        if (t->op == OpTypeArray) {
+            binding.count = constantValue(t->count);
+            typeId = t->elementType;
+            t = &type(typeId);
+        } else if (t->op == OpTypeRuntimeArray) {
+            binding.count = 0;
+            typeId = t->elementType;
+            t = &type(typeId);
+        }
+
+        switch (t->op) {
+        case OpTypeImage:
+            if (t->dim == DimSubpassData) {
+                binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            } else if (t->sampled == 2) {
+                binding.type = t->dim == DimBuffer ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            } else {
+                binding.type = t->dim == DimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            break;
+        case OpTypeSampler:
+            binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            break;
+        case OpTypeSampledImage:
+            binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            break;
+        case OpTypeStruct:
+            // Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+            binding.type = variable.storageClass == StorageClassStorageBuffer || decorationsOf(typeId).bufferBlock
+                         ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                         : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            break;
+        default:
+            throw std::runtime_error("Unsupported descriptor type of " + binding.name);
+        }
+        return binding;
+    }
+
+    static void mergeAliasedBindings(std::vector<ReflectedBinding>& bindings) {
+        std::stable_sort(bindings.begin(), bindings.end(), [](const ReflectedBinding& lhs, const ReflectedBinding& rhs) {
+            return lhs.set != rhs.set ? lhs.set < rhs.set : lhs.binding < rhs.binding;
+        });
+
+        std::vector<ReflectedBinding> merged;
+        for (auto& binding : bindings) {
+            if (!merged.empty() && merged.back().set == binding.set && merged.back().binding == binding.binding) {
+                ReflectedBinding& previous = merged.back();
+                if (previous.type != binding.type) {
+                    throw std::runtime_error(binding.name + " and " + previous.name + " alias set " + std::to_string(binding.set)
+                                             + " binding " + std::to_string(binding.binding) + " with different descriptor types");
+                }
+                // A runtime sized array covers any fixed count
+                previous.count = previous.count == 0 || binding.count == 0 ? 0 : std::max(previous.count, binding.count);
+                continue;
+            }
+            merged.push_back(std::move(binding));
+        }
+        bindings = std::move(merged);
+    }
+
+private:
+    std::optional<uint32_t> m_entryPoint;
+    VkShaderStageFlagBits m_stage = VK_SHADER_STAGE_ALL;
+    std::unordered_set<uint32_t> m_interface;
+    std::array<uint32_t, 3> m_localSize {};
+    // Constituent ids of the WorkgroupSize builtin
+    std::optional<std::array<uint32_t, 3>> m_workgroupSize;
+
+    std::unordered_map<uint32_t, std::string> m_names;
+    std::unordered_map<uint32_t, Decorations> m_decorations;
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, MemberDecorations>> m_memberDecorations;
+    std::unordered_map<uint32_t, Type> m_types;
+    std::unordered_map<uint32_t, uint32_t> m_constants;
+    std::unordered_set<uint32_t> m_specConstants;
+    std::vector<Variable> m_variables;
+};
+
+} // namespace
+
+ShaderReflection ReflectSpirv(const uint32_t* code, size_t wordCount) {
+    return SpirvModule(code, wordCount).reflect();
+}
+
+const char* ShaderBaseTypeName(ShaderBaseType type) {
+    switch (type) {
+    case ShaderBaseType::Float:
+        return "float";
+    case ShaderBaseType::Int:
+        return "int";
+    case ShaderBaseType::Uint:
+        return "uint";
+    case ShaderBaseType::Bool:
+        return "bool";
+    case ShaderBaseType::Unknown:
+        break;
+    }
+    return "unknown";
+}
+
+ShaderBaseType FormatBaseType(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32B32_SFLOAT:
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return ShaderBaseType::Float;
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R16_SINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+        return ShaderBaseType::Int;
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32B32_UINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+        return ShaderBaseType::Uint;
+    default:
+        return ShaderBaseType::Unknown;
+    }
+}
+
+} // namespace nex
@@ -0,0 +1,70 @@
+#ifndef __VulkanApp_ShaderReflection_H__
+#define __VulkanApp_ShaderReflection_H__
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nex {
+
+enum class ShaderBaseType {
+    Unknown,
+    Float,
+    Int,
+    Uint,
+    Bool,
+};
+
+// User defined stage input, builtins are left out
+struct ReflectedInput {
+    uint32_t location = 0;
+    ShaderBaseType baseType = ShaderBaseType::Unknown;
+    // 1 for scalars, 0 when the input is neither a scalar nor a vector
+    uint32_t componentCount = 0;
+    std::string name;
+};
+
+struct ReflectedBinding {
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    // 0 for runtime sized arrays
+    uint32_t count = 1;
+    std::string name;
+};
+
+struct ReflectedSpecConstant {
+    uint32_t id = 0;
+    std::string name;
+};
+
+// Interface of one entry point, as far as pipeline creation cares
+struct ShaderReflection {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+    std::vector<ReflectedInput> inputs;
+    // Sorted by set and binding. Variables aliasing one binding, like the
+    // bindless storage buffer blocks, are merged into one entry.
+    std::vector<ReflectedBinding> bindings;
+    // Bytes up to the end of the last push constant member, 0 without a push constant block
+    uint32_t pushConstantSize = 0;
+    std::vector<ReflectedSpecConstant> specConstants;
+    // Compute shaders only, 0 where specialized with local_size_*_id
+    std::array<uint32_t, 3> localSize {};
+};
+
+// Reads the first entry point of a SPIR-V module, throws on malformed code.
+// Only the instructions describing the interface are interpreted.
+ShaderReflection ReflectSpirv(const uint32_t* code, size_t wordCount);
+
+const char* ShaderBaseTypeName(ShaderBaseType type);
+
+// Numeric type a vertex attribute format delivers to the shader, Unknown for formats not covered
+ShaderBaseType FormatBaseType(VkFormat format);
+
+} // namespace nex
+
+#endif // __VulkanApp_ShaderReflection_H__
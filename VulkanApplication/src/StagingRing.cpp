@@ -0,0 +1,43 @@
+#include "StagingRing.h"
+
+#include <stdexcept>
+
+namespace nex {
+
+void StagingRing::init(VkDeviceSize size) {
+    m_size = size;
+    m_head = 0;
+    m_used = 0;
+}
+
+std::optional<StagingRing::Allocation> StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment) {
+    if (size > m_size) {
+        throw std::invalid_argument("Staging allocation is larger than the staging ring");
+    }
+
+    // Nothing is in flight, so the whole ring is free wherever the head was left
+    if (m_used == 0) {
+        m_head = 0;
+    }
+
+    VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+    if (offset + size > m_size) {
+        offset = 0;
+    }
+
+    VkDeviceSize consumed = offset >= m_head ? offset + size - m_head : m_size - m_head + size;
+
+    if (m_used + consumed > m_size) {
+        return std::nullopt;
+    }
+
+    m_head = offset + size;
+    m_used += consumed;
+    return Allocation { offset, consumed };
+}
+
+void StagingRing::release(VkDeviceSize consumed) {
+    m_used -= consumed;
+}
+
+} // namespace nex
@@ -0,0 +1,48 @@
+#ifndef __VulkanApp_StagingRing_H__
+#define __VulkanApp_StagingRing_H__
+
+#include <vulkan/vulkan.h>
+
+#include <optional>
+
+namespace nex {
+
+// Offset bookkeeping of the staging ring, without the buffer behind it. Space
+// is handed out at the head and given back in the order it was handed out.
+class StagingRing {
+public:
+    struct Allocation {
+        VkDeviceSize offset = 0;
+        // Includes the bytes skipped for alignment and at the end of the ring,
+        // they are released together with the allocation
+        VkDeviceSize consumed = 0;
+    };
+
+    void init(VkDeviceSize size);
+
+    // Empty when the ring has no room right now. A size up to the whole ring always fits once the ring is empty.
+    std::optional<Allocation> tryAllocate(VkDeviceSize size, VkDeviceSize alignment);
+    void release(VkDeviceSize consumed);
+
+    VkDeviceSize size() const {
+        return m_size;
+    }
+
+    VkDeviceSize used() const {
+        return m_used;
+    }
+
+    // Largest piece uploads are split into, half the ring so that one always fits after wrapping around
+    VkDeviceSize maxChunkSize() const {
+        return m_size / 2;
+    }
+
+private:
+    VkDeviceSize m_size = 0;
+    VkDeviceSize m_head = 0;
+    VkDeviceSize m_used = 0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_StagingRing_H__
@@ -0,0 +1,367 @@
+#include "StagingUploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace nex {
+
+namespace {
+
+// Satisfies optimalBufferCopyOffsetAlignment and texel alignment of every format we upload
+constexpr VkDeviceSize StagingAlignment = 16;
+
+} // namespace
+
+StagingUploader::~StagingUploader() {
+    destroy();
+}
+
+void StagingUploader::init(VkMemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily,
+                           uint32_t graphicsFamily, VkDeviceSize stagingSize) {
+    m_allocator = &allocator;
+    m_vkDevice = allocator.device();
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_graphicsFamily = graphicsFamily;
+    m_stagingRing.init(stagingSize);
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = m_transferFamily;
+
+    if (VkResult result = vkCreateCommandPool(m_vkDevice, &commandPoolCreateInfo, nullptr, &m_commandPool); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create transfer command pool");
+    }
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = stagingSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_stagingBuffer = m_allocator->createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void StagingUploader::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    auto destroyBatch = [this](std::unique_ptr<UploadBatch>& batch) {
+        vkDestroyFence(m_vkDevice, batch->fence, nullptr);
+        vkDestroySemaphore(m_vkDevice, batch->semaphore, nullptr);
+    };
+
+    if (m_recording) {
+        destroyBatch(m_recording);
+        m_recording.reset();
+    }
+    for (auto& batch : m_submitted) {
+        destroyBatch(batch);
+    }
+    m_submitted.clear();
+    for (auto& batch : m_freeBatches) {
+        destroyBatch(batch);
+    }
+    m_freeBatches.clear();
+
+    vkDestroyCommandPool(m_vkDevice, m_commandPool, nullptr);
+    m_allocator->destroyBuffer(m_stagingBuffer);
+
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+void StagingUploader::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                                   VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    const char* src = static_cast<const char*>(data);
+
+    // Large uploads are split, each chunk waits for ring space on its own
+    for (VkDeviceSize copied = 0; copied < size;) {
+        VkDeviceSize chunkSize = std::min(size - copied, m_stagingRing.maxChunkSize());
+        VkDeviceSize stagingOffset = allocateStaging(chunkSize);
+
+        std::memcpy(static_cast<char*>(m_stagingBuffer.allocation.mapped) + stagingOffset, src + copied, chunkSize);
+        m_allocator->flush(m_stagingBuffer.allocation, stagingOffset, chunkSize);
+
+        VkBufferCopy bufferCopy {};
+        bufferCopy.srcOffset = stagingOffset;
+        bufferCopy.dstOffset = dstOffset + copied;
+        bufferCopy.size = chunkSize;
+        vkCmdCopyBuffer(recordingBatch().commandBuffer, m_stagingBuffer.buffer, dstBuffer, 1, &bufferCopy);
+
+        copied += chunkSize;
+    }
+
+    UploadBatch& batch = recordingBatch();
+    batch.dstStages |= dstStage;
+
+    if (!ownershipTransfer()) {
+        // Same family: the semaphore alone orders the copy before the first use
+        return;
+    }
+
+    VkBufferMemoryBarrier releaseBarrier {};
+    releaseBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    releaseBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    releaseBarrier.dstAccessMask = 0;
+    releaseBarrier.srcQueueFamilyIndex = m_transferFamily;
+    releaseBarrier.dstQueueFamilyIndex = m_graphicsFamily;
+    releaseBarrier.buffer = dstBuffer;
+    releaseBarrier.offset = dstOffset;
+    releaseBarrier.size = size;
+
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 1, &releaseBarrier, 0, nullptr);
+
+    VkBufferMemoryBarrier acquireBarrier = releaseBarrier;
+    acquireBarrier.srcAccessMask = 0;
+    acquireBarrier.dstAccessMask = dstAccess;
+    batch.acquireBarriers.push_back(acquireBarrier);
+}
+
+void StagingUploader::beginImageLevel(VkImage image, uint32_t mipLevel) {
+    VkImageMemoryBarrier imageBarrier {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(recordingBatch().commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &imageBarrier);
+}
+
+bool StagingUploader::tryUploadImage(VkImage image, uint32_t mipLevel, VkOffset3D offset, VkExtent3D extent,
+                                     const void* data, VkDeviceSize size) {
+    if (size > maxUploadSize()) {
+        throw std::invalid_argument("Image upload of " + std::to_string(size) + " bytes exceeds the maximum of "
+                                    + std::to_string(maxUploadSize()) + " bytes");
+    }
+
+    std::optional<VkDeviceSize> stagingOffset = tryAllocateStaging(size);
+    if (!stagingOffset) {
+        return false;
+    }
+
+    std::memcpy(static_cast<char*>(m_stagingBuffer.allocation.mapped) + *stagingOffset, data, size);
+    m_allocator->flush(m_stagingBuffer.allocation, *stagingOffset, size);
+
+    VkBufferImageCopy imageCopy {};
+    imageCopy.bufferOffset = *stagingOffset;
+    imageCopy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 };
+    imageCopy.imageOffset = offset;
+    imageCopy.imageExtent = extent;
+    vkCmdCopyBufferToImage(recordingBatch().commandBuffer, m_stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
+
+    return true;
+}
+
+void StagingUploader::endImageLevel(VkImage image, uint32_t mipLevel, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    UploadBatch& batch = recordingBatch();
+    batch.dstStages |= dstStage;
+
+    if (!ownershipTransfer()) {
+        return;
+    }
+
+    VkImageMemoryBarrier releaseBarrier {};
+    releaseBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    releaseBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    releaseBarrier.dstAccessMask = 0;
+    releaseBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    releaseBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    releaseBarrier.srcQueueFamilyIndex = m_transferFamily;
+    releaseBarrier.dstQueueFamilyIndex = m_graphicsFamily;
+    releaseBarrier.image = image;
+    releaseBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &releaseBarrier);
+
+    VkImageMemoryBarrier acquireBarrier = releaseBarrier;
+    acquireBarrier.srcAccessMask = 0;
+    acquireBarrier.dstAccessMask = dstAccess;
+    batch.imageAcquireBarriers.push_back(acquireBarrier);
+}
+
+void StagingUploader::flush() {
+    if (!m_recording) {
+        return;
+    }
+
+    if (VkResult result = vkEndCommandBuffer(m_recording->commandBuffer); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_recording->commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_recording->semaphore;
+
+    if (VkResult result = vkQueueSubmit(m_transferQueue, 1, &submitInfo, m_recording->fence); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+    }
+
+    m_recording->recording = false;
+    m_submitted.push_back(std::move(m_recording));
+}
+
+std::vector<VkSemaphore> StagingUploader::acquire(VkCommandBuffer graphicsCommandBuffer, std::vector<VkPipelineStageFlags>& waitStages) {
+    std::vector<VkSemaphore> waitSemaphores;
+
+    for (auto& batch : m_submitted) {
+        if (batch->semaphoreConsumed) {
+            continue;
+        }
+
+        VkPipelineStageFlags dstStages = batch->dstStages ? batch->dstStages : VkPipelineStageFlags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        if (!batch->acquireBarriers.empty() || !batch->imageAcquireBarriers.empty()) {
+            vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0,
+                                 0, nullptr, batch->acquireBarriers.size(), batch->acquireBarriers.data(),
+                                 batch->imageAcquireBarriers.size(), batch->imageAcquireBarriers.data());
+        }
+
+        waitSemaphores.push_back(batch->semaphore);
+        waitStages.push_back(dstStages);
+        batch->semaphoreConsumed = true;
+    }
+
+    retireBatches(false);
+
+    return waitSemaphores;
+}
+
+StagingUploader::UploadBatch& StagingUploader::recordingBatch() {
+    if (m_recording) {
+        return *m_recording;
+    }
+
+    if (!m_freeBatches.empty()) {
+        m_recording = std::move(m_freeBatches.back());
+        m_freeBatches.pop_back();
+    } else {
+        m_recording = std::make_unique<UploadBatch>();
+
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo {};
+        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.commandPool = m_commandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+
+        if (VkResult result = vkAllocateCommandBuffers(m_vkDevice, &commandBufferAllocateInfo, &m_recording->commandBuffer); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer");
+        }
+
+        VkFenceCreateInfo fenceCreateInfo {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (VkResult result = vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &m_recording->fence); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence");
+        }
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        if (VkResult result = vkCreateSemaphore(m_vkDevice, &semaphoreCreateInfo, nullptr, &m_recording->semaphore); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload semaphore");
+        }
+    }
+
+    UploadBatch& batch = *m_recording;
+    batch.stagingBytes = 0;
+    batch.dstStages = 0;
+    batch.acquireBarriers.clear();
+    batch.imageAcquireBarriers.clear();
+    batch.recording = true;
+    batch.semaphoreConsumed = false;
+
+    VkCommandBufferBeginInfo commandBufferBeginInfo {};
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(batch.commandBuffer, 0);
+    if (VkResult result = vkBeginCommandBuffer(batch.commandBuffer, &commandBufferBeginInfo); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin upload command buffer");
+    }
+
+    return batch;
+}
+
+void StagingUploader::retireBatches(bool wait) {
+    // Staging space is released strictly in submission order
+    for (auto& batch : m_submitted) {
+        if (batch->stagingBytes == 0) {
+            continue;
+        }
+
+        if (vkGetFenceStatus(m_vkDevice, batch->fence) != VK_SUCCESS) {
+            if (!wait) {
+                break;
+            }
+            vkWaitForFences(m_vkDevice, 1, &batch->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+            wait = false;
+        }
+
+        m_stagingRing.release(batch->stagingBytes);
+        batch->stagingBytes = 0;
+    }
+
+    // A batch can be recorded again once its staging space is back and its
+    // semaphore wait has been submitted, otherwise the semaphore would be re-signaled early
+    for (auto iter = m_submitted.begin(); iter != m_submitted.end();) {
+        UploadBatch& batch = **iter;
+
+        if (batch.stagingBytes == 0 && batch.semaphoreConsumed && vkGetFenceStatus(m_vkDevice, batch.fence) == VK_SUCCESS) {
+            vkResetFences(m_vkDevice, 1, &batch.fence);
+            m_freeBatches.push_back(std::move(*iter));
+            iter = m_submitted.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+VkDeviceSize StagingUploader::allocateStaging(VkDeviceSize size) {
+    while (true) {
+        if (std::optional<VkDeviceSize> offset = tryAllocateStaging(size)) {
+            return *offset;
+        }
+
+        // The ring is full: push out what is recorded and wait for the oldest upload
+        flush();
+
+        // Waiting only helps while a submitted batch still holds staging space
+        bool stagingInFlight = std::any_of(m_submitted.begin(), m_submitted.end(),
+                                           [](const std::unique_ptr<UploadBatch>& batch) { return batch->stagingBytes > 0; });
+        if (!stagingInFlight) {
+            throw std::runtime_error("Staging upload of " + std::to_string(size) + " bytes does not fit into the staging buffer");
+        }
+        retireBatches(true);
+    }
+}
+
+std::optional<VkDeviceSize> StagingUploader::tryAllocateStaging(VkDeviceSize size) {
+    retireBatches(false);
+
+    std::optional<StagingRing::Allocation> allocation = m_stagingRing.tryAllocate(size, StagingAlignment);
+    if (!allocation) {
+        return std::nullopt;
+    }
+
+    // Bytes skipped for alignment or at the end of the ring count as used until the batch retires
+    recordingBatch().stagingBytes += allocation->consumed;
+    return allocation->offset;
+}
+
+} // namespace nex
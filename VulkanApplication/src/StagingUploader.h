@@ -0,0 +1,106 @@
+#ifndef __VulkanApp_StagingUploader_H__
+#define __VulkanApp_StagingUploader_H__
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "StagingRing.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+// Copies data into DEVICE_LOCAL resources through a host visible staging ring.
+// Copies are recorded on the transfer queue family when the device has a
+// dedicated one, and handed over to the graphics family with queue family
+// ownership transfers. The graphics submission that first uses the uploaded
+// data waits on the semaphores returned by acquire().
+class StagingUploader {
+public:
+    static constexpr VkDeviceSize DefaultStagingSize = 16ull * 1024 * 1024;
+
+    StagingUploader() = default;
+    ~StagingUploader();
+
+    StagingUploader(const StagingUploader&) = delete;
+    StagingUploader& operator=(const StagingUploader&) = delete;
+
+    void init(VkMemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily,
+              uint32_t graphicsFamily, VkDeviceSize stagingSize = DefaultStagingSize);
+    void destroy();
+
+    // dstStage/dstAccess describe the first use of the buffer on the graphics queue
+    void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                      VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    // Image uploads go per mip level of a single-layer color image: beginImageLevel moves
+    // the level to TRANSFER_DST_OPTIMAL, any number of tryUploadImage calls fill it and
+    // endImageLevel hands it over to the graphics family, still in TRANSFER_DST_OPTIMAL
+    void beginImageLevel(VkImage image, uint32_t mipLevel);
+    // Returns false without blocking when the staging ring has no room right now,
+    // size must not exceed maxUploadSize()
+    bool tryUploadImage(VkImage image, uint32_t mipLevel, VkOffset3D offset, VkExtent3D extent, const void* data, VkDeviceSize size);
+    void endImageLevel(VkImage image, uint32_t mipLevel, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    // Submits everything recorded so far to the transfer queue
+    void flush();
+
+    // Records the acquire side of the ownership transfers into a graphics command
+    // buffer and returns the semaphores its submission has to wait on
+    std::vector<VkSemaphore> acquire(VkCommandBuffer graphicsCommandBuffer, std::vector<VkPipelineStageFlags>& waitStages);
+
+    // Largest single image upload, buffer uploads are split into pieces of this size
+    VkDeviceSize maxUploadSize() const {
+        return m_stagingRing.maxChunkSize();
+    }
+
+    bool ownershipTransfer() const {
+        return m_transferFamily != m_graphicsFamily;
+    }
+
+private:
+    struct UploadBatch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+
+        // Staging bytes consumed by this batch, including the wasted tail on wrap around
+        VkDeviceSize stagingBytes = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkBufferMemoryBarrier> acquireBarriers;
+        std::vector<VkImageMemoryBarrier> imageAcquireBarriers;
+
+        bool recording = false;
+        bool semaphoreConsumed = false;
+    };
+
+    UploadBatch& recordingBatch();
+    void retireBatches(bool wait);
+    VkDeviceSize allocateStaging(VkDeviceSize size);
+    // Retires finished batches but never waits, empty when the ring is full
+    std::optional<VkDeviceSize> tryAllocateStaging(VkDeviceSize size);
+
+private:
+    VkMemoryAllocator* m_allocator = nullptr;
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_graphicsFamily = 0;
+
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+
+    AllocatedBuffer m_stagingBuffer;
+    StagingRing m_stagingRing;
+
+    std::unique_ptr<UploadBatch> m_recording;
+    // Submitted batches in submission order, the staging ring is released in the same order
+    std::deque<std::unique_ptr<UploadBatch>> m_submitted;
+    std::vector<std::unique_ptr<UploadBatch>> m_freeBatches;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_StagingUploader_H__
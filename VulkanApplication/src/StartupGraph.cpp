@@ -0,0 +1,188 @@
+#include "StartupGraph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#include "Profiler.h"
+
+namespace nex {
+
+StartupGraph::StartupGraph(TaskScheduler& scheduler)
+    : m_scheduler(scheduler)
+{}
+
+StartupGraph::PhaseId StartupGraph::addPhase(std::string name, PhaseThread thread, std::vector<PhaseId> dependencies, std::function<void()> func) {
+    PhaseId id = static_cast<PhaseId>(m_phases.size());
+    for (PhaseId dependency : dependencies) {
+        if (dependency >= id) {
+            throw std::invalid_argument("Startup phase " + name + " depends on a phase added after it");
+        }
+    }
+
+    Phase phase;
+    phase.timing.name = std::move(name);
+    phase.timing.thread = thread;
+    phase.dependencies = std::move(dependencies);
+    phase.func = std::move(func);
+    m_phases.push_back(std::move(phase));
+
+    return id;
+}
+
+void StartupGraph::run() {
+    utils::Stopwatch stopwatch;
+
+    std::vector<TaskHandle> tasks(m_phases.size());
+    std::vector<bool> started(m_phases.size(), false);
+
+    auto mainDependenciesDone = [this, &started](const Phase& phase) {
+        return std::all_of(phase.dependencies.begin(), phase.dependencies.end(), [&](PhaseId dependency) {
+            return m_phases[dependency].timing.thread != PhaseThread::Main || started[dependency];
+        });
+    };
+
+    for (PhaseId next = 0;; ++next) {
+        // Worker phases are handed to the scheduler as soon as the main phases they need are done,
+        // the scheduler holds them back until their worker dependencies have finished
+        for (PhaseId id = 0; id < m_phases.size(); ++id) {
+            const Phase& phase = m_phases[id];
+            if (phase.timing.thread != PhaseThread::Worker || started[id] || !mainDependenciesDone(phase)) {
+                continue;
+            }
+
+            std::vector<TaskHandle> dependencies;
+            for (PhaseId dependency : phase.dependencies) {
+                if (tasks[dependency]) {
+                    dependencies.push_back(tasks[dependency]);
+                }
+            }
+            tasks[id] = m_scheduler.spawn([this, id, &stopwatch]() { execute(id, stopwatch); }, nullptr, dependencies);
+            started[id] = true;
+        }
+
+        while (next < m_phases.size() && m_phases[next].timing.thread != PhaseThread::Main) {
+            ++next;
+        }
+        if (next == m_phases.size()) {
+            break;
+        }
+
+        for (PhaseId dependency : m_phases[next].dependencies) {
+            if (tasks[dependency]) {
+                m_scheduler.wait(tasks[dependency]);
+            }
+        }
+        execute(next, stopwatch);
+        started[next] = true;
+    }
+
+    // Phases catch their own errors, so waiting never throws and nothing is left running
+    for (const auto& task : tasks) {
+        if (task) {
+            m_scheduler.wait(task);
+        }
+    }
+
+    m_wallMs = stopwatch.elapsedMs();
+    markCriticalPath();
+
+    for (const auto& phase : m_phases) {
+        if (phase.error) {
+            std::rethrow_exception(phase.error);
+        }
+    }
+}
+
+std::vector<StartupPhaseTiming> StartupGraph::timings() const {
+    std::vector<StartupPhaseTiming> timings;
+    for (const auto& phase : m_phases) {
+        timings.push_back(phase.timing);
+    }
+    return timings;
+}
+
+void StartupGraph::report(std::ostream& out) const {
+    double phaseMs = 0.0;
+    for (const auto& phase : m_phases) {
+        phaseMs += phase.timing.durationMs;
+    }
+
+    out << "[startup] " << m_phases.size() << " phases in " << m_wallMs << " ms wall, " << phaseMs
+        << " ms summed; critical path marked with *:\n";
+
+    std::vector<const Phase*> byStart;
+    for (const auto& phase : m_phases) {
+        byStart.push_back(&phase);
+    }
+    std::stable_sort(byStart.begin(), byStart.end(),
+                     [](const Phase* lhs, const Phase* rhs) { return lhs->timing.startMs < rhs->timing.startMs; });
+
+    for (const Phase* phase : byStart) {
+        const StartupPhaseTiming& timing = phase->timing;
+        out << "  " << (timing.critical ? '*' : ' ') << ' ' << std::left << std::setw(20) << timing.name << std::right;
+        if (timing.skipped) {
+            out << " skipped\n";
+            continue;
+        }
+        out << std::fixed << std::setprecision(3)
+            << " at " << std::setw(9) << timing.startMs << " ms, took " << std::setw(9) << timing.durationMs << " ms"
+            << (timing.thread == PhaseThread::Main ? " (main)" : " (worker)") << (phase->failed ? " failed" : "") << '\n';
+    }
+    out << std::defaultfloat << std::flush;
+}
+
+void StartupGraph::execute(PhaseId id, const utils::Stopwatch& stopwatch) {
+    Phase& phase = m_phases[id];
+
+    bool dependencyFailed = std::any_of(phase.dependencies.begin(), phase.dependencies.end(), [this](PhaseId dependency) {
+        return m_phases[dependency].failed;
+    });
+    if (dependencyFailed) {
+        phase.timing.skipped = true;
+        phase.failed = true;
+        return;
+    }
+
+    phase.timing.startMs = stopwatch.elapsedMs();
+    {
+        // Shows up in the trace next to the per-frame scopes
+        ScopedCpuTimer phaseTimer(phase.timing.name.c_str());
+        try {
+            phase.func();
+        } catch (...) {
+            phase.error = std::current_exception();
+            phase.failed = true;
+        }
+    }
+    phase.endMs = stopwatch.elapsedMs();
+    phase.timing.durationMs = phase.endMs - phase.timing.startMs;
+}
+
+void StartupGraph::markCriticalPath() {
+    if (m_phases.empty()) {
+        return;
+    }
+
+    auto latest = [this](auto begin, auto end) {
+        return std::max_element(begin, end, [this](PhaseId lhs, PhaseId rhs) { return m_phases[lhs].endMs < m_phases[rhs].endMs; });
+    };
+
+    std::vector<PhaseId> all(m_phases.size());
+    for (PhaseId id = 0; id < all.size(); ++id) {
+        all[id] = id;
+    }
+
+    // Walk back from the last phase to finish through the dependency that finished last
+    PhaseId current = *latest(all.begin(), all.end());
+    while (true) {
+        Phase& phase = m_phases[current];
+        phase.timing.critical = true;
+        if (phase.dependencies.empty()) {
+            break;
+        }
+        current = *latest(phase.dependencies.begin(), phase.dependencies.end());
+    }
+}
+
+} // namespace nex
@@ -0,0 +1,84 @@
+#ifndef __VulkanApp_StartupGraph_H__
+#define __VulkanApp_StartupGraph_H__
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "Utils.h"
+
+namespace nex {
+
+enum class PhaseThread {
+    // Window system calls that have to stay on the main thread
+    Main,
+    Worker,
+};
+
+struct StartupPhaseTiming {
+    std::string name;
+    PhaseThread thread = PhaseThread::Worker;
+    // Relative to the start of run()
+    double startMs = 0.0;
+    double durationMs = 0.0;
+    // Not run because a dependency failed
+    bool skipped = false;
+    // On the chain of dependencies that decided when the last phase finished
+    bool critical = false;
+};
+
+// Initialization as a graph of named phases. Worker phases run on the task
+// scheduler as soon as their dependencies are done; main phases run on the
+// calling thread in declaration order, which helps with other tasks while it
+// waits. Every phase is timed, and a failed phase skips those depending on it.
+class StartupGraph {
+public:
+    using PhaseId = uint32_t;
+
+    explicit StartupGraph(TaskScheduler& scheduler);
+
+    StartupGraph(const StartupGraph&) = delete;
+    StartupGraph& operator=(const StartupGraph&) = delete;
+
+    // Dependencies must have been added before, so the graph is acyclic by construction
+    PhaseId addPhase(std::string name, PhaseThread thread, std::vector<PhaseId> dependencies, std::function<void()> func);
+
+    // Returns once every phase has finished or been skipped, then rethrows the
+    // error of the first failed phase in declaration order
+    void run();
+
+    // Valid after run(), in declaration order
+    std::vector<StartupPhaseTiming> timings() const;
+
+    double wallMs() const {
+        return m_wallMs;
+    }
+
+    void report(std::ostream& out) const;
+
+private:
+    struct Phase {
+        StartupPhaseTiming timing;
+        std::vector<PhaseId> dependencies;
+        std::function<void()> func;
+        double endMs = 0.0;
+        std::exception_ptr error;
+        bool failed = false;
+    };
+
+    void execute(PhaseId id, const utils::Stopwatch& stopwatch);
+    void markCriticalPath();
+
+private:
+    TaskScheduler& m_scheduler;
+    std::vector<Phase> m_phases;
+    double m_wallMs = 0.0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_StartupGraph_H__
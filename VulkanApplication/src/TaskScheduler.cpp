@@ -0,0 +1,374 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace nex {
+
+struct Task : std::enable_shared_from_this<Task> {
+    std::function<void()> func;
+    TaskCounter* counter = nullptr;
+
+    // One per unfinished dependency plus one held by spawn() while it registers them
+    std::atomic<uint32_t> pendingDependencies { 1 };
+
+    std::mutex mutex;
+    std::condition_variable finishedCondition;
+    std::vector<TaskHandle> continuations;
+    std::atomic<bool> finished { false };
+    std::exception_ptr exception;
+
+    // Keeps the task alive while it sits in a queue or runs
+    TaskHandle self;
+};
+
+namespace {
+
+thread_local TaskScheduler* t_scheduler = nullptr;
+thread_local int32_t t_workerIdx = -1;
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift64, only used to pick steal victims
+uint32_t NextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<uint32_t>(state);
+}
+
+} // namespace
+
+void TaskCounter::increment() {
+    m_value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TaskCounter::decrement() {
+    int64_t value = m_value.load(std::memory_order_relaxed);
+    while (value > 1) {
+        if (m_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    // The last decrement happens under the mutex: a waiter that saw zero takes the
+    // mutex before returning, so the counter cannot be destroyed while this notifies
+    std::lock_guard lock(m_mutex);
+    if (m_value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        m_condition.notify_all();
+    }
+}
+
+bool WorkStealingDeque::push(Task* task) {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+
+    if (bottom - top >= Capacity) {
+        return false;
+    }
+
+    m_buffer[bottom & (Capacity - 1)].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+Task* WorkStealingDeque::pop() {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Task* task = m_buffer[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+
+    // Last element: race the thieves for it
+    if (top == bottom) {
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return task;
+}
+
+Task* WorkStealingDeque::steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Task* task = m_buffer[top & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    return task;
+}
+
+TaskScheduler::TaskScheduler(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_statsEpochNs = NowNs();
+
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+
+    // Started only once every deque exists, workers steal from each other right away
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    m_stop = true;
+    {
+        std::lock_guard lock(m_sleepMutex);
+    }
+    m_sleepCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+TaskHandle TaskScheduler::spawn(std::function<void()> func, TaskCounter* counter, const std::vector<TaskHandle>& dependencies) {
+    TaskHandle task = std::make_shared<Task>();
+    task->func = std::move(func);
+    task->counter = counter;
+
+    if (counter) {
+        counter->increment();
+    }
+
+    for (const auto& dependency : dependencies) {
+        if (!dependency) {
+            continue;
+        }
+
+        std::lock_guard lock(dependency->mutex);
+        if (!dependency->finished) {
+            task->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+            dependency->continuations.push_back(task);
+        }
+    }
+
+    if (task->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        schedule(task.get());
+    }
+
+    return task;
+}
+
+void TaskScheduler::wait(TaskCounter& counter) {
+    uint64_t rngState = reinterpret_cast<uintptr_t>(&counter) | 1;
+
+    while (!counter.done()) {
+        if (Task* task = findTask(t_scheduler == this ? t_workerIdx : -1, rngState)) {
+            run(task, t_scheduler == this ? t_workerIdx : -1);
+            continue;
+        }
+
+        // Nothing left to help with, whatever is outstanding runs on other threads
+        std::unique_lock lock(counter.m_mutex);
+        counter.m_condition.wait(lock, [&counter]() { return counter.done(); });
+    }
+
+    // Lets the last decrement leave the mutex before the caller may destroy the counter
+    std::lock_guard lock(counter.m_mutex);
+}
+
+void TaskScheduler::wait(const TaskHandle& task) {
+    uint64_t rngState = reinterpret_cast<uintptr_t>(task.get()) | 1;
+
+    while (!task->finished) {
+        if (Task* other = findTask(t_scheduler == this ? t_workerIdx : -1, rngState)) {
+            run(other, t_scheduler == this ? t_workerIdx : -1);
+            continue;
+        }
+
+        std::unique_lock lock(task->mutex);
+        task->finishedCondition.wait(lock, [&task]() { return task->finished.load(); });
+    }
+
+    if (task->exception) {
+        std::rethrow_exception(task->exception);
+    }
+}
+
+std::vector<WorkerStats> TaskScheduler::workerStats() const {
+    double wallNs = static_cast<double>(NowNs() - m_statsEpochNs.load());
+
+    std::vector<WorkerStats> stats;
+    stats.reserve(m_workers.size());
+
+    for (const auto& worker : m_workers) {
+        WorkerStats workerStats;
+        workerStats.executed = worker->executed.load(std::memory_order_relaxed);
+        workerStats.stolen = worker->stolen.load(std::memory_order_relaxed);
+        workerStats.busyMs = worker->busyNs.load(std::memory_order_relaxed) / 1e6;
+        workerStats.utilisation = wallNs > 0.0 ? worker->busyNs.load(std::memory_order_relaxed) / wallNs : 0.0;
+        stats.push_back(workerStats);
+    }
+
+    return stats;
+}
+
+void TaskScheduler::resetStats() {
+    for (auto& worker : m_workers) {
+        worker->executed = 0;
+        worker->stolen = 0;
+        worker->busyNs = 0;
+    }
+    m_statsEpochNs = NowNs();
+}
+
+void TaskScheduler::workerLoop(uint32_t workerIdx) {
+    t_scheduler = this;
+    t_workerIdx = static_cast<int32_t>(workerIdx);
+
+    uint64_t rngState = 0x9e3779b97f4a7c15ull * (workerIdx + 1);
+
+    while (true) {
+        if (Task* task = findTask(t_workerIdx, rngState)) {
+            run(task, t_workerIdx);
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+
+        // Paired with schedule(): it bumps m_queuedTasks before reading m_sleepingWorkers,
+        // so either it sees this worker going to sleep or this worker sees the task
+        m_sleepingWorkers.fetch_add(1);
+        m_sleepCondition.wait(lock, [this]() { return m_stop || m_queuedTasks.load() > 0; });
+        m_sleepingWorkers.fetch_sub(1);
+
+        // Queued tasks are drained before shutting down
+        if (m_stop && m_queuedTasks.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::schedule(Task* task) {
+    task->self = task->shared_from_this();
+
+    m_queuedTasks.fetch_add(1);
+
+    bool pushed = t_scheduler == this && m_workers[t_workerIdx]->deque.push(task);
+    if (!pushed) {
+        std::lock_guard lock(m_injectionMutex);
+        m_injectionQueue.push_back(task);
+    }
+
+    if (m_sleepingWorkers.load() > 0) {
+        {
+            std::lock_guard lock(m_sleepMutex);
+        }
+        m_sleepCondition.notify_one();
+    }
+}
+
+Task* TaskScheduler::findTask(int32_t workerIdx, uint64_t& rngState) {
+    if (m_queuedTasks.load(std::memory_order_relaxed) <= 0) {
+        return nullptr;
+    }
+
+    if (workerIdx >= 0) {
+        if (Task* task = m_workers[workerIdx]->deque.pop()) {
+            m_queuedTasks.fetch_sub(1);
+            return task;
+        }
+    }
+
+    {
+        std::lock_guard lock(m_injectionMutex);
+        if (!m_injectionQueue.empty()) {
+            Task* task = m_injectionQueue.front();
+            m_injectionQueue.pop_front();
+            m_queuedTasks.fetch_sub(1);
+            return task;
+        }
+    }
+
+    uint32_t workerCount = static_cast<uint32_t>(m_workers.size());
+    uint32_t firstVictim = NextRandom(rngState) % workerCount;
+
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        uint32_t victim = (firstVictim + i) % workerCount;
+        if (static_cast<int32_t>(victim) == workerIdx) {
+            continue;
+        }
+
+        if (Task* task = m_workers[victim]->deque.steal()) {
+            m_queuedTasks.fetch_sub(1);
+            if (workerIdx >= 0) {
+                m_workers[workerIdx]->stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void TaskScheduler::run(Task* task, int32_t workerIdx) {
+    int64_t startNs = NowNs();
+
+    try {
+        task->func();
+    } catch (...) {
+        task->exception = std::current_exception();
+    }
+
+    if (workerIdx >= 0) {
+        Worker& worker = *m_workers[workerIdx];
+        worker.executed.fetch_add(1, std::memory_order_relaxed);
+        worker.busyNs.fetch_add(NowNs() - startNs, std::memory_order_relaxed);
+    }
+
+    finish(task);
+}
+
+void TaskScheduler::finish(Task* task) {
+    // Released at the end of the scope, after nothing touches the task anymore
+    TaskHandle self = std::move(task->self);
+
+    task->func = nullptr;
+
+    std::vector<TaskHandle> continuations;
+    {
+        std::lock_guard lock(task->mutex);
+        task->finished = true;
+        continuations.swap(task->continuations);
+    }
+    task->finishedCondition.notify_all();
+
+    for (auto& continuation : continuations) {
+        if (continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            schedule(continuation.get());
+        }
+    }
+
+    if (task->counter) {
+        task->counter->decrement();
+    }
+}
+
+} // namespace nex
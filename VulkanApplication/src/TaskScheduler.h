@@ -0,0 +1,157 @@
+#ifndef __VulkanApp_TaskScheduler_H__
+#define __VulkanApp_TaskScheduler_H__
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace nex {
+
+struct Task;
+using TaskHandle = std::shared_ptr<Task>;
+
+// Number of unfinished tasks spawned against it. Waiting on a counter lets the
+// waiting thread run other tasks and then sleep, it never spins.
+class TaskCounter {
+public:
+    TaskCounter() = default;
+
+    TaskCounter(const TaskCounter&) = delete;
+    TaskCounter& operator=(const TaskCounter&) = delete;
+
+    int64_t value() const {
+        return m_value.load(std::memory_order_acquire);
+    }
+
+    bool done() const {
+        return value() == 0;
+    }
+
+private:
+    friend class TaskScheduler;
+
+    void increment();
+    void decrement();
+
+private:
+    std::atomic<int64_t> m_value { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+// Lock-free Chase-Lev deque. The owning worker pushes and pops at the bottom,
+// other threads steal from the top. Capacity is fixed; a full deque makes the
+// owner fall back to the shared injection queue.
+class WorkStealingDeque {
+public:
+    static constexpr int64_t Capacity = 4096;
+
+    bool push(Task* task);
+    Task* pop();
+    Task* steal();
+
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    alignas(64) std::atomic<int64_t> m_top { 0 };
+    alignas(64) std::atomic<int64_t> m_bottom { 0 };
+    std::array<std::atomic<Task*>, Capacity> m_buffer {};
+};
+
+struct WorkerStats {
+    uint64_t executed = 0;
+    // Tasks taken from another worker's deque
+    uint64_t stolen = 0;
+    double busyMs = 0.0;
+    // Busy time over wall time since the statistics were last reset
+    double utilisation = 0.0;
+};
+
+// Work-stealing scheduler. Every worker owns a deque; tasks spawned on a worker
+// go to its own deque, tasks spawned elsewhere go to a shared injection queue.
+// Idle workers steal from random victims and sleep when there is no work.
+class TaskScheduler {
+public:
+    // 0 uses one worker per hardware thread
+    explicit TaskScheduler(uint32_t threadCount = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Runs func once every dependency has finished. The counter, if any, is
+    // incremented now and decremented when func returns.
+    TaskHandle spawn(std::function<void()> func, TaskCounter* counter = nullptr,
+                     const std::vector<TaskHandle>& dependencies = {});
+
+    // Runs other tasks while waiting and sleeps once there are none left to run
+    void wait(TaskCounter& counter);
+    // Also rethrows an exception thrown by the task
+    void wait(const TaskHandle& task);
+
+    template <typename Func>
+    auto submit(Func&& func) -> std::future<std::invoke_result_t<Func>> {
+        using Result = std::invoke_result_t<Func>;
+
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+        std::future<Result> future = packagedTask->get_future();
+
+        spawn([packagedTask]() { (*packagedTask)(); });
+
+        return future;
+    }
+
+    uint32_t threadCount() const {
+        return static_cast<uint32_t>(m_workers.size());
+    }
+
+    std::vector<WorkerStats> workerStats() const;
+    void resetStats();
+
+private:
+    struct Worker {
+        WorkStealingDeque deque;
+        std::thread thread;
+
+        std::atomic<uint64_t> executed { 0 };
+        std::atomic<uint64_t> stolen { 0 };
+        std::atomic<uint64_t> busyNs { 0 };
+    };
+
+    void workerLoop(uint32_t workerIdx);
+
+    void schedule(Task* task);
+    // Own deque first, then the injection queue, then the other workers
+    Task* findTask(int32_t workerIdx, uint64_t& rngState);
+    void run(Task* task, int32_t workerIdx);
+    void finish(Task* task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_injectionMutex;
+    std::deque<Task*> m_injectionQueue;
+
+    // Tasks sitting in any queue; workers only sleep when it is zero
+    std::atomic<int64_t> m_queuedTasks { 0 };
+    std::atomic<uint32_t> m_sleepingWorkers { 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::atomic<bool> m_stop { false };
+
+    std::atomic<int64_t> m_statsEpochNs { 0 };
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_TaskScheduler_H__
@@ -0,0 +1,561 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <stdexcept>
+
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace nex {
+
+namespace {
+
+// Sampled, blitted and filtered linearly, which every device supports for this format
+constexpr VkFormat TextureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+constexpr VkDeviceSize TexelSize = 4;
+
+// Upper bound of a single staging copy, so large levels spread over several frames
+constexpr VkDeviceSize MaxBandBytes = 1024 * 1024;
+
+// The CPU adds a level no larger than this to base-only images, it shows up first
+constexpr uint32_t PreviewSize = 64;
+
+// Table regions are bound as storage buffers at these offsets
+constexpr VkDeviceSize TableAlignment = 256;
+
+uint32_t MipExtent(uint32_t baseExtent, uint32_t level) {
+    return std::max(baseExtent >> level, 1u);
+}
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while ((std::max(width, height) >> levels) > 0) {
+        ++levels;
+    }
+    return levels;
+}
+
+// 2x2 box filter, edge texels are repeated for odd sizes
+DecodedLevel Downsample(const DecodedLevel& src) {
+    DecodedLevel dst;
+    dst.level = src.level + 1;
+    dst.width = std::max(src.width / 2, 1u);
+    dst.height = std::max(src.height / 2, 1u);
+    dst.pixels.resize(dst.width * dst.height * TexelSize);
+
+    for (uint32_t y = 0; y < dst.height; ++y) {
+        uint32_t y0 = std::min(2 * y, src.height - 1);
+        uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+
+        for (uint32_t x = 0; x < dst.width; ++x) {
+            uint32_t x0 = std::min(2 * x, src.width - 1);
+            uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+
+            for (uint32_t channel = 0; channel < TexelSize; ++channel) {
+                uint32_t sum = src.pixels[(y0 * src.width + x0) * TexelSize + channel] + src.pixels[(y0 * src.width + x1) * TexelSize + channel]
+                             + src.pixels[(y1 * src.width + x0) * TexelSize + channel] + src.pixels[(y1 * src.width + x1) * TexelSize + channel];
+                dst.pixels[(y * dst.width + x) * TexelSize + channel] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return dst;
+}
+
+// Base-only images get a coarse preview level, so they appear before the base level is uploaded
+void AddPreviewLevel(DecodedImage& image) {
+    if (image.levels.size() != 1 || image.levels.front().level != 0) {
+        return;
+    }
+
+    uint32_t previewLevel = 0;
+    while (std::max(MipExtent(image.width, previewLevel), MipExtent(image.height, previewLevel)) > PreviewSize) {
+        ++previewLevel;
+    }
+    if (previewLevel == 0) {
+        return;
+    }
+
+    DecodedLevel preview = Downsample(image.levels.front());
+    while (preview.level < previewLevel) {
+        preview = Downsample(preview);
+    }
+
+    image.levels.insert(image.levels.begin(), std::move(preview));
+}
+
+void ValidateImage(const DecodedImage& image) {
+    if (image.width == 0 || image.height == 0 || image.levels.empty()) {
+        throw std::runtime_error("Decoded image is empty");
+    }
+
+    uint32_t previousLevel = MipLevelCount(image.width, image.height);
+    for (const auto& level : image.levels) {
+        if (level.level >= previousLevel) {
+            throw std::runtime_error("Decoded levels are not sorted coarsest first");
+        }
+        if (level.width != MipExtent(image.width, level.level) || level.height != MipExtent(image.height, level.level)
+            || level.pixels.size() != level.width * level.height * TexelSize) {
+            throw std::runtime_error("Decoded level does not match the image size");
+        }
+        previousLevel = level.level;
+    }
+}
+
+VkImageMemoryBarrier LevelBarrier(VkImage image, uint32_t firstLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                  VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+    VkImageMemoryBarrier imageBarrier {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = srcAccess;
+    imageBarrier.dstAccessMask = dstAccess;
+    imageBarrier.oldLayout = oldLayout;
+    imageBarrier.newLayout = newLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, firstLevel, levelCount, 0, 1 };
+    return imageBarrier;
+}
+
+} // namespace
+
+DecodedImage DecodePpm(const char* data, size_t size) {
+    size_t pos = 0;
+
+    // Header tokens are separated by whitespace, comments run to the end of the line
+    auto nextToken = [data, size, &pos]() {
+        while (pos < size) {
+            if (data[pos] == '#') {
+                while (pos < size && data[pos] != '\n') {
+                    ++pos;
+                }
+            } else if (std::isspace(static_cast<unsigned char>(data[pos]))) {
+                ++pos;
+            } else {
+                break;
+            }
+        }
+
+        size_t begin = pos;
+        while (pos < size && !std::isspace(static_cast<unsigned char>(data[pos]))) {
+            ++pos;
+        }
+        return std::string(data + begin, pos - begin);
+    };
+
+    if (nextToken() != "P6") {
+        throw std::runtime_error("Not a binary PPM image");
+    }
+
+    DecodedImage image;
+    image.width = std::stoul(nextToken());
+    image.height = std::stoul(nextToken());
+    if (std::stoul(nextToken()) != 255) {
+        throw std::runtime_error("Only 8 bit PPM images are supported");
+    }
+    // A single whitespace character separates the header from the pixels
+    ++pos;
+
+    size_t texelCount = size_t(image.width) * image.height;
+    if (pos > size || size - pos < texelCount * 3) {
+        throw std::runtime_error("Truncated PPM image");
+    }
+
+    DecodedLevel level;
+    level.width = image.width;
+    level.height = image.height;
+    level.pixels.resize(texelCount * TexelSize);
+
+    const char* rgb = data + pos;
+    for (size_t texel = 0; texel < texelCount; ++texel) {
+        level.pixels[texel * 4 + 0] = static_cast<uint8_t>(rgb[texel * 3 + 0]);
+        level.pixels[texel * 4 + 1] = static_cast<uint8_t>(rgb[texel * 3 + 1]);
+        level.pixels[texel * 4 + 2] = static_cast<uint8_t>(rgb[texel * 3 + 2]);
+        level.pixels[texel * 4 + 3] = 255;
+    }
+
+    image.levels.push_back(std::move(level));
+
+    return image;
+}
+
+TextureStreamer::~TextureStreamer() {
+    destroy();
+}
+
+void TextureStreamer::init(VkDevice device, VkMemoryAllocator& allocator, StagingUploader& uploader, BindlessDescriptors& bindless,
+                           TaskScheduler& scheduler, uint32_t framesInFlight, VkDeviceSize uploadBudget) {
+    m_vkDevice = device;
+    m_allocator = &allocator;
+    m_uploader = &uploader;
+    m_bindless = &bindless;
+    m_scheduler = &scheduler;
+    m_framesInFlight = framesInFlight;
+    m_uploadBudget = uploadBudget;
+
+    VkDeviceSize tableStride = (sizeof(uint32_t) * MaxTextures + TableAlignment - 1) / TableAlignment * TableAlignment;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = tableStride * framesInFlight;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    m_tableBuffer = allocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    m_tables.resize(framesInFlight);
+    for (uint32_t frameIdx = 0; frameIdx < framesInFlight; ++frameIdx) {
+        TextureTable& table = m_tables[frameIdx];
+        table.entries = reinterpret_cast<uint32_t*>(static_cast<char*>(m_tableBuffer.allocation.mapped) + tableStride * frameIdx);
+        std::fill(table.entries, table.entries + MaxTextures, BindlessDescriptors::InvalidSlot);
+        table.slot = bindless.addStorageBuffer(m_tableBuffer.buffer, tableStride * frameIdx, tableStride);
+    }
+    allocator.flush(m_tableBuffer.allocation);
+
+    m_stopIo = false;
+    m_ioThread = std::thread(&TextureStreamer::ioLoop, this);
+}
+
+void TextureStreamer::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_stopIo = true;
+        m_ioRequests.clear();
+    }
+    m_ioCondition.notify_all();
+    m_ioThread.join();
+
+    // Decode tasks push into this object
+    m_scheduler->wait(m_decodeTasks);
+    m_decoded.clear();
+
+    for (auto& texture : m_textures) {
+        vkDestroyImageView(m_vkDevice, texture.view, nullptr);
+        m_allocator->destroyImage(texture.image);
+    }
+    m_textures.clear();
+    m_uploadedLevels.clear();
+
+    for (auto& retired : m_retiredViews) {
+        vkDestroyImageView(m_vkDevice, retired.view, nullptr);
+    }
+    m_retiredViews.clear();
+
+    m_tables.clear();
+    m_allocator->destroyBuffer(m_tableBuffer);
+
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+TextureHandle TextureStreamer::load(const std::string& path) {
+    if (m_textures.size() >= MaxTextures) {
+        throw std::runtime_error("Texture table is full");
+    }
+
+    TextureHandle handle = static_cast<TextureHandle>(m_textures.size());
+    m_textures.emplace_back().name = path;
+
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_ioRequests.emplace_back(handle, path);
+    }
+    m_ioCondition.notify_one();
+
+    return handle;
+}
+
+TextureHandle TextureStreamer::load(const std::string& name, std::function<DecodedImage()> decode) {
+    if (m_textures.size() >= MaxTextures) {
+        throw std::runtime_error("Texture table is full");
+    }
+
+    TextureHandle handle = static_cast<TextureHandle>(m_textures.size());
+    m_textures.emplace_back().name = name;
+
+    spawnDecode(handle, std::move(decode));
+
+    return handle;
+}
+
+void TextureStreamer::update(uint32_t frameSlot, uint64_t frameCounter) {
+    ScopedCpuTimer streamTimer("streamTextures");
+
+    m_currentSlot = frameSlot;
+    m_frameCounter = frameCounter;
+
+    // Views replaced framesInFlight frames ago are no longer referenced by any pending frame
+    auto retiredEnd = std::remove_if(m_retiredViews.begin(), m_retiredViews.end(), [this](const RetiredView& retired) {
+        if (m_frameCounter < retired.retiredAtFrame + m_framesInFlight) {
+            return false;
+        }
+        vkDestroyImageView(m_vkDevice, retired.view, nullptr);
+        return true;
+    });
+    m_retiredViews.erase(retiredEnd, m_retiredViews.end());
+
+    std::vector<DecodeResult> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        decoded.swap(m_decoded);
+    }
+
+    for (auto& result : decoded) {
+        if (!result.image) {
+            m_textures[result.handle].state = TextureState::Failed;
+            std::cerr << "[streaming] Failed to load " << m_textures[result.handle].name << ": " << result.error << std::endl;
+            continue;
+        }
+        createImage(result.handle, std::move(result.image));
+    }
+
+    // Textures are served in request order, the first ones sharpen first
+    VkDeviceSize budget = m_uploadBudget;
+    for (TextureHandle handle = 0; handle < m_textures.size(); ++handle) {
+        if (m_textures[handle].state == TextureState::Streaming && !uploadBands(handle, budget)) {
+            break;
+        }
+    }
+}
+
+void TextureStreamer::record(VkCommandBuffer commandBuffer) {
+    for (const auto& uploaded : m_uploadedLevels) {
+        Texture& texture = m_textures[uploaded.handle];
+        const std::vector<DecodedLevel>& levels = texture.source->levels;
+
+        // Generated down to the next coarser given level, which is already resident
+        uint32_t firstLevel = levels[uploaded.sourceLevel].level;
+        uint32_t endLevel = uploaded.sourceLevel > 0 ? levels[uploaded.sourceLevel - 1].level : texture.mipLevels;
+        generateMips(commandBuffer, texture, firstLevel, endLevel);
+        publish(uploaded.handle, firstLevel);
+
+        if (uploaded.sourceLevel + 1 == levels.size()) {
+            texture.state = TextureState::Complete;
+            texture.source.reset();
+            m_completeMs.add(texture.requestTime.elapsedMs());
+        }
+    }
+    m_uploadedLevels.clear();
+
+    // The frame slot's fence was waited on in update(), no pending frame reads this table
+    TextureTable& table = m_tables[m_currentSlot];
+    for (TextureHandle handle = 0; handle < m_textures.size(); ++handle) {
+        table.entries[handle] = m_textures[handle].slot;
+    }
+    m_allocator->flush(m_tableBuffer.allocation, reinterpret_cast<char*>(table.entries) - static_cast<char*>(m_tableBuffer.allocation.mapped),
+                       sizeof(uint32_t) * m_textures.size());
+}
+
+TextureStreamingStats TextureStreamer::stats() const {
+    TextureStreamingStats stats;
+    stats.requested = static_cast<uint32_t>(m_textures.size());
+
+    for (const auto& texture : m_textures) {
+        switch (texture.state) {
+        case TextureState::Loading:
+            break;
+        case TextureState::Streaming:
+            ++stats.streaming;
+            break;
+        case TextureState::Complete:
+            ++stats.complete;
+            break;
+        case TextureState::Failed:
+            ++stats.failed;
+            break;
+        }
+    }
+
+    stats.uploadedBytes = m_uploadedBytes;
+    stats.firstLevelMs = m_firstLevelMs;
+    stats.completeMs = m_completeMs;
+
+    return stats;
+}
+
+void TextureStreamer::ioLoop() {
+    while (true) {
+        std::pair<TextureHandle, std::string> request;
+        {
+            std::unique_lock<std::mutex> lock(m_ioMutex);
+            m_ioCondition.wait(lock, [this]() { return m_stopIo || !m_ioRequests.empty(); });
+            if (m_stopIo) {
+                return;
+            }
+
+            request = std::move(m_ioRequests.front());
+            m_ioRequests.pop_front();
+        }
+
+        // Only the blocking read happens here: the file is faulted in on this thread and
+        // decoded on the scheduler straight from the mapping, which is dropped afterwards
+        std::shared_ptr<const MappedFile> file;
+        try {
+            file = std::make_shared<const MappedFile>(request.second, FileAccess::Prefault);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(m_decodedMutex);
+            m_decoded.push_back({ request.first, nullptr, e.what() });
+            continue;
+        }
+
+        spawnDecode(request.first, [file]() { return DecodePpm(file->data(), file->size()); });
+    }
+}
+
+void TextureStreamer::spawnDecode(TextureHandle handle, std::function<DecodedImage()> decode) {
+    m_scheduler->spawn([this, handle, decode = std::move(decode)]() {
+        DecodeResult result;
+        result.handle = handle;
+
+        try {
+            auto image = std::make_unique<DecodedImage>(decode());
+            AddPreviewLevel(*image);
+            ValidateImage(*image);
+            result.image = std::move(image);
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        m_decoded.push_back(std::move(result));
+    }, &m_decodeTasks);
+}
+
+void TextureStreamer::createImage(TextureHandle handle, std::unique_ptr<DecodedImage> image) {
+    Texture& texture = m_textures[handle];
+    texture.extent = { image->width, image->height };
+    texture.mipLevels = MipLevelCount(image->width, image->height);
+    texture.residentLevel = texture.mipLevels;
+    texture.source = std::move(image);
+
+    VkImageCreateInfo imageCreateInfo {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = TextureFormat;
+    imageCreateInfo.extent = { texture.extent.width, texture.extent.height, 1 };
+    imageCreateInfo.mipLevels = texture.mipLevels;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    texture.image = m_allocator->createImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    texture.state = TextureState::Streaming;
+}
+
+bool TextureStreamer::uploadBands(TextureHandle handle, VkDeviceSize& budget) {
+    Texture& texture = m_textures[handle];
+    const std::vector<DecodedLevel>& levels = texture.source->levels;
+
+    while (texture.uploadLevel < levels.size()) {
+        if (budget == 0) {
+            return false;
+        }
+
+        const DecodedLevel& level = levels[texture.uploadLevel];
+        VkDeviceSize rowSize = TexelSize * level.width;
+        uint32_t rowCount = static_cast<uint32_t>(std::clamp<VkDeviceSize>(std::min({ budget, MaxBandBytes, m_uploader->maxUploadSize() }) / rowSize, 1, level.height - texture.uploadRow));
+        VkDeviceSize bandSize = rowSize * rowCount;
+
+        if (!texture.levelBegun) {
+            m_uploader->beginImageLevel(texture.image.image, level.level);
+            texture.levelBegun = true;
+        }
+
+        VkOffset3D offset { 0, static_cast<int32_t>(texture.uploadRow), 0 };
+        VkExtent3D extent { level.width, rowCount, 1 };
+        if (!m_uploader->tryUploadImage(texture.image.image, level.level, offset, extent, level.pixels.data() + rowSize * texture.uploadRow, bandSize)) {
+            return false;
+        }
+
+        budget -= std::min(budget, bandSize);
+        m_uploadedBytes += bandSize;
+        texture.uploadRow += rowCount;
+
+        if (texture.uploadRow == level.height) {
+            // Blits read the level first, then it is sampled
+            m_uploader->endImageLevel(texture.image.image, level.level, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+            m_uploadedLevels.push_back({ handle, texture.uploadLevel });
+
+            ++texture.uploadLevel;
+            texture.uploadRow = 0;
+            texture.levelBegun = false;
+        }
+    }
+
+    return true;
+}
+
+void TextureStreamer::generateMips(VkCommandBuffer commandBuffer, const Texture& texture, uint32_t firstLevel, uint32_t endLevel) {
+    VkImage image = texture.image.image;
+
+    for (uint32_t level = firstLevel; level + 1 < endLevel; ++level) {
+        VkImageMemoryBarrier barriers[] = {
+            LevelBarrier(image, level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+            LevelBarrier(image, level + 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         0, VK_ACCESS_TRANSFER_WRITE_BIT),
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 2, barriers);
+
+        VkImageBlit blit {};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        blit.srcOffsets[1] = { static_cast<int32_t>(MipExtent(texture.extent.width, level)),
+                               static_cast<int32_t>(MipExtent(texture.extent.height, level)), 1 };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level + 1, 0, 1 };
+        blit.dstOffsets[1] = { static_cast<int32_t>(MipExtent(texture.extent.width, level + 1)),
+                               static_cast<int32_t>(MipExtent(texture.extent.height, level + 1)), 1 };
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_LINEAR);
+    }
+
+    // Blit sources are in TRANSFER_SRC_OPTIMAL, the last written level still in TRANSFER_DST_OPTIMAL
+    std::vector<VkImageMemoryBarrier> barriers;
+    if (endLevel - 1 > firstLevel) {
+        barriers.push_back(LevelBarrier(image, firstLevel, endLevel - 1 - firstLevel, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT));
+    }
+    barriers.push_back(LevelBarrier(image, endLevel - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+}
+
+void TextureStreamer::publish(TextureHandle handle, uint32_t residentLevel) {
+    Texture& texture = m_textures[handle];
+
+    VkImageViewCreateInfo imageViewCreateInfo {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = texture.image.image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = TextureFormat;
+    imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, residentLevel, texture.mipLevels - residentLevel, 0, 1 };
+
+    VkImageView view = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateImageView(m_vkDevice, &imageViewCreateInfo, nullptr, &view); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create texture image view");
+    }
+
+    if (texture.view == VK_NULL_HANDLE) {
+        m_firstLevelMs.add(texture.requestTime.elapsedMs());
+    } else {
+        // Frames recorded so far still sample the coarser view
+        m_bindless->release(BindlessResource::SampledImage, texture.slot);
+        m_retiredViews.push_back({ texture.view, m_frameCounter });
+    }
+
+    texture.view = view;
+    texture.slot = m_bindless->addSampledImage(view);
+    texture.residentLevel = residentLevel;
+}
+
+} // namespace nex
@@ -0,0 +1,200 @@
+#ifndef __VulkanApp_TextureStreamer_H__
+#define __VulkanApp_TextureStreamer_H__
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BindlessDescriptors.h"
+#include "StagingUploader.h"
+#include "TaskScheduler.h"
+#include "Utils.h"
+#include "VkMemoryAllocator.h"
+
+namespace nex {
+
+// Index into the texture table the shaders read, stable for the texture's lifetime
+using TextureHandle = uint32_t;
+constexpr TextureHandle InvalidTexture = ~0u;
+
+// One RGBA8 mip level of a decoded image
+struct DecodedLevel {
+    uint32_t level = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Decoder output. Levels are sorted coarsest first; levels between two given
+// ones and below the coarsest are generated on the GPU.
+struct DecodedImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<DecodedLevel> levels;
+};
+
+// Binary PPM (P6) with 8 bit channels, only the base level
+DecodedImage DecodePpm(const char* data, size_t size);
+
+struct TextureStreamingStats {
+    uint32_t requested = 0;
+    // Decoded, finer levels still uploading
+    uint32_t streaming = 0;
+    uint32_t complete = 0;
+    uint32_t failed = 0;
+    uint64_t uploadedBytes = 0;
+    // From the request to the first visible level and to the full chain
+    utils::SampleStats firstLevelMs;
+    utils::SampleStats completeMs;
+};
+
+// Streams textures in without stalling the frame loop. Files are read on a
+// background I/O thread and decoded on the task scheduler. Decoded images
+// are uploaded in bands of rows through the staging ring, bounded by a byte
+// budget per frame and never waiting for ring space. The coarsest level goes
+// first and the chain below it is blitted on the GPU, so a texture shows up
+// blurry within a few frames and sharpens as finer levels land.
+//
+// Every residency step gets a new view over the resident levels. Shaders
+// reach it through a texture table, a per frame slot array of bindless image
+// slots indexed by TextureHandle, so handles stay stable while views change.
+class TextureStreamer {
+public:
+    static constexpr uint32_t MaxTextures = 1024;
+    static constexpr VkDeviceSize DefaultUploadBudget = 4ull * 1024 * 1024;
+
+    TextureStreamer() = default;
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    void init(VkDevice device, VkMemoryAllocator& allocator, StagingUploader& uploader, BindlessDescriptors& bindless,
+              TaskScheduler& scheduler, uint32_t framesInFlight, VkDeviceSize uploadBudget = DefaultUploadBudget);
+    // The device must be idle
+    void destroy();
+
+    // PPM file read on the I/O thread
+    TextureHandle load(const std::string& path);
+    // Image produced by decode on the task scheduler, e.g. a generated one
+    TextureHandle load(const std::string& name, std::function<DecodedImage()> decode);
+
+    // Called after waiting on the slot's fence, uploads the next bands within the budget
+    void update(uint32_t frameSlot, uint64_t frameCounter);
+    // Recorded after the staging uploader's acquire and before the textures are
+    // sampled: generates the mips of the levels uploaded so far and publishes them
+    void record(VkCommandBuffer commandBuffer);
+
+    // Bindless storage buffer slot of the current frame's texture table
+    uint32_t tableSlot() const {
+        return m_tables[m_currentSlot].slot;
+    }
+
+    TextureStreamingStats stats() const;
+
+private:
+    enum class TextureState {
+        Loading,
+        Streaming,
+        Complete,
+        Failed,
+    };
+
+    struct Texture {
+        std::string name;
+        TextureState state = TextureState::Loading;
+        utils::Stopwatch requestTime;
+
+        AllocatedImage image;
+        VkExtent2D extent {};
+        uint32_t mipLevels = 0;
+
+        std::unique_ptr<DecodedImage> source;
+        // Next entry of source->levels to upload and the next row within it
+        size_t uploadLevel = 0;
+        uint32_t uploadRow = 0;
+        bool levelBegun = false;
+
+        // Finest level the view covers, mipLevels while nothing is visible
+        uint32_t residentLevel = 0;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t slot = BindlessDescriptors::InvalidSlot;
+    };
+
+    struct DecodeResult {
+        TextureHandle handle = InvalidTexture;
+        std::unique_ptr<DecodedImage> image;
+        std::string error;
+    };
+
+    // Fully uploaded source level waiting for its mips and view on the graphics queue
+    struct UploadedLevel {
+        TextureHandle handle = InvalidTexture;
+        size_t sourceLevel = 0;
+    };
+
+    struct RetiredView {
+        VkImageView view = VK_NULL_HANDLE;
+        uint64_t retiredAtFrame = 0;
+    };
+
+    struct TextureTable {
+        uint32_t* entries = nullptr;
+        uint32_t slot = BindlessDescriptors::InvalidSlot;
+    };
+
+    void ioLoop();
+    void spawnDecode(TextureHandle handle, std::function<DecodedImage()> decode);
+    void createImage(TextureHandle handle, std::unique_ptr<DecodedImage> image);
+    // Returns false once the budget or the staging ring is exhausted
+    bool uploadBands(TextureHandle handle, VkDeviceSize& budget);
+    void generateMips(VkCommandBuffer commandBuffer, const Texture& texture, uint32_t firstLevel, uint32_t endLevel);
+    void publish(TextureHandle handle, uint32_t residentLevel);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkMemoryAllocator* m_allocator = nullptr;
+    StagingUploader* m_uploader = nullptr;
+    BindlessDescriptors* m_bindless = nullptr;
+    TaskScheduler* m_scheduler = nullptr;
+    uint32_t m_framesInFlight = 1;
+    VkDeviceSize m_uploadBudget = DefaultUploadBudget;
+
+    uint32_t m_currentSlot = 0;
+    uint64_t m_frameCounter = 0;
+
+    // Owned by the frame loop thread
+    std::vector<Texture> m_textures;
+    std::vector<UploadedLevel> m_uploadedLevels;
+    std::vector<RetiredView> m_retiredViews;
+    uint64_t m_uploadedBytes = 0;
+    utils::SampleStats m_firstLevelMs;
+    utils::SampleStats m_completeMs;
+
+    AllocatedBuffer m_tableBuffer;
+    std::vector<TextureTable> m_tables;
+
+    // Files waiting for the I/O thread
+    std::mutex m_ioMutex;
+    std::condition_variable m_ioCondition;
+    std::deque<std::pair<TextureHandle, std::string>> m_ioRequests;
+    bool m_stopIo = false;
+    std::thread m_ioThread;
+
+    // Filled by decode tasks, drained by update()
+    std::mutex m_decodedMutex;
+    std::vector<DecodeResult> m_decoded;
+    TaskCounter m_decodeTasks;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_TextureStreamer_H__
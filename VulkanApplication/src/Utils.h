@@ -1,13 +1,67 @@
 #pragma once
 
-#include <vector>
-#include <string_view>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 
 namespace nex {
 
 namespace utils {
 
-std::vector<char> ReadFile(std::string_view filepath);
+template <typename T>
+void HashCombine(size_t& seed, const T& value) {
+    seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+class Stopwatch {
+public:
+    Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    void reset() {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Running minimum, average and maximum of millisecond samples
+class SampleStats {
+public:
+    void add(double ms) {
+        m_minMs = m_count == 0 ? ms : std::min(m_minMs, ms);
+        m_maxMs = std::max(m_maxMs, ms);
+        m_totalMs += ms;
+        ++m_count;
+    }
+
+    uint64_t count() const {
+        return m_count;
+    }
+
+    double minMs() const {
+        return m_minMs;
+    }
+
+    double maxMs() const {
+        return m_maxMs;
+    }
+
+    double averageMs() const {
+        return m_count == 0 ? 0.0 : m_totalMs / m_count;
+    }
+
+private:
+    uint64_t m_count = 0;
+    double m_minMs = 0.0;
+    double m_maxMs = 0.0;
+    double m_totalMs = 0.0;
+};
 
 } // namespace utils
 
@@ -1,5 +1,8 @@
 #include "VkDevices.h"
 
+#include <algorithm>
+#include <array>
+
 namespace nex {
 
 std::vector<VkPhysicalDevice> VkDeviceUtils::PhysicalDevices(VkInstance vkInstance) {
@@ -28,18 +31,34 @@ DeviceQueueFamilyIndices VkDeviceUtils::FindDeviceQueueFamilies(VkPhysicalDevice
             queueFamilyIndices.graphicsFamily = queueFamilyIdx;
         }
 
-        VkBool32 surfaceSupported = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, queueFamilyIdx, surface, &surfaceSupported);
+        if (surface != VK_NULL_HANDLE) {
+            VkBool32 surfaceSupported = VK_FALSE;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, queueFamilyIdx, surface, &surfaceSupported);
 
-        if (surfaceSupported) {
-            queueFamilyIndices.presentFamily = queueFamilyIdx;
+            if (surfaceSupported) {
+                queueFamilyIndices.presentFamily = queueFamilyIdx;
+            }
         }
 
-        if (queueFamilyIndices.isComplete()) {
+        if (queueFamilyIndices.isComplete(surface != VK_NULL_HANDLE)) {
             break;
         }
     }
 
+    // Transfer only families map to the DMA engines, families with compute are the next best thing
+    std::array<VkQueueFlags, 2> excludedFlagsByPreference { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT };
+
+    for (VkQueueFlags excludedFlags : excludedFlagsByPreference) {
+        for (size_t queueFamilyIdx = 0; queueFamilyIdx < queueFamilies.size(); queueFamilyIdx++) {
+            VkQueueFlags queueFlags = queueFamilies[queueFamilyIdx].queueFlags;
+
+            if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & excludedFlags)) {
+                queueFamilyIndices.transferFamily = queueFamilyIdx;
+                return queueFamilyIndices;
+            }
+        }
+    }
+
     return queueFamilyIndices;
 }
 
@@ -63,28 +82,61 @@ DeviceSwapChainInfo VkDeviceUtils::GetDeviceSwapChainInfo(VkPhysicalDevice devic
     return swapChainInfo;
 }
 
-uint32_t VkDeviceUtils::RateDeviceSuitability(VkPhysicalDevice device) {
+uint64_t VkDeviceUtils::RateDeviceSuitability(VkPhysicalDevice device, const DeviceRequirements& requirements) {
     VkPhysicalDeviceProperties deviceProperties;
     VkPhysicalDeviceFeatures deviceFeatures;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
 
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
 
-    if (!deviceFeatures.geometryShader) {
+    if (deviceProperties.limits.maxImageDimension2D < requirements.minImageDimension2D) {
         return 0;
     }
 
-    uint32_t deviceScore = 0;
-
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) {
-        deviceScore += 10;
+    // Software and virtual devices are usable, just ranked below real GPUs
+    uint64_t typeRank = 0;
+    switch (deviceProperties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        typeRank = 4;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        typeRank = 3;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        typeRank = 2;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        typeRank = 1;
+        break;
+    default:
+        break;
     }
 
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-        deviceScore += 20;
+    bool indirectDraws = deviceFeatures.multiDrawIndirect && deviceFeatures.drawIndirectFirstInstance;
+
+    VkDeviceSize deviceLocalBytes = 0;
+    for (uint32_t heapIdx = 0; heapIdx < memoryProperties.memoryHeapCount; heapIdx++) {
+        if (memoryProperties.memoryHeaps[heapIdx].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            deviceLocalBytes = std::max(deviceLocalBytes, memoryProperties.memoryHeaps[heapIdx].size);
+        }
     }
 
+    // Memory in MiB stays below bit 40, the 1 keeps suitable devices above 0
+    uint64_t deviceScore = 1;
+    deviceScore += typeRank << 48;
+    deviceScore += (requirements.preferIndirectDraws && indirectDraws ? uint64_t(1) : 0) << 40;
+    deviceScore += std::min<uint64_t>(deviceLocalBytes >> 20, (uint64_t(1) << 40) - 2);
+
     return deviceScore;
 }
 
+std::string VkDeviceUtils::DeviceName(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+    return deviceProperties.deviceName;
+}
+
 } // namespace nex
\ No newline at end of file
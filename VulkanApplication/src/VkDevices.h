@@ -3,17 +3,22 @@
 
 #include <vulkan/vulkan.h>
 
-#include <vector>
+#include <cstdint>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace nex {
 
 struct DeviceQueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Family without graphics support, set only when the device has one
+    std::optional<uint32_t> transferFamily;
 
-    bool isComplete() {
-        return graphicsFamily.has_value() && presentFamily.has_value();
+    // Present support is only required when rendering to a surface
+    bool isComplete(bool requirePresent = true) {
+        return graphicsFamily.has_value() && (presentFamily.has_value() || !requirePresent);
     }
 };
 
@@ -23,17 +28,31 @@ struct DeviceSwapChainInfo {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// What the renderer needs from a physical device beyond the required extensions
+// and bindless support, which are checked separately
+struct DeviceRequirements {
+    // Largest side of the images rendered to
+    uint32_t minImageDimension2D = 0;
+    // Devices that can draw the GPU-driven path are preferred, the others fall back to CPU-driven draws
+    bool preferIndirectDraws = false;
+};
+
 class VkDeviceUtils {
 public:
     VkDeviceUtils() = delete;
 
     static std::vector<VkPhysicalDevice> PhysicalDevices(VkInstance vkInstance);
 
+    // Pass VK_NULL_HANDLE as surface to skip the present support query
     static DeviceQueueFamilyIndices FindDeviceQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
     static DeviceSwapChainInfo GetDeviceSwapChainInfo(VkPhysicalDevice device, VkSurfaceKHR surface);
 
-    static uint32_t RateDeviceSuitability(VkPhysicalDevice device);
+    // 0 when the device does not meet the requirements, otherwise higher is better:
+    // by device type, then preferred features, then device local memory
+    static uint64_t RateDeviceSuitability(VkPhysicalDevice device, const DeviceRequirements& requirements);
+
+    static std::string DeviceName(VkPhysicalDevice device);
 };
 
 } // namespace nex
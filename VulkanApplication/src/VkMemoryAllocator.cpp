@@ -0,0 +1,453 @@
+#include "VkMemoryAllocator.h"
+
+#include <algorithm>
+#include <bitset>
+#include <iomanip>
+#include <stdexcept>
+
+#include "FreeListAllocator.h"
+
+namespace nex {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+    return value / alignment * alignment;
+}
+
+} // namespace
+
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint32_t memoryType = 0;
+    AllocationKind kind = AllocationKind::Linear;
+    void* mapped = nullptr;
+
+    FreeListAllocator regions;
+};
+
+double MemoryHeapStats::fragmentation() const {
+    VkDeviceSize freeBytes = reservedBytes - usedBytes;
+    if (freeBytes == 0) {
+        return 0.0;
+    }
+    return 1.0 - static_cast<double>(largestFreeRegion) / static_cast<double>(freeBytes);
+}
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats) {
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    out << "Device memory allocations: " << stats.deviceMemoryCount << " / " << stats.maxDeviceMemoryCount
+        << ", peak reserved " << std::fixed << std::setprecision(2) << stats.peakReservedBytes / MiB << " MiB\n";
+    for (size_t heapIdx = 0; heapIdx < stats.heaps.size(); ++heapIdx) {
+        const auto& heap = stats.heaps[heapIdx];
+        if (heap.reservedBytes == 0) {
+            continue;
+        }
+
+        out << "  heap " << heapIdx << ": "
+            << std::fixed << std::setprecision(2)
+            << heap.usedBytes / MiB << " MiB used of " << heap.reservedBytes / MiB << " MiB reserved ("
+            << heap.heapSize / MiB << " MiB heap), "
+            << heap.allocationCount << " allocations in " << heap.blockCount << " blocks + "
+            << heap.dedicatedCount << " dedicated, "
+            << heap.freeRegionCount << " free regions, fragmentation " << heap.fragmentation() * 100.0 << "%\n";
+    }
+    return out;
+}
+
+VkMemoryAllocator::VkMemoryAllocator() = default;
+
+VkMemoryAllocator::~VkMemoryAllocator() {
+    destroy();
+}
+
+void VkMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) {
+    m_vkDevice = device;
+    m_blockSize = blockSize;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    m_bufferImageGranularity = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(1, deviceProperties.limits.nonCoherentAtomSize);
+    m_maxDeviceMemoryCount = deviceProperties.limits.maxMemoryAllocationCount;
+}
+
+void VkMemoryAllocator::destroy() {
+    if (m_vkDevice == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    for (auto& block : m_blocks) {
+        vkFreeMemory(m_vkDevice, block->memory, nullptr);
+    }
+    m_blocks.clear();
+
+    for (auto& [memory, info] : m_dedicatedAllocations) {
+        vkFreeMemory(m_vkDevice, memory, nullptr);
+    }
+    m_dedicatedAllocations.clear();
+    m_reservedBytes = 0;
+
+    m_vkDevice = VK_NULL_HANDLE;
+}
+
+std::optional<uint32_t> VkMemoryAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+    std::optional<uint32_t> bestMemoryType;
+    size_t bestScore = 0;
+
+    for (uint32_t memoryTypeIdx = 0; memoryTypeIdx < m_memoryProperties.memoryTypeCount; ++memoryTypeIdx) {
+        VkMemoryPropertyFlags flags = m_memoryProperties.memoryTypes[memoryTypeIdx].propertyFlags;
+
+        if (!(typeBits & (1u << memoryTypeIdx)) || (flags & required) != required) {
+            continue;
+        }
+
+        size_t score = std::bitset<32>(flags & preferred).count();
+        if (!bestMemoryType || score > bestScore) {
+            bestMemoryType = memoryTypeIdx;
+            bestScore = score;
+        }
+    }
+
+    return bestMemoryType;
+}
+
+MemoryAllocation VkMemoryAllocator::allocate(const VkMemoryRequirements& requirements, AllocationKind kind,
+                                             VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+    // Without a granularity restriction both kinds can share blocks
+    if (m_bufferImageGranularity <= 1) {
+        kind = AllocationKind::Linear;
+    }
+
+    // Fall back to other suitable types when the best one is out of memory
+    uint32_t typeBits = requirements.memoryTypeBits;
+    while (auto memoryType = findMemoryType(typeBits, required, preferred)) {
+        if (MemoryAllocation allocation = allocateFromType(requirements, kind, *memoryType)) {
+            return allocation;
+        }
+        typeBits &= ~(1u << *memoryType);
+    }
+
+    throw std::runtime_error("Failed to allocate device memory");
+}
+
+void VkMemoryAllocator::free(MemoryAllocation& allocation) {
+    if (!allocation) {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    if (!allocation.block) {
+        vkFreeMemory(m_vkDevice, allocation.memory, nullptr);
+        trackReserved(0, allocation.size);
+        m_dedicatedAllocations.erase(allocation.memory);
+        allocation = {};
+        return;
+    }
+
+    MemoryBlock* block = allocation.block;
+    block->regions.free(allocation.offset, allocation.size);
+    allocation = {};
+
+    if (block->regions.allocationCount() > 0) {
+        return;
+    }
+
+    // Keep one empty block per memory type and kind around to avoid allocation churn
+    bool hasOtherEmptyBlock = std::any_of(m_blocks.begin(), m_blocks.end(), [block](const auto& other) {
+        return other.get() != block && other->memoryType == block->memoryType
+            && other->kind == block->kind && other->regions.allocationCount() == 0;
+    });
+
+    if (hasOtherEmptyBlock) {
+        vkFreeMemory(m_vkDevice, block->memory, nullptr);
+        trackReserved(0, block->regions.size());
+        m_blocks.erase(std::find_if(m_blocks.begin(), m_blocks.end(), [block](const auto& other) {
+            return other.get() == block;
+        }));
+    }
+}
+
+AllocatedBuffer VkMemoryAllocator::createBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+    AllocatedBuffer buffer;
+
+    if (VkResult result = vkCreateBuffer(m_vkDevice, &createInfo, nullptr, &buffer.buffer); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_vkDevice, buffer.buffer, &memoryRequirements);
+
+    try {
+        buffer.allocation = allocate(memoryRequirements, AllocationKind::Linear, required, preferred);
+    } catch (...) {
+        vkDestroyBuffer(m_vkDevice, buffer.buffer, nullptr);
+        throw;
+    }
+
+    vkBindBufferMemory(m_vkDevice, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+    return buffer;
+}
+
+void VkMemoryAllocator::destroyBuffer(AllocatedBuffer& buffer) {
+    vkDestroyBuffer(m_vkDevice, buffer.buffer, nullptr);
+    free(buffer.allocation);
+    buffer.buffer = VK_NULL_HANDLE;
+}
+
+AllocatedImage VkMemoryAllocator::createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+    AllocatedImage image;
+
+    if (VkResult result = vkCreateImage(m_vkDevice, &createInfo, nullptr, &image.image); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create image");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_vkDevice, image.image, &memoryRequirements);
+
+    AllocationKind kind = createInfo.tiling == VK_IMAGE_TILING_LINEAR ? AllocationKind::Linear : AllocationKind::Optimal;
+
+    try {
+        image.allocation = allocate(memoryRequirements, kind, required, preferred);
+    } catch (...) {
+        vkDestroyImage(m_vkDevice, image.image, nullptr);
+        throw;
+    }
+
+    vkBindImageMemory(m_vkDevice, image.image, image.allocation.memory, image.allocation.offset);
+
+    return image;
+}
+
+void VkMemoryAllocator::destroyImage(AllocatedImage& image) {
+    vkDestroyImage(m_vkDevice, image.image, nullptr);
+    free(image.allocation);
+    image.image = VK_NULL_HANDLE;
+}
+
+void VkMemoryAllocator::flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (m_memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        return;
+    }
+
+    if (size == VK_WHOLE_SIZE) {
+        size = allocation.size - offset;
+    }
+
+    VkDeviceSize memorySize = allocation.block ? allocation.block->regions.size() : allocation.size;
+
+    // Flushed ranges must be multiples of nonCoherentAtomSize or reach the end of the memory
+    VkDeviceSize begin = alignDown(allocation.offset + offset, m_nonCoherentAtomSize);
+    VkDeviceSize end = std::min(alignUp(allocation.offset + offset + size, m_nonCoherentAtomSize), memorySize);
+
+    VkMappedMemoryRange mappedRange {};
+    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRange.memory = allocation.memory;
+    mappedRange.offset = begin;
+    mappedRange.size = end == memorySize ? VK_WHOLE_SIZE : end - begin;
+
+    vkFlushMappedMemoryRanges(m_vkDevice, 1, &mappedRange);
+}
+
+MemoryStats VkMemoryAllocator::stats() const {
+    std::lock_guard lock(m_mutex);
+
+    MemoryStats stats;
+    stats.maxDeviceMemoryCount = m_maxDeviceMemoryCount;
+    stats.deviceMemoryCount = m_blocks.size() + m_dedicatedAllocations.size();
+    stats.peakReservedBytes = m_peakReservedBytes;
+    stats.heaps.resize(m_memoryProperties.memoryHeapCount);
+
+    for (uint32_t heapIdx = 0; heapIdx < m_memoryProperties.memoryHeapCount; ++heapIdx) {
+        stats.heaps[heapIdx].heapSize = m_memoryProperties.memoryHeaps[heapIdx].size;
+    }
+
+    for (const auto& block : m_blocks) {
+        auto& heap = stats.heaps[m_memoryProperties.memoryTypes[block->memoryType].heapIndex];
+
+        heap.reservedBytes += block->regions.size();
+        heap.usedBytes += block->regions.usedBytes();
+        heap.allocationCount += block->regions.allocationCount();
+        heap.freeRegionCount += block->regions.freeRegionCount();
+        heap.largestFreeRegion = std::max(heap.largestFreeRegion, block->regions.largestFreeRegion());
+        ++heap.blockCount;
+    }
+
+    for (const auto& [memory, info] : m_dedicatedAllocations) {
+        auto& heap = stats.heaps[m_memoryProperties.memoryTypes[info.first].heapIndex];
+
+        heap.reservedBytes += info.second;
+        heap.usedBytes += info.second;
+        ++heap.allocationCount;
+        ++heap.dedicatedCount;
+    }
+
+    return stats;
+}
+
+void VkMemoryAllocator::trackReserved(VkDeviceSize allocatedBytes, VkDeviceSize freedBytes) {
+    m_reservedBytes = m_reservedBytes + allocatedBytes - freedBytes;
+    m_peakReservedBytes = std::max(m_peakReservedBytes, m_reservedBytes);
+}
+
+MemoryBlock* VkMemoryAllocator::createBlock(uint32_t memoryType, AllocationKind kind, VkDeviceSize size) {
+    VkMemoryAllocateInfo memoryAllocateInfo {};
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.allocationSize = size;
+    memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(m_vkDevice, &memoryAllocateInfo, nullptr, &memory) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    trackReserved(size, 0);
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->memory = memory;
+    block->memoryType = memoryType;
+    block->kind = kind;
+    block->mapped = mapMemory(memoryType, memory);
+    block->regions.init(size);
+
+    m_blocks.push_back(std::move(block));
+    return m_blocks.back().get();
+}
+
+MemoryAllocation VkMemoryAllocator::allocateDedicated(uint32_t memoryType, VkDeviceSize size) {
+    VkMemoryAllocateInfo memoryAllocateInfo {};
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.allocationSize = size;
+    memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    MemoryAllocation allocation;
+    if (vkAllocateMemory(m_vkDevice, &memoryAllocateInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+        return {};
+    }
+
+    trackReserved(size, 0);
+
+    allocation.size = size;
+    allocation.memoryType = memoryType;
+    allocation.mapped = mapMemory(memoryType, allocation.memory);
+
+    m_dedicatedAllocations.emplace(allocation.memory, std::make_pair(memoryType, size));
+
+    return allocation;
+}
+
+MemoryAllocation VkMemoryAllocator::allocateFromType(const VkMemoryRequirements& requirements, AllocationKind kind, uint32_t memoryType) {
+    std::lock_guard lock(m_mutex);
+
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    VkDeviceSize blockSize = MemoryBlockSize(m_blockSize, heapSize);
+
+    if (NeedsDedicatedMemory(requirements.size, blockSize)) {
+        return allocateDedicated(memoryType, requirements.size);
+    }
+
+    auto tryBlock = [&](MemoryBlock* block) -> MemoryAllocation {
+        auto offset = block->regions.allocate(requirements.size, requirements.alignment);
+        if (!offset) {
+            return {};
+        }
+
+        MemoryAllocation allocation;
+        allocation.memory = block->memory;
+        allocation.offset = *offset;
+        allocation.size = requirements.size;
+        allocation.memoryType = memoryType;
+        allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + *offset : nullptr;
+        allocation.block = block;
+        return allocation;
+    };
+
+    for (auto& block : m_blocks) {
+        if (block->memoryType != memoryType || block->kind != kind) {
+            continue;
+        }
+        if (MemoryAllocation allocation = tryBlock(block.get())) {
+            return allocation;
+        }
+    }
+
+    MemoryBlock* block = createBlock(memoryType, kind, blockSize);
+    if (!block) {
+        return {};
+    }
+
+    return tryBlock(block);
+}
+
+void* VkMemoryAllocator::mapMemory(uint32_t memoryType, VkDeviceMemory memory) {
+    if (!(m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        return nullptr;
+    }
+
+    void* mapped = nullptr;
+    if (VkResult result = vkMapMemory(m_vkDevice, memory, 0, VK_WHOLE_SIZE, 0, &mapped); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to map device memory");
+    }
+    return mapped;
+}
+
+void LinearRingPool::init(VkMemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t framesInFlight, VkBufferUsageFlags usage) {
+    m_allocator = &allocator;
+    m_frameSize = frameSize;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = frameSize * framesInFlight;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_buffer = allocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void LinearRingPool::destroy() {
+    if (!m_allocator || m_buffer.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    m_allocator->destroyBuffer(m_buffer);
+}
+
+void LinearRingPool::beginFrame(uint32_t frameIndex) {
+    m_frameBegin = m_frameSize * frameIndex;
+    m_frameOffset = 0;
+}
+
+std::optional<RingAllocation> LinearRingPool::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize offset = alignUp(m_frameBegin + m_frameOffset, alignment);
+    if (offset + size > m_frameBegin + m_frameSize) {
+        return std::nullopt;
+    }
+
+    m_frameOffset = offset + size - m_frameBegin;
+
+    RingAllocation allocation;
+    allocation.buffer = m_buffer.buffer;
+    allocation.offset = offset;
+    allocation.mapped = static_cast<char*>(m_buffer.allocation.mapped) + offset;
+    return allocation;
+}
+
+void LinearRingPool::flush() {
+    if (m_frameOffset > 0) {
+        m_allocator->flush(m_buffer.allocation, m_frameBegin, m_frameOffset);
+    }
+}
+
+} // namespace nex
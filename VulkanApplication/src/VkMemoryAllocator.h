@@ -0,0 +1,190 @@
+#ifndef __VulkanApp_VkMemoryAllocator_H__
+#define __VulkanApp_VkMemoryAllocator_H__
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace nex {
+
+// Resources placed in the same block must not break bufferImageGranularity,
+// so linear (buffers, linear images) and optimal images get separate blocks
+enum class AllocationKind {
+    Linear,
+    Optimal,
+};
+
+struct MemoryBlock;
+
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t memoryType = 0;
+    // Persistently mapped pointer to the allocation start, null for non host visible memory
+    void* mapped = nullptr;
+
+    // Owning block, null for dedicated allocations
+    MemoryBlock* block = nullptr;
+
+    explicit operator bool() const {
+        return memory != VK_NULL_HANDLE;
+    }
+};
+
+struct AllocatedBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation allocation;
+};
+
+struct AllocatedImage {
+    VkImage image = VK_NULL_HANDLE;
+    MemoryAllocation allocation;
+};
+
+struct MemoryHeapStats {
+    VkDeviceSize heapSize = 0;
+    // Bytes requested from vkAllocateMemory
+    VkDeviceSize reservedBytes = 0;
+    // Bytes handed out to resources
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize largestFreeRegion = 0;
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeRegionCount = 0;
+
+    // 0 when all free space is one contiguous region, approaching 1 when it is scattered
+    double fragmentation() const;
+};
+
+struct MemoryStats {
+    std::vector<MemoryHeapStats> heaps;
+    uint32_t deviceMemoryCount = 0;
+    uint32_t maxDeviceMemoryCount = 0;
+    // High-water mark of bytes reserved from vkAllocateMemory over all heaps
+    VkDeviceSize peakReservedBytes = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats);
+
+// Sub-allocates resources from large VkDeviceMemory blocks so the number of
+// vkAllocateMemory calls stays far below maxMemoryAllocationCount
+class VkMemoryAllocator {
+public:
+    static constexpr VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+    VkMemoryAllocator();
+    ~VkMemoryAllocator();
+
+    VkMemoryAllocator(const VkMemoryAllocator&) = delete;
+    VkMemoryAllocator& operator=(const VkMemoryAllocator&) = delete;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DefaultBlockSize);
+    void destroy();
+
+    // Picks a memory type that has all required and as many preferred properties as possible
+    std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements, AllocationKind kind,
+                              VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void free(MemoryAllocation& allocation);
+
+    AllocatedBuffer createBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void destroyBuffer(AllocatedBuffer& buffer);
+
+    AllocatedImage createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void destroyImage(AllocatedImage& image);
+
+    // Makes host writes visible on non coherent memory, no-op otherwise
+    void flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    MemoryStats stats() const;
+
+public:
+    VkDevice device() const {
+        return m_vkDevice;
+    }
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties() const {
+        return m_memoryProperties;
+    }
+
+private:
+    MemoryBlock* createBlock(uint32_t memoryType, AllocationKind kind, VkDeviceSize size);
+    MemoryAllocation allocateDedicated(uint32_t memoryType, VkDeviceSize size);
+    MemoryAllocation allocateFromType(const VkMemoryRequirements& requirements, AllocationKind kind, uint32_t memoryType);
+    void* mapMemory(uint32_t memoryType, VkDeviceMemory memory);
+    void trackReserved(VkDeviceSize allocatedBytes, VkDeviceSize freedBytes);
+
+private:
+    VkDevice m_vkDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties {};
+    VkDeviceSize m_blockSize = DefaultBlockSize;
+    VkDeviceSize m_bufferImageGranularity = 1;
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+    uint32_t m_maxDeviceMemoryCount = 0;
+
+    VkDeviceSize m_reservedBytes = 0;
+    VkDeviceSize m_peakReservedBytes = 0;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<MemoryBlock>> m_blocks;
+    // Dedicated allocations keyed by memory, value is the memory type and size
+    std::map<VkDeviceMemory, std::pair<uint32_t, VkDeviceSize>> m_dedicatedAllocations;
+};
+
+struct RingAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void* mapped = nullptr;
+};
+
+// Host visible buffer split into one linear region per frame in flight. Each
+// region is reset as a whole when its frame slot comes around again, which the
+// frame fence makes safe.
+class LinearRingPool {
+public:
+    LinearRingPool() = default;
+
+    void init(VkMemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t framesInFlight, VkBufferUsageFlags usage);
+    void destroy();
+
+    void beginFrame(uint32_t frameIndex);
+
+    // Empty when the frame region is exhausted
+    std::optional<RingAllocation> allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    // Flushes everything written in the current frame region
+    void flush();
+
+public:
+    VkBuffer buffer() const {
+        return m_buffer.buffer;
+    }
+
+    VkDeviceSize frameSize() const {
+        return m_frameSize;
+    }
+
+    VkDeviceSize usedBytes() const {
+        return m_frameOffset;
+    }
+
+private:
+    VkMemoryAllocator* m_allocator = nullptr;
+    AllocatedBuffer m_buffer;
+
+    VkDeviceSize m_frameSize = 0;
+    VkDeviceSize m_frameBegin = 0;
+    VkDeviceSize m_frameOffset = 0;
+};
+
+} // namespace nex
+
+#endif // __VulkanApp_VkMemoryAllocator_H__
@@ -10,8 +10,10 @@
 #include <vector>
 #include <array>
 #include <set>
+#include <cmath>
 
 #include "VkDevices.h"
+#include "Profiler.h"
 #include "Utils.h"
 
 #define GLFW_EXPOSE_NATIVE_WAYLAND
@@ -20,6 +22,52 @@
 #define SHADER_VERT_CODE_FILE "assets/triangle.vert.spv"
 #define SHADER_FRAG_CODE_FILE "assets/triangle.frag.spv"
 
+// Set by the build, for hot reloading shaders from a source checkout
+#ifndef SHADER_SOURCE_DIRECTORY
+#define SHADER_SOURCE_DIRECTORY "assets"
+#endif
+#ifndef SHADER_COMPILER_PATH
+#define SHADER_COMPILER_PATH "glslc"
+#endif
+
+namespace {
+
+// layout(constant_id) of the scene shaders' feature switches
+constexpr uint32_t VertexColorConstant = 0;
+constexpr uint32_t TexturedConstant = 1;
+constexpr uint32_t TextureTapsConstant = 2;
+
+// Below this many draws per worker the scene is recorded inline on the main thread
+constexpr uint32_t MinDrawsPerSecondary = 256;
+
+// Eight by eight light and dark squares, stands in for an image file
+nex::DecodedImage GenerateCheckerImage(uint32_t size) {
+    nex::DecodedLevel level;
+    level.width = size;
+    level.height = size;
+    level.pixels.resize(size_t(size) * size * 4);
+
+    uint32_t squareSize = std::max(size / 8, 1u);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint8_t value = ((x / squareSize + y / squareSize) % 2) ? 255 : 96;
+            uint8_t* texel = &level.pixels[(size_t(y) * size + x) * 4];
+            texel[0] = value;
+            texel[1] = value;
+            texel[2] = value;
+            texel[3] = 255;
+        }
+    }
+
+    nex::DecodedImage image;
+    image.width = size;
+    image.height = size;
+    image.levels.push_back(std::move(level));
+    return image;
+}
+
+} // namespace
+
 namespace nex {
 
 VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugCallback(
@@ -55,11 +103,23 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugCallback(
     return VK_FALSE;
 }
 
-Application::Application(std::string_view title, int width, int height)
+Application::Application(std::string_view title, int width, int height, const ApplicationConfig& config)
     : m_title(title)
     , m_width(width)
     , m_height(height)
+    , m_config(config)
 {
+    if (m_config.framesInFlight == 0) {
+        m_config.framesInFlight = PolicyFramesInFlight(m_config.presentPolicy);
+    }
+
+    if (m_config.scene.triangleCount == 0 || m_config.scene.drawCount == 0 || m_config.scene.pipelineCount == 0) {
+        throw std::invalid_argument("Scene needs at least one triangle, draw and pipeline");
+    }
+
+    if (!m_config.headless) {
+        m_requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 }
 
 Application::~Application() {
@@ -76,21 +136,144 @@ void Application::init() {
         return;
     }
 
-    initWindow();
-    initVulkan();
+    m_startupStopwatch.reset();
+
+    // The main thread takes trace thread id 0
+    Profiler::CurrentThreadId();
+    // Left alone otherwise, another application of a multi-device run may be capturing
+    if (!m_config.tracePath.empty()) {
+        Profiler::Get().setTraceCapture(true);
+    }
+
+    if (m_config.scene.instanceCount > 0 && m_config.gpuDriven) {
+        std::cerr << "[instancing] The instanced scene is batched on the CPU, ignoring the GPU-driven path" << std::endl;
+        m_config.gpuDriven = false;
+    }
+
+    StartupGraph startup(m_taskScheduler);
+    buildStartupGraph(startup);
+
+    try {
+        startup.run();
+    } catch (...) {
+        startup.report(std::cerr);
+        throw;
+    }
+
+    m_init = true;
+
+    m_runStats.startupMs = m_startupStopwatch.elapsedMs();
+    m_runStats.startupPhases = startup.timings();
+
+    startup.report(std::cout);
+    std::cout << "[startup] Initialization took " << m_runStats.startupMs << " ms" << std::endl;
+    std::cout << "[device] Rendering on " << m_runStats.deviceName << std::endl;
+    std::cout << m_memoryAllocator.stats() << std::flush;
 }
 
-void Application::initWindow() {
+void Application::buildStartupGraph(StartupGraph& startup) {
+    using Phase = StartupGraph::PhaseId;
+
+    // Reading and reflecting SPIR-V needs nothing from Vulkan, it overlaps everything up to the pipelines.
+    // The device phase may turn the GPU-driven path off meanwhile, so the requested setting is captured here.
+    bool gpuDrivenRequested = m_config.gpuDriven;
+    Phase shaders = startup.addPhase("loadShaders", PhaseThread::Worker, {}, [this, gpuDrivenRequested]() {
+        loadShaders(gpuDrivenRequested);
+    });
+
+    // GLFW has to be called from the main thread, the instance is created meanwhile
+    std::vector<Phase> instanceDependencies;
+    std::vector<Phase> deviceDependencies;
+    if (!m_config.headless) {
+        Phase windowSystem = startup.addPhase("initWindowSystem", PhaseThread::Main, {}, [this]() { initWindowSystem(); });
+        instanceDependencies.push_back(windowSystem);
+
+        Phase instance = startup.addPhase("createInstance", PhaseThread::Worker, instanceDependencies, [this]() {
+            createVulkanInstance();
+            createVulkanDebugMessenger();
+        });
+        Phase window = startup.addPhase("createWindow", PhaseThread::Main, { windowSystem }, [this]() { initWindow(); });
+        Phase surface = startup.addPhase("createSurface", PhaseThread::Main, { instance, window }, [this]() { createVulkanSurface(); });
+        deviceDependencies = { instance, surface };
+    } else {
+        Phase instance = startup.addPhase("createInstance", PhaseThread::Worker, {}, [this]() {
+            createVulkanInstance();
+            createVulkanDebugMessenger();
+        });
+        deviceDependencies = { instance };
+    }
+
+    Phase device = startup.addPhase("createDevice", PhaseThread::Worker, deviceDependencies, [this]() {
+        pickVulkanPhysicalDevice();
+        createVulkanLogicalDevice();
+    });
+
+    Phase deviceResources = startup.addPhase("initDeviceResources", PhaseThread::Worker, { device }, [this]() { initDeviceResources(); });
+
+    // Reads the cache file and validates it against the device while the swapchain is created
+    Phase pipelineCache = startup.addPhase("loadPipelineCache", PhaseThread::Worker, { device, shaders }, [this]() {
+        m_pipelineCache.create(m_pickedVkPhysicalDevice, m_vkDevice, m_config.pipelineCachePath);
+        m_pipelineRegistry.attachDevice(m_vkDevice, m_pipelineCache.handle());
+    });
+
+    // Offscreen targets are allocated, a swapchain is not
+    std::vector<Phase> swapchainDependencies { device };
+    if (m_config.headless) {
+        swapchainDependencies.push_back(deviceResources);
+    }
+    Phase swapchain = startup.addPhase("createSwapchain", PhaseThread::Main, swapchainDependencies, [this]() {
+        if (m_config.headless) {
+            createOffscreenTargets();
+            std::cout << "[present] Headless, " << m_config.framesInFlight << " frames in flight" << std::endl;
+        } else {
+            createSwapChain();
+            std::cout << "[present] Policy " << PresentPolicyName(m_config.presentPolicy) << ": "
+                      << PresentModeName(m_swapchainPresentMode) << ", " << m_swapchainImages.size() << " images, "
+                      << m_config.framesInFlight << " frames in flight" << std::endl;
+        }
+        createImageViews();
+    });
+
+    Phase renderGraph = startup.addPhase("createRenderGraph", PhaseThread::Main, { swapchain, deviceResources }, [this]() {
+        // The scene pass is declared with the recorder's worker count in mind
+        m_parallelRecorder.init(m_vkDevice, m_queueFamilyIndices.graphicsFamily.value(), m_taskScheduler, m_config.framesInFlight,
+                                m_config.recordThreads);
+        createRenderGraph();
+    });
+
+    // Compilation continues on the task scheduler after the phase returns
+    Phase pipelines = startup.addPhase("requestPipelines", PhaseThread::Main, { renderGraph, pipelineCache, shaders }, [this]() {
+        createGraphicsPipeline();
+        if (m_config.gpuDriven) {
+            createGpuCuller();
+        }
+    });
+
+    startup.addPhase("createCommandBuffers", PhaseThread::Worker, { swapchain }, [this]() {
+        createCommandPool();
+        m_gpuProfiler.init(m_pickedVkPhysicalDevice, m_vkDevice, m_queueFamilyIndices.graphicsFamily.value(), m_config.framesInFlight,
+                           Profiler::GpuThreadId + m_config.deviceIndex);
+        createCommandBuffers();
+        createSyncObjects();
+    });
+
+    // The only user of the staging uploader during startup, it is not thread safe
+    startup.addPhase("createScene", PhaseThread::Worker, { pipelines }, [this]() {
+        createSceneTexture();
+        createMeshes();
+    });
+
+    startup.addPhase("waitForPipelines", PhaseThread::Main, { pipelines }, [this]() { waitForPipelines(); });
+}
+
+void Application::initWindowSystem() {
     glfwSetErrorCallback([](int code, const char* description) {
         std::cerr << "GLFW error (" << code << "): " << description << std::endl;
     });
 
-    glfwInit();
-
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    
-    m_window = glfwCreateWindow(m_width, m_height, m_title.data(), nullptr, nullptr);
+    if (glfwInit() != GLFW_TRUE) {
+        throw std::runtime_error("Failed to initialize GLFW");
+    }
 
     // Get required for window vulkan instance extensions
     uint32_t glfwExtensionsCount = 0;
@@ -104,15 +287,58 @@ void Application::initWindow() {
     );
 }
 
-void Application::initVulkan() {
-    createVulkanInstance();
-    createVulkanDebugMessenger();
-    createVulkanSurface();
-    pickVulkanPhysicalDevice();
-    createVulkanLogicalDevice();
-    createSwapChain();
-    createRenderPass();
-    createGraphicsPipeline();
+void Application::initWindow() {
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    
+    m_window = glfwCreateWindow(m_width, m_height, m_title.data(), nullptr, nullptr);
+    if (m_window == nullptr) {
+        throw std::runtime_error("Failed to create window");
+    }
+
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int, int) {
+        static_cast<Application*>(glfwGetWindowUserPointer(window))->m_framebufferResized = true;
+    });
+    glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int) {
+        static_cast<Application*>(glfwGetWindowUserPointer(window))->onInput();
+    });
+    glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int) {
+        static_cast<Application*>(glfwGetWindowUserPointer(window))->onInput();
+    });
+    glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double) {
+        static_cast<Application*>(glfwGetWindowUserPointer(window))->onInput();
+    });
+}
+
+void Application::loadShaders(bool gpuDriven) {
+    std::string assetDirectory = AssetStore::ExecutableDirectory();
+    std::string assetArchivePath = m_config.assetArchivePath.empty() ? assetDirectory + "/assets.pak" : m_config.assetArchivePath;
+    m_assetStore.init(m_fileCache, assetArchivePath, assetDirectory);
+    m_pipelineRegistry.init(m_taskScheduler, m_assetStore);
+
+    // Whether the GPU-driven path survives device creation is not known yet, its shaders are cheap to load regardless
+    std::vector<std::string> shaderNames { SHADER_VERT_CODE_FILE, SHADER_FRAG_CODE_FILE };
+    if (gpuDriven) {
+        std::vector<std::string> cullerShaders = GpuCuller::Shaders();
+        shaderNames.insert(shaderNames.end(), cullerShaders.begin(), cullerShaders.end());
+    }
+
+    for (const auto& name : shaderNames) {
+        m_pipelineRegistry.reflect(name);
+    }
+}
+
+void Application::initDeviceResources() {
+    m_memoryAllocator.init(m_pickedVkPhysicalDevice, m_vkDevice);
+    m_bindlessDescriptors.init(m_pickedVkPhysicalDevice, m_vkDevice, m_config.framesInFlight);
+
+    m_stagingUploader.init(m_memoryAllocator, m_vkTransferQueue,
+                           m_queueFamilyIndices.transferFamily.value_or(m_queueFamilyIndices.graphicsFamily.value()),
+                           m_queueFamilyIndices.graphicsFamily.value());
+    m_textureStreamer.init(m_vkDevice, m_memoryAllocator, m_stagingUploader, m_bindlessDescriptors, m_taskScheduler, m_config.framesInFlight);
+
+    createDefaultSampler();
 }
 
 void Application::createVulkanInstance() {
@@ -122,7 +348,8 @@ void Application::createVulkanInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "NONE";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Descriptor indexing is core from 1.2 on
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo instanceCreateInfo {};
     instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -185,63 +412,132 @@ void Application::createVulkanSurface() {
 void Application::pickVulkanPhysicalDevice() {
     std::vector<VkPhysicalDevice> physicalDevices = VkDeviceUtils::PhysicalDevices(m_vkInstance);
 
-    uint32_t maxDeviceSuitability = 0;
-    VkPhysicalDevice bestSuitableDevice = VK_NULL_HANDLE;
+    DeviceRequirements requirements;
+    requirements.minImageDimension2D = static_cast<uint32_t>(std::max(m_width, m_height));
+    requirements.preferIndirectDraws = m_config.gpuDriven;
 
+    struct Candidate {
+        VkPhysicalDevice device = VK_NULL_HANDLE;
+        uint64_t suitability = 0;
+        DeviceQueueFamilyIndices queueFamilyIndices;
+    };
+    std::vector<Candidate> candidates;
+
+    // Cheap checks first, the surface is queried below only while walking down the ranking
     for (const auto& device : physicalDevices) {
         VkExtensions deviceExtensions = VkExtensions::DeviceExtensions(device);
         if (!deviceExtensions.extensionsAvailable(m_requiredDeviceExtensions.begin(), m_requiredDeviceExtensions.end())) {
             continue;
         }
 
-        DeviceSwapChainInfo deviceSwapChainInfo = VkDeviceUtils::GetDeviceSwapChainInfo(device, m_vkSurface);
-        if (deviceSwapChainInfo.formats.empty() || deviceSwapChainInfo.presentModes.empty()) {
+        if (!BindlessDescriptors::DeviceSupported(device)) {
+            continue;
+        }
+
+        uint64_t deviceSuitability = VkDeviceUtils::RateDeviceSuitability(device, requirements);
+        if (deviceSuitability == 0) {
             continue;
         }
 
-        uint32_t deviceSuitability = VkDeviceUtils::RateDeviceSuitability(device);
-        
-        if (deviceSuitability > maxDeviceSuitability) {
-            maxDeviceSuitability = deviceSuitability;
-            bestSuitableDevice = device;
+        DeviceQueueFamilyIndices queueFamilyIndices = VkDeviceUtils::FindDeviceQueueFamilies(device, m_vkSurface);
+        if (!queueFamilyIndices.isComplete(m_vkSurface != VK_NULL_HANDLE)) {
+            continue;
         }
+
+        candidates.push_back({ device, deviceSuitability, queueFamilyIndices });
     }
 
-    m_pickedVkPhysicalDevice = bestSuitableDevice;
+    // Enumeration order breaks ties, so every application of a multi-device run sees the same ranking
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& lhs, const Candidate& rhs) { return lhs.suitability > rhs.suitability; });
+
+    uint32_t rank = 0;
+    for (const auto& candidate : candidates) {
+        // What the device reported is kept for the first swapchain creation
+        std::optional<DeviceSwapChainInfo> swapChainInfo;
+        if (m_vkSurface != VK_NULL_HANDLE) {
+            swapChainInfo = VkDeviceUtils::GetDeviceSwapChainInfo(candidate.device, m_vkSurface);
+            if (swapChainInfo->formats.empty() || swapChainInfo->presentModes.empty()) {
+                continue;
+            }
+        }
+
+        if (rank++ < m_config.deviceIndex) {
+            continue;
+        }
+
+        m_pickedVkPhysicalDevice = candidate.device;
+        m_queueFamilyIndices = candidate.queueFamilyIndices;
+        m_pickedSwapChainInfo = std::move(swapChainInfo);
+        break;
+    }
 
     if (m_pickedVkPhysicalDevice == VK_NULL_HANDLE) {
+        if (rank > 0) {
+            throw std::runtime_error("Device " + std::to_string(m_config.deviceIndex) + " requested, but only "
+                                     + std::to_string(rank) + " suitable physical devices were found");
+        }
         throw std::runtime_error("Failed to find any suitable physical device");
     }
+
+    m_runStats.deviceName = VkDeviceUtils::DeviceName(m_pickedVkPhysicalDevice);
 }
 
 void Application::createVulkanLogicalDevice() {
-    DeviceQueueFamilyIndices deviceQueueFamilyIndices = VkDeviceUtils::FindDeviceQueueFamilies(m_pickedVkPhysicalDevice, m_vkSurface);
-
-    if (!deviceQueueFamilyIndices.isComplete()) {
-        throw std::runtime_error("Failed to find necessary queue family");
-    }
+    const DeviceQueueFamilyIndices& deviceQueueFamilyIndices = m_queueFamilyIndices;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
-    std::set<uint32_t> uniqueQueueFamilyIndices { 
-        deviceQueueFamilyIndices.graphicsFamily.value(), deviceQueueFamilyIndices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilyIndices { deviceQueueFamilyIndices.graphicsFamily.value() };
+    if (deviceQueueFamilyIndices.presentFamily.has_value()) {
+        uniqueQueueFamilyIndices.insert(deviceQueueFamilyIndices.presentFamily.value());
+    }
+    if (deviceQueueFamilyIndices.transferFamily.has_value()) {
+        uniqueQueueFamilyIndices.insert(deviceQueueFamilyIndices.transferFamily.value());
+    }
+
+    float queuePriority = 1.0;
 
     for (uint32_t queueFamilyIdx : uniqueQueueFamilyIndices) {
         VkDeviceQueueCreateInfo queueCreateInfo {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = deviceQueueFamilyIndices.graphicsFamily.value();
+        queueCreateInfo.queueFamilyIndex = queueFamilyIdx;
         queueCreateInfo.queueCount = 1;
-
-        float queuePriority = 1.0;
         queueCreateInfo.pQueuePriorities = &queuePriority;
 
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features {};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures {};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supportedVulkan12Features;
+    vkGetPhysicalDeviceFeatures2(m_pickedVkPhysicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures {};
 
+    VkPhysicalDeviceVulkan12Features vulkan12Features {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    BindlessDescriptors::EnableRequiredFeatures(vulkan12Features);
+
+    // Indirect draws carry the draw index in firstInstance and cover many draws each
+    if (m_config.gpuDriven && (!supportedFeatures.features.multiDrawIndirect || !supportedFeatures.features.drawIndirectFirstInstance)) {
+        std::cerr << "[cull] Device lacks multiDrawIndirect or drawIndirectFirstInstance, using the CPU-driven path" << std::endl;
+        m_config.gpuDriven = false;
+    }
+    if (m_config.gpuDriven) {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+        m_drawIndirectCountSupported = supportedVulkan12Features.drawIndirectCount;
+        vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+    }
+
     VkDeviceCreateInfo deviceCreateInfo {};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pNext = &vulkan12Features;
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
 
@@ -258,33 +554,38 @@ void Application::createVulkanLogicalDevice() {
     }
 
     vkGetDeviceQueue(m_vkDevice, deviceQueueFamilyIndices.graphicsFamily.value(), 0, &m_vkGraphicsQueue);
-    vkGetDeviceQueue(m_vkDevice, deviceQueueFamilyIndices.presentFamily.value(), 0, &m_vkPresentQueue);
+    if (deviceQueueFamilyIndices.presentFamily.has_value()) {
+        vkGetDeviceQueue(m_vkDevice, deviceQueueFamilyIndices.presentFamily.value(), 0, &m_vkPresentQueue);
+    }
+
+    m_vkTransferQueue = m_vkGraphicsQueue;
+    if (deviceQueueFamilyIndices.transferFamily.has_value()) {
+        vkGetDeviceQueue(m_vkDevice, deviceQueueFamilyIndices.transferFamily.value(), 0, &m_vkTransferQueue);
+    }
 }
 
 void Application::createSwapChain() {
-    DeviceSwapChainInfo swapChainInfo = VkDeviceUtils::GetDeviceSwapChainInfo(m_pickedVkPhysicalDevice, m_vkSurface);
+    // Recreations query again, the surface capabilities change with the window size
+    DeviceSwapChainInfo swapChainInfo = m_pickedSwapChainInfo ? std::move(*m_pickedSwapChainInfo)
+                                                              : VkDeviceUtils::GetDeviceSwapChainInfo(m_pickedVkPhysicalDevice, m_vkSurface);
+    m_pickedSwapChainInfo.reset();
 
     VkSurfaceFormatKHR choosedSurfaceFormat = chooseSurfaceFormat(swapChainInfo.formats);
-    VkPresentModeKHR choosedPresentMode = choosePresentMode(swapChainInfo.presentModes);
     VkExtent2D choosedSwapchainExtent = chooseSwapExtent(swapChainInfo.capabilities);
-
-    uint32_t imageCount = swapChainInfo.capabilities.minImageCount + 1;
-    if (swapChainInfo.capabilities.maxImageCount > 0 && imageCount <= swapChainInfo.capabilities.maxImageCount) {
-        imageCount = swapChainInfo.capabilities.maxImageCount;
-    }
+    PresentConfiguration presentConfiguration = ChoosePresentConfiguration(m_config.presentPolicy, swapChainInfo.capabilities, swapChainInfo.presentModes);
 
     VkSwapchainCreateInfoKHR swapChainCreateInfo {};
     swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    swapChainCreateInfo.minImageCount = imageCount;
+    swapChainCreateInfo.minImageCount = presentConfiguration.imageCount;
     swapChainCreateInfo.imageFormat = choosedSurfaceFormat.format;
     swapChainCreateInfo.imageColorSpace = choosedSurfaceFormat.colorSpace;
-    swapChainCreateInfo.presentMode = choosedPresentMode;
+    swapChainCreateInfo.presentMode = presentConfiguration.presentMode;
     swapChainCreateInfo.imageExtent = choosedSwapchainExtent;
     swapChainCreateInfo.imageArrayLayers = 1;
     swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     swapChainCreateInfo.surface = m_vkSurface;
 
-    DeviceQueueFamilyIndices queueFamilyIndices = VkDeviceUtils::FindDeviceQueueFamilies(m_pickedVkPhysicalDevice, m_vkSurface);
+    const DeviceQueueFamilyIndices& queueFamilyIndices = m_queueFamilyIndices;
 
     std::array<uint32_t, 2> indices { queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value() };
 
@@ -301,11 +602,14 @@ void Application::createSwapChain() {
     swapChainCreateInfo.preTransform = swapChainInfo.capabilities.currentTransform;
     swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapChainCreateInfo.clipped = VK_TRUE;
-    swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Lets the driver reuse resources of the swapchain being replaced; it is retired, not destroyed, here
+    swapChainCreateInfo.oldSwapchain = m_vkSwapchain;
 
-    if (VkResult result = vkCreateSwapchainKHR(m_vkDevice, &swapChainCreateInfo, nullptr, &m_vkSwapchain); result != VK_SUCCESS) {
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    if (VkResult result = vkCreateSwapchainKHR(m_vkDevice, &swapChainCreateInfo, nullptr, &swapchain); result != VK_SUCCESS) {
         throw std::runtime_error("Failed to create vulkan swapchain");
     }
+    m_vkSwapchain = swapchain;
 
     uint32_t swapchainImageCount = 0;
     vkGetSwapchainImagesKHR(m_vkDevice, m_vkSwapchain, &swapchainImageCount, nullptr);
@@ -314,6 +618,93 @@ void Application::createSwapChain() {
 
     m_swapchainImageFormat = choosedSurfaceFormat;
     m_swapchainImageExtent = choosedSwapchainExtent;
+    m_swapchainPresentMode = presentConfiguration.presentMode;
+}
+
+void Application::recreateSwapChain() {
+    int windowWidth = 0;
+    int windowHeight = 0;
+    glfwGetFramebufferSize(m_window, &windowWidth, &windowHeight);
+
+    // A minimized window has no valid extent; keep the request until it is restored
+    if (windowWidth == 0 || windowHeight == 0) {
+        return;
+    }
+
+    utils::Stopwatch stopwatch;
+
+    RetiredSwapchain retired;
+    retired.swapchain = m_vkSwapchain;
+    retired.imageViews = std::move(m_swapchainImageViews);
+    retired.renderFinishedSemaphores = std::move(m_renderFinishedSemaphores);
+    retired.retiredAtFrame = m_frameCounter;
+
+    m_swapchainImageViews.clear();
+    m_renderFinishedSemaphores.clear();
+
+    // The render pass and pipelines only depend on the format, viewport and scissor are dynamic
+    createSwapChain();
+    createImageViews();
+    retired.renderGraphResources = m_renderGraph.resize(m_swapchainImageExtent);
+    if (m_config.gpuDriven) {
+        m_gpuCuller.resize(m_swapchainImageExtent, m_renderGraph.imageView(m_depthBuffer));
+    }
+    createRenderFinishedSemaphores();
+
+    m_retiredSwapchains.push_back(std::move(retired));
+    m_framebufferResized = false;
+
+    std::cout << "[swapchain] Recreated " << m_swapchainImageExtent.width << "x" << m_swapchainImageExtent.height
+              << " in " << stopwatch.elapsedMs() << " ms" << std::endl;
+}
+
+void Application::releaseRetiredSwapchains(bool force) {
+    auto iter = m_retiredSwapchains.begin();
+
+    // Called right after waiting on the current slot's fence, so once every slot has
+    // been waited on since the retirement no frame still references the old resources
+    for (; iter != m_retiredSwapchains.end(); ++iter) {
+        if (!force && m_frameCounter + 1 < iter->retiredAtFrame + m_frames.size()) {
+            break;
+        }
+
+        for (auto& semaphore : iter->renderFinishedSemaphores) {
+            vkDestroySemaphore(m_vkDevice, semaphore, nullptr);
+        }
+        m_renderGraph.destroyResources(iter->renderGraphResources);
+        for (auto& imageView : iter->imageViews) {
+            vkDestroyImageView(m_vkDevice, imageView, nullptr);
+        }
+        vkDestroySwapchainKHR(m_vkDevice, iter->swapchain, nullptr);
+    }
+
+    m_retiredSwapchains.erase(m_retiredSwapchains.begin(), iter);
+}
+
+void Application::createOffscreenTargets() {
+    m_swapchainImageFormat = { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+    m_swapchainImageExtent = { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height) };
+
+    // One target per frame slot: the slot fence already guarantees the GPU is done with it
+    m_offscreenImages.resize(m_config.framesInFlight);
+
+    for (auto& offscreenImage : m_offscreenImages) {
+        VkImageCreateInfo imageCreateInfo {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = m_swapchainImageFormat.format;
+        imageCreateInfo.extent = { m_swapchainImageExtent.width, m_swapchainImageExtent.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        offscreenImage = m_memoryAllocator.createImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_swapchainImages.push_back(offscreenImage.image);
+    }
 }
 
 void Application::createImageViews() {
@@ -342,76 +733,519 @@ void Application::createImageViews() {
     }
 }
 
-void Application::createRenderPass() {
-    VkAttachmentDescription colorAttachment {};
-    colorAttachment.format = m_swapchainImageFormat.format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+void Application::createRenderGraph() {
+    m_renderGraph.init(m_memoryAllocator);
+
+    // The image is acquired asynchronously, so its first transition must wait
+    // for the same stage the image available semaphore is waited at
+    ImportedImageDesc backbufferDesc;
+    backbufferDesc.format = m_swapchainImageFormat.format;
+    backbufferDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    backbufferDesc.initialStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // Offscreen targets are left ready to be copied out
+    backbufferDesc.finalLayout = m_config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    m_backbuffer = m_renderGraph.importImage("backbuffer", backbufferDesc);
+
+    RenderImageDesc depthBufferDesc;
+    depthBufferDesc.format = chooseDepthFormat();
+    m_depthBuffer = m_renderGraph.createImage("depth", depthBufferDesc);
+
+    // Culling writes buffers the graph does not track, so the passes order themselves by side effects
+    if (m_config.gpuDriven) {
+        m_cullPass = m_renderGraph.addPass("cull",
+            [](RenderPassBuilder& builder) { builder.setSideEffects(); },
+            [this](const RenderPassContext& context) { m_gpuCuller.recordCull(context.commandBuffer); });
+    }
+
+    m_scenePass = m_renderGraph.addPass("scene",
+        [this](RenderPassBuilder& builder) {
+            builder.colorAttachment(m_backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, {{ 0.0f, 0.0f, 0.0f, 1.0f }});
+            builder.depthAttachment(m_depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+            bool secondaries = !m_config.gpuDriven && m_config.scene.instanceCount == 0 && sceneChunkCount() > 1;
+            builder.setSubpassContents(secondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        },
+        [this](const RenderPassContext& context) { recordScenePass(context); });
+
+    // Next frame's occlusion culling tests against this frame's depth
+    if (m_config.gpuDriven) {
+        m_hizPass = m_renderGraph.addPass("hiz",
+            [this](RenderPassBuilder& builder) {
+                builder.read(m_depthBuffer, ImageAccess::ComputeSampled);
+                builder.setSideEffects();
+            },
+            [this](const RenderPassContext& context) { m_gpuCuller.recordHiZ(context.commandBuffer); });
+    }
 
-    VkAttachmentReference colorAttachmentRef {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    m_renderGraph.compile();
+    m_renderGraph.resize(m_swapchainImageExtent);
 
-    VkSubpassDescription subpass {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
+    const RenderGraphStats& stats = m_renderGraph.stats();
+    constexpr double MiB = 1024.0 * 1024.0;
 
-    VkRenderPassCreateInfo renderPassCreateInfo {};
-    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassCreateInfo.attachmentCount = 1;
-    renderPassCreateInfo.pAttachments = &colorAttachment;
-    renderPassCreateInfo.subpassCount = 1;
-    renderPassCreateInfo.pSubpasses = &subpass;
-    if (VkResult result = vkCreateRenderPass(m_vkDevice, &renderPassCreateInfo, nullptr, &m_vkRenderPass); result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create render pass");
-    }
+    std::cout << "[graph] " << stats.passCount - stats.culledPassCount << " of " << stats.passCount << " passes, "
+              << stats.barrierCount << " barriers per frame" << std::endl;
+    std::cout << "[graph] " << stats.renderTargets.targetCount << " render targets: " << stats.renderTargets.allocatedBytes / MiB
+              << " MiB allocated in " << stats.renderTargets.memoryRegionCount << " regions, " << stats.renderTargets.lazilyAllocatedCount
+              << " lazily allocated (" << stats.renderTargets.lazilyAllocatedBytes / MiB << " MiB), "
+              << stats.renderTargets.savedBytes() / MiB << " of " << stats.renderTargets.requestedBytes / MiB << " MiB saved" << std::endl;
 }
 
 void Application::createGraphicsPipeline() {
-    auto shaderVertCode = utils::ReadFile(SHADER_VERT_CODE_FILE);
-    auto shaderFragCode = utils::ReadFile(SHADER_FRAG_CODE_FILE);
-
-    auto shaderVertModule = createShaderModule(shaderVertCode);
-    auto shaderFragModule = createShaderModule(shaderFragCode);
+    // Loaded by the loadShaders phase, reported here to keep the output in order
+    std::string assetDirectory = AssetStore::ExecutableDirectory();
+    if (m_assetStore.archive().isOpen()) {
+        std::cout << "[assets] " << m_assetStore.archive().entryCount() << " assets in " << m_assetStore.archive().filepath() << std::endl;
+    } else {
+        std::string assetArchivePath = m_config.assetArchivePath.empty() ? assetDirectory + "/assets.pak" : m_config.assetArchivePath;
+        std::cout << "[assets] No archive at " << assetArchivePath << ", loading loose files from " << assetDirectory << std::endl;
+    }
 
-    VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo {};
-    vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageCreateInfo.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageCreateInfo.pName = "main";
-    vertShaderStageCreateInfo.module = shaderVertModule;
+    // Every pipeline shares the bindless set and one push constant range, so
+    // neither has to be rebound when draws switch pipelines. The layout itself
+    // comes from the shaders, which are checked against both.
+    SharedDescriptorSet bindlessSet;
+    bindlessSet.set = 0;
+    bindlessSet.layout = m_bindlessDescriptors.setLayout();
+    bindlessSet.bindings.assign(m_bindlessDescriptors.setLayoutBindings().begin(), m_bindlessDescriptors.setLayoutBindings().end());
+    m_pipelineLayouts.init(m_vkDevice, { bindlessSet }, BindlessDescriptors::PushConstantRange());
+
+    m_vkPipelineLayout = m_pipelineLayouts.acquire({ m_pipelineRegistry.reflect(SHADER_VERT_CODE_FILE).get(),
+                                                     m_pipelineRegistry.reflect(SHADER_FRAG_CODE_FILE).get() });
+
+    // Compilation runs on the task scheduler while the rest of the initialization continues
+    for (uint32_t variant = 0; variant < m_config.scene.pipelineCount; ++variant) {
+        m_scenePipelines.push_back(m_pipelineRegistry.request(scenePipelineDesc(variant)));
+    }
 
-    VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo {};
-    fragShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageCreateInfo.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageCreateInfo.pName = "main";
-    fragShaderStageCreateInfo.module = shaderFragModule;
+    if (m_config.hotReloadShaders) {
+        std::string sourceDirectory = m_config.shaderSourceDirectory.empty() ? SHADER_SOURCE_DIRECTORY : m_config.shaderSourceDirectory;
+        m_shaderHotReloader.init(sourceDirectory, assetDirectory + "/hot_reload", SHADER_COMPILER_PATH);
+        std::cout << "[reload] Watching " << sourceDirectory << " for shader changes" << std::endl;
+    }
+}
 
-    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStageCreateInfos { vertShaderStageCreateInfo, fragShaderStageCreateInfo };
+GraphicsPipelineDesc Application::scenePipelineDesc(uint32_t variant) const {
+    GraphicsPipelineDesc desc;
+    desc.vertexShader = SHADER_VERT_CODE_FILE;
+    desc.fragmentShader = SHADER_FRAG_CODE_FILE;
+    // Disabled features are compiled out of the pipeline instead of branched over per pixel
+    desc.vertexPermutation.setFlag(VertexColorConstant, m_config.scene.vertexColor);
+    desc.fragmentPermutation.setFlag(TexturedConstant, !m_config.texturePath.empty() || m_config.generatedTextureSize > 0)
+                            .setUint(TextureTapsConstant, std::max(m_config.scene.textureTaps, 1u));
+    desc.vertexLayout = Vertex::Layout();
+    InstanceData::AppendLayout(desc.vertexLayout);
+    desc.layout = m_vkPipelineLayout;
+    desc.renderPass = m_renderGraph.renderPass(m_scenePass);
+    // Everything is at depth 0, so less-or-equal keeps the submission order result
+    desc.depthTest = true;
+    desc.depthWrite = true;
+    desc.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    desc.subpass = 0;
+
+    if (variant == 0) {
+        return desc;
+    }
 
-    std::array<VkDynamicState, 2> dynamicStates = {
-        VkDynamicState::VK_DYNAMIC_STATE_VIEWPORT,
-        VkDynamicState::VK_DYNAMIC_STATE_SCISSOR,
+    // Further variants only differ in blend and cull state, which is enough to make
+    // them distinct pipelines; past 2 * 10 * 10 variants they repeat and get deduplicated
+    constexpr std::array<VkBlendFactor, 10> blendFactors {
+        VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE,
+        VK_BLEND_FACTOR_SRC_COLOR, VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR,
+        VK_BLEND_FACTOR_DST_COLOR, VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR,
+        VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        VK_BLEND_FACTOR_DST_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA,
     };
 
-    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo {};
-    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
-    dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+    uint32_t combination = (variant - 1) % (2 * blendFactors.size() * blendFactors.size());
+
+    desc.blendEnable = true;
+    desc.dstColorBlendFactor = blendFactors[combination % blendFactors.size()];
+    desc.dstAlphaBlendFactor = blendFactors[combination / blendFactors.size() % blendFactors.size()];
+    desc.cullMode = combination / (blendFactors.size() * blendFactors.size()) == 0 ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+
+    return desc;
+}
+
+void Application::waitForPipelines() {
+    m_pipelineRegistry.waitAll();
+
+    PipelineRegistryStats stats = m_pipelineRegistry.stats();
+
+    std::cout << "[startup] " << stats.compiled << " pipelines (" << stats.deduplicated << " deduplicated requests) built in "
+              << stats.wallMs << " ms wall, " << stats.compileMs << " ms summed over " << m_taskScheduler.threadCount()
+              << " threads with " << (m_pipelineCache.warm() ? "warm" : "cold") << " pipeline cache" << std::endl;
+    std::cout << "[startup] " << m_pipelineLayouts.layoutCount() << " pipeline layouts from shader reflection" << std::endl;
+
+    if (m_config.comparePipelineCache) {
+        reportPipelineCacheComparison(stats.wallMs);
+    }
+}
+
+void Application::reportPipelineCacheComparison(double warmPipelineMs) {
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo {};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
 
-    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo {};
-    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipelineCache coldPipelineCache = VK_NULL_HANDLE;
+    if (VkResult result = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, nullptr, &coldPipelineCache); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+
+    double coldPipelineMs = 0.0;
+    {
+        PipelineRegistry coldPipelineRegistry;
+        coldPipelineRegistry.init(m_taskScheduler, m_assetStore);
+        coldPipelineRegistry.attachDevice(m_vkDevice, coldPipelineCache);
+        for (uint32_t variant = 0; variant < m_config.scene.pipelineCount; ++variant) {
+            coldPipelineRegistry.request(scenePipelineDesc(variant));
+        }
+        coldPipelineRegistry.waitAll();
+
+        coldPipelineMs = coldPipelineRegistry.stats().wallMs;
+    }
+
+    vkDestroyPipelineCache(m_vkDevice, coldPipelineCache, nullptr);
+
+    std::cout << "[startup] Pipeline cache comparison: cold " << coldPipelineMs << " ms, "
+              << (m_pipelineCache.warm() ? "warm " : "current (cold) ") << warmPipelineMs << " ms";
+    if (warmPipelineMs > 0.0) {
+        std::cout << ", speedup x" << coldPipelineMs / warmPipelineMs;
+    }
+    std::cout << std::endl;
+}
+
+void Application::createCommandPool() {
+    const DeviceQueueFamilyIndices& queueFamilyIndices = m_queueFamilyIndices;
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    if (VkResult result = vkCreateCommandPool(m_vkDevice, &commandPoolCreateInfo, nullptr, &m_vkCommandPool); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool");
+    }
+}
+
+void Application::createCommandBuffers() {
+    m_frames.resize(m_config.framesInFlight);
+
+    std::vector<VkCommandBuffer> commandBuffers(m_frames.size());
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo {};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = m_vkCommandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = commandBuffers.size();
+
+    if (VkResult result = vkAllocateCommandBuffers(m_vkDevice, &commandBufferAllocateInfo, commandBuffers.data()); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffers");
+    }
+
+    for (size_t i = 0; i < m_frames.size(); ++i) {
+        m_frames[i].commandBuffer = commandBuffers[i];
+    }
+}
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo {};
-    inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyCreateInfo.topology = VkPrimitiveTopology::VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+void Application::createSyncObjects() {
+    VkSemaphoreCreateInfo semaphoreCreateInfo {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+    // Fences start signaled so the first wait on every frame slot returns immediately
+    VkFenceCreateInfo fenceCreateInfo {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (auto& frame : m_frames) {
+        if (VkResult result = vkCreateSemaphore(m_vkDevice, &semaphoreCreateInfo, nullptr, &frame.imageAvailableSemaphore); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create image available semaphore");
+        }
+
+        if (VkResult result = vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &frame.inFlightFence); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create in flight fence");
+        }
+    }
+
+    createRenderFinishedSemaphores();
+}
+
+void Application::createRenderFinishedSemaphores() {
+    if (m_vkSwapchain == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    m_renderFinishedSemaphores.resize(m_swapchainImages.size());
+
+    for (auto& semaphore : m_renderFinishedSemaphores) {
+        if (VkResult result = vkCreateSemaphore(m_vkDevice, &semaphoreCreateInfo, nullptr, &semaphore); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render finished semaphore");
+        }
+    }
+}
+
+void Application::createDefaultSampler() {
+    VkSamplerCreateInfo samplerCreateInfo {};
+    samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+    samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (VkResult result = vkCreateSampler(m_vkDevice, &samplerCreateInfo, nullptr, &m_defaultSampler); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create default sampler");
+    }
+
+    m_defaultSamplerSlot = m_bindlessDescriptors.addSampler(m_defaultSampler);
+}
+
+void Application::createGpuCuller() {
+    m_gpuCuller.init(m_vkDevice, m_memoryAllocator, m_bindlessDescriptors, m_pipelineRegistry, m_pipelineLayouts,
+                     m_config.framesInFlight, m_drawIndirectCountSupported);
+    m_gpuCuller.resize(m_swapchainImageExtent, m_renderGraph.imageView(m_depthBuffer));
+}
+
+void Application::createSceneTexture() {
+    if (!m_config.texturePath.empty()) {
+        m_sceneTexture = m_textureStreamer.load(m_config.texturePath);
+    } else if (m_config.generatedTextureSize > 0) {
+        uint32_t size = m_config.generatedTextureSize;
+        m_sceneTexture = m_textureStreamer.load("checker", [size]() { return GenerateCheckerImage(size); });
+    }
+}
+
+void Application::createMeshes() {
+    SceneConfig scene = m_config.scene;
+    // Instances are scaled copies of the one triangle filling the viewport
+    if (scene.instanceCount > 0) {
+        scene.triangleCount = 1;
+        scene.drawCount = 1;
+    }
+
+    // One triangle per grid cell, a single triangle fills the viewport like the original one
+    uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(scene.triangleCount))));
+    float cellSize = 2.0f / gridSize;
+    float halfExtent = cellSize / 4.0f;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    vertices.reserve(3 * scene.triangleCount);
+    indices.reserve(3 * scene.triangleCount);
+
+    for (uint32_t triangleIdx = 0; triangleIdx < scene.triangleCount; ++triangleIdx) {
+        glm::vec2 center(-1.0f + cellSize * (triangleIdx % gridSize + 0.5f), -1.0f + cellSize * (triangleIdx / gridSize + 0.5f));
+
+        uint32_t firstVertex = static_cast<uint32_t>(vertices.size());
+        vertices.push_back({ center + glm::vec2(0.0f, -halfExtent), glm::vec3(1.0f, 0.0f, 0.0f) });
+        vertices.push_back({ center + glm::vec2(-halfExtent, halfExtent), glm::vec3(0.0f, 1.0f, 0.0f) });
+        vertices.push_back({ center + glm::vec2(halfExtent, halfExtent), glm::vec3(0.0f, 0.0f, 1.0f) });
+
+        indices.insert(indices.end(), { firstVertex, firstVertex + 1, firstVertex + 2 });
+    }
+
+    m_sceneMesh.create(m_memoryAllocator, m_stagingUploader, vertices, indices);
+
+    // Spread the triangles evenly, the first draws take the remainder
+    uint32_t drawCount = std::min(scene.drawCount, scene.triangleCount);
+    uint32_t firstTriangle = 0;
+
+    for (uint32_t drawIdx = 0; drawIdx < drawCount; ++drawIdx) {
+        uint32_t triangleCount = scene.triangleCount / drawCount + (drawIdx < scene.triangleCount % drawCount ? 1 : 0);
+        m_sceneDraws.push_back({ 3 * firstTriangle, 3 * triangleCount });
+        firstTriangle += triangleCount;
+    }
+
+    // Untextured and untinted for now, draws find their entry through firstInstance
+    std::vector<SceneDrawData> drawData(drawCount);
+    for (auto& data : drawData) {
+        data.texture = m_sceneTexture;
+        data.samplerSlot = m_defaultSamplerSlot;
+    }
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(SceneDrawData) * drawData.size();
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    m_sceneDrawData = m_memoryAllocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    m_stagingUploader.uploadBuffer(m_sceneDrawData.buffer, 0, drawData.data(), bufferCreateInfo.size,
+                                   VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    m_sceneDrawDataSlot = m_bindlessDescriptors.addStorageBuffer(m_sceneDrawData.buffer);
+
+    std::vector<InstanceData> drawInstances(drawCount);
+    for (uint32_t drawIdx = 0; drawIdx < drawCount; ++drawIdx) {
+        drawInstances[drawIdx].drawIndex = drawIdx;
+    }
+
+    bufferCreateInfo.size = sizeof(InstanceData) * drawInstances.size();
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    m_sceneDrawInstances = m_memoryAllocator.createBuffer(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    m_stagingUploader.uploadBuffer(m_sceneDrawInstances.buffer, 0, drawInstances.data(), bufferCreateInfo.size,
+                                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+    if (scene.instanceCount > 0) {
+        m_instanceBatcher.init(m_memoryAllocator, m_config.framesInFlight, scene.instanceCount);
+    }
+
+    if (m_config.gpuDriven) {
+        uint32_t bucketCount = static_cast<uint32_t>(m_scenePipelines.size());
+        std::vector<GpuCullObject> objects;
+        objects.reserve(drawCount);
+
+        // Draws cycle through the pipelines like on the CPU path, grouped by pipeline for the indirect draws
+        for (uint32_t bucket = 0; bucket < bucketCount; ++bucket) {
+            for (uint32_t drawIdx = bucket; drawIdx < drawCount; drawIdx += bucketCount) {
+                const SceneDraw& draw = m_sceneDraws[drawIdx];
+
+                glm::vec2 boundsMin(std::numeric_limits<float>::max());
+                glm::vec2 boundsMax(std::numeric_limits<float>::lowest());
+                for (uint32_t index = draw.firstIndex; index < draw.firstIndex + draw.indexCount; ++index) {
+                    boundsMin = glm::min(boundsMin, vertices[indices[index]].position);
+                    boundsMax = glm::max(boundsMax, vertices[indices[index]].position);
+                }
+
+                GpuCullObject object;
+                object.boundingSphere = glm::vec4((boundsMin + boundsMax) * 0.5f, 0.0f, glm::length(boundsMax - boundsMin) * 0.5f);
+                object.firstIndex = draw.firstIndex;
+                object.indexCount = draw.indexCount;
+                object.drawIndex = drawIdx;
+                object.bucket = bucket;
+                objects.push_back(object);
+            }
+        }
+
+        m_gpuCuller.setObjects(objects, bucketCount, m_stagingUploader);
+    }
+
+    BindlessStats bindlessStats = m_bindlessDescriptors.stats();
+    std::cout << "[bindless] Capacity " << bindlessStats.capacity[0] << " images, " << bindlessStats.capacity[1] << " samplers, "
+              << bindlessStats.capacity[2] << " storage buffers" << std::endl;
+}
+
+void Application::submitSceneInstances() {
+    ScopedCpuTimer batchTimer("batchInstances");
+
+    uint32_t instanceCount = m_config.scene.instanceCount;
+    uint32_t pipelineCount = static_cast<uint32_t>(m_scenePipelines.size());
+    uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    float cellSize = 2.0f / gridSize;
+    const SceneDraw& draw = m_sceneDraws.front();
+
+    m_instanceBatcher.begin(m_currentFrame);
+
+    // Instances cycle through the pipelines like the draws, so each pipeline ends up as one instanced draw
+    for (uint32_t instanceIdx = 0; instanceIdx < instanceCount; ++instanceIdx) {
+        InstanceData instance;
+        instance.offset = glm::vec2(-1.0f + cellSize * (instanceIdx % gridSize + 0.5f), -1.0f + cellSize * (instanceIdx / gridSize + 0.5f));
+        instance.scale = 1.0f / gridSize;
+        m_instanceBatcher.add(instanceIdx % pipelineCount, draw.firstIndex, draw.indexCount, instance);
+    }
+
+    m_instanceBatcher.flush();
+}
+
+void Application::reloadShaders() {
+    std::vector<CompiledShader> compiledShaders = m_shaderHotReloader.takeCompiled();
+    if (!compiledShaders.empty()) {
+        std::vector<std::string> names;
+        for (const auto& shader : compiledShaders) {
+            m_assetStore.redirect(shader.name, shader.filepath);
+            names.push_back(shader.name);
+        }
+
+        // Frames keep using the current pipelines until the rebuilt ones are ready
+        size_t rebuilding = m_pipelineRegistry.reloadShaders(names);
+        std::cout << "[reload] Rebuilding " << rebuilding << " pipelines" << std::endl;
+    }
+
+    // Handles are shared, so the scene, the batcher and the culler pick the new pipelines up as is
+    if (size_t swapped = m_pipelineRegistry.swapReloaded(m_frameCounter, m_config.framesInFlight); swapped > 0) {
+        std::cout << "[reload] Swapped in " << swapped << " pipelines" << std::endl;
+    }
+}
+
+void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                                      std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages) {
+    VkCommandBufferBeginInfo commandBufferBeginInfo {};
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffer");
+    }
+
+    // Take over buffers uploaded since the previous frame before the render pass reads them
+    std::vector<VkSemaphore> uploadSemaphores = m_stagingUploader.acquire(commandBuffer, waitStages);
+    waitSemaphores.insert(waitSemaphores.end(), uploadSemaphores.begin(), uploadSemaphores.end());
+    m_textureStreamer.record(commandBuffer);
+
+    // The slot's previous frame is resolved here, framesInFlight frames after it was recorded
+    std::optional<double> gpuFrameMs = m_gpuProfiler.beginFrame(commandBuffer, m_currentFrame);
+    if (gpuFrameMs && m_frameCounter >= m_config.warmupFrames + m_frames.size()) {
+        m_runStats.gpuFrameMs.push_back(*gpuFrameMs);
+    }
+
+    m_renderGraph.setImportedImage(m_backbuffer, m_swapchainImages[imageIndex], m_swapchainImageViews[imageIndex]);
+    m_renderGraph.execute(commandBuffer, &m_gpuProfiler);
+
+    m_gpuProfiler.endFrame(commandBuffer);
+
+    if (VkResult result = vkEndCommandBuffer(commandBuffer); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer");
+    }
+}
+
+void Application::recordScenePass(const RenderPassContext& context) {
+    if (m_config.scene.instanceCount > 0) {
+        recordSceneState(context.commandBuffer);
+        m_instanceBatcher.record(context.commandBuffer, m_scenePipelines);
+        return;
+    }
+
+    if (m_config.gpuDriven) {
+        recordSceneState(context.commandBuffer);
+        m_gpuCuller.recordDraws(context.commandBuffer, m_scenePipelines);
+        return;
+    }
+
+    uint32_t drawCount = static_cast<uint32_t>(m_sceneDraws.size());
+    uint32_t chunkCount = sceneChunkCount();
+
+    if (chunkCount <= 1) {
+        recordSceneDraws(context.commandBuffer, 0, drawCount);
+        return;
+    }
+
+    VkCommandBufferInheritanceInfo inheritanceInfo {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = context.renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = context.framebuffer;
+
+    // Contiguous draw ranges keep the executed order identical to inline recording
+    std::vector<VkCommandBuffer> secondaryCommandBuffers = m_parallelRecorder.record(inheritanceInfo, chunkCount,
+        [this, drawCount, chunkCount](VkCommandBuffer secondaryCommandBuffer, uint32_t chunkIdx) {
+            uint32_t firstDraw = static_cast<uint32_t>(uint64_t(drawCount) * chunkIdx / chunkCount);
+            uint32_t endDraw = static_cast<uint32_t>(uint64_t(drawCount) * (chunkIdx + 1) / chunkCount);
+            recordSceneDraws(secondaryCommandBuffer, firstDraw, endDraw);
+        });
+
+    vkCmdExecuteCommands(context.commandBuffer, secondaryCommandBuffers.size(), secondaryCommandBuffers.data());
+}
+
+uint32_t Application::sceneChunkCount() const {
+    // Small scenes are cheaper to record inline than to hand out to workers
+    uint32_t drawCount = std::min(m_config.scene.drawCount, m_config.scene.triangleCount);
+    return std::min(m_parallelRecorder.workerCount(), (drawCount + MinDrawsPerSecondary - 1) / MinDrawsPerSecondary);
+}
+
+void Application::recordSceneState(VkCommandBuffer commandBuffer) {
     VkViewport viewport {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -419,99 +1253,152 @@ void Application::createGraphicsPipeline() {
     viewport.height = static_cast<float>(m_swapchainImageExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor {};
     scissor.offset = { 0, 0 };
     scissor.extent = m_swapchainImageExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    m_sceneMesh.bind(commandBuffer);
+    VkDeviceSize instanceOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, &m_sceneDrawInstances.buffer, &instanceOffset);
+    // The only descriptor set bind of the pass, all pipelines share its layout
+    m_bindlessDescriptors.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout);
+
+    ScenePushConstants pushConstants;
+    pushConstants.drawDataSlot = m_sceneDrawDataSlot;
+    pushConstants.textureTableSlot = m_textureStreamer.tableSlot();
+    vkCmdPushConstants(commandBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(pushConstants), &pushConstants);
+}
+
+void Application::recordSceneDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw) {
+    // Dynamic state is not inherited by secondary command buffers, so every range sets it
+    recordSceneState(commandBuffer);
+
+    for (uint32_t drawIdx = firstDraw; drawIdx < endDraw; ++drawIdx) {
+        // Draws cycle through the pipelines, so with several every draw switches state
+        if (drawIdx == firstDraw || m_scenePipelines.size() > 1) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_scenePipelines[drawIdx % m_scenePipelines.size()].wait());
+        }
+
+        // firstInstance selects the draw's identity instance, same as the indirect commands
+        const SceneDraw& draw = m_sceneDraws[drawIdx];
+        vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, drawIdx);
+    }
+}
+
+void Application::drawFrame() {
+    ScopedCpuTimer frameTimer("drawFrame");
+
+    FrameContext& frame = m_frames[m_currentFrame];
+
+    // Only wait for the GPU to release this frame slot; the other slots keep
+    // the GPU busy while the CPU records the next frame
+    {
+        ScopedCpuTimer waitTimer("waitForFrameSlot");
+        vkWaitForFences(m_vkDevice, 1, &frame.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    releaseRetiredSwapchains(false);
+    m_bindlessDescriptors.beginFrame(m_frameCounter);
+    m_textureStreamer.update(m_currentFrame, m_frameCounter);
+    if (m_config.hotReloadShaders) {
+        reloadShaders();
+    }
+    if (m_config.gpuDriven) {
+        m_gpuCuller.beginFrame(m_currentFrame, m_frameCounter);
+    }
+    m_parallelRecorder.beginFrame(m_currentFrame);
+    if (m_config.scene.instanceCount > 0) {
+        submitSceneInstances();
+    }
+
+    // Offscreen targets map one to one onto frame slots
+    uint32_t imageIndex = m_currentFrame;
+    if (m_vkSwapchain != VK_NULL_HANDLE) {
+        ScopedCpuTimer acquireTimer("acquireImage");
+        VkResult result = vkAcquireNextImageKHR(m_vkDevice, m_vkSwapchain, std::numeric_limits<uint64_t>::max(), frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+
+        // Nothing was acquired and the fence stays signaled, so the slot can simply be retried
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            recreateSwapChain();
+            return;
+        }
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("Failed to acquire swapchain image");
+        }
+    }
+
+    vkResetFences(m_vkDevice, 1, &frame.inFlightFence);
+
+    m_stagingUploader.flush();
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    if (m_vkSwapchain != VK_NULL_HANDLE) {
+        waitSemaphores.push_back(frame.imageAvailableSemaphore);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+
+    {
+        ScopedCpuTimer recordTimer("recordCommandBuffer");
+        vkResetCommandBuffer(frame.commandBuffer, 0);
+        recordCommandBuffer(frame.commandBuffer, imageIndex, waitSemaphores, waitStages);
+    }
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.waitSemaphoreCount = waitSemaphores.size();
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+
+    if (m_vkSwapchain == VK_NULL_HANDLE) {
+        if (VkResult result = vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, frame.inFlightFence); result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit draw command buffer");
+        }
+
+        m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+        ++m_frameCounter;
+        return;
+    }
+
+    VkSemaphore renderFinishedSemaphore = m_renderFinishedSemaphores[imageIndex];
+
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &renderFinishedSemaphore;
+
+    if (VkResult result = vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, frame.inFlightFence); result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit draw command buffer");
+    }
+
+    VkPresentInfoKHR presentInfo {};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &m_vkSwapchain;
+    presentInfo.pImageIndices = &imageIndex;
+
+    VkResult presentResult = vkQueuePresentKHR(m_vkPresentQueue, &presentInfo);
+    if (presentResult != VK_SUCCESS && presentResult != VK_SUBOPTIMAL_KHR && presentResult != VK_ERROR_OUT_OF_DATE_KHR) {
+        throw std::runtime_error("Failed to present swapchain image");
+    }
+
+    // Covers the fence wait and the acquire, which is where a deeper queue shows up as latency
+    if (m_pendingInput) {
+        m_inputToPresentLatency.add(m_pendingInput->elapsedMs());
+        m_pendingInput.reset();
+    }
+
+    m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+    ++m_frameCounter;
 
-    VkPipelineViewportStateCreateInfo viewportStateCreateInfo {};
-    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportStateCreateInfo.viewportCount = 1;
-    viewportStateCreateInfo.scissorCount = 1;
-
-    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo {};
-    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
-    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationStateCreateInfo.polygonMode = VkPolygonMode::VK_POLYGON_MODE_FILL;
-    rasterizationStateCreateInfo.lineWidth = 1.0f;
-    rasterizationStateCreateInfo.cullMode = VkCullModeFlagBits::VK_CULL_MODE_BACK_BIT;
-    rasterizationStateCreateInfo.frontFace = VkFrontFace::VK_FRONT_FACE_CLOCKWISE;
-    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
-    rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
-    rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
-    rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisableStateCreateInfo {};
-    multisableStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisableStateCreateInfo.sampleShadingEnable = VK_FALSE;
-    multisableStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisableStateCreateInfo.minSampleShading = 1.0f;
-    multisableStateCreateInfo.pSampleMask = nullptr;
-    multisableStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
-    multisableStateCreateInfo.alphaToOneEnable = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo {};
-    colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
-    colorBlendStateCreateInfo.attachmentCount = 1;
-    colorBlendStateCreateInfo.pAttachments = &colorBlendAttachment;
-
-    VkPipelineLayoutCreateInfo pipelieLayoutCreateInfo {};
-    pipelieLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-    if (VkResult result = vkCreatePipelineLayout(m_vkDevice, &pipelieLayoutCreateInfo, nullptr, &m_vkPipelineLayout); result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create VkPipelineLayout");
-    }
-
-    VkGraphicsPipelineCreateInfo pipelineCreateInfo {};
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.stageCount = shaderStageCreateInfos.size();
-    pipelineCreateInfo.pStages = shaderStageCreateInfos.data();
-    pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
-    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-    pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-    pipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
-    pipelineCreateInfo.pMultisampleState = &multisableStateCreateInfo;
-    pipelineCreateInfo.pDepthStencilState = nullptr;
-    pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-    pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
-
-    pipelineCreateInfo.layout = m_vkPipelineLayout;
-
-    pipelineCreateInfo.renderPass = m_vkRenderPass;
-    pipelineCreateInfo.subpass = 0;
-
-    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pipelineCreateInfo.basePipelineIndex = -1;
-
-    if (VkResult result = vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkPipeline); result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create graphics pipeline");
-    }
-}
-
-VkShaderModule Application::createShaderModule(const std::vector<char>& shaderCode) {
-    VkShaderModuleCreateInfo shaderModuleCreateInfo {};
-    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderModuleCreateInfo.codeSize = shaderCode.size();
-    shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
-
-    VkShaderModule shaderModule = VK_NULL_HANDLE;
-    if (VkResult result = vkCreateShaderModule(m_vkDevice, &shaderModuleCreateInfo, nullptr, &shaderModule); result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create VkShaderModule");
-    }
-
-    return shaderModule;
+    if (presentResult != VK_SUCCESS || m_framebufferResized) {
+        recreateSwapChain();
+    }
 }
 
 VkSurfaceFormatKHR Application::chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
@@ -523,13 +1410,19 @@ VkSurfaceFormatKHR Application::chooseSurfaceFormat(const std::vector<VkSurfaceF
     return availableFormats[0];
 }
 
-VkPresentModeKHR Application::choosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (auto presentMode : availablePresentModes) {
-        if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return presentMode;
+VkFormat Application::chooseDepthFormat() const {
+    // Depth only formats, so the Hi-Z pass can sample the depth buffer through a single aspect view
+    for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32 }) {
+        VkFormatProperties formatProperties {};
+        vkGetPhysicalDeviceFormatProperties(m_pickedVkPhysicalDevice, format, &formatProperties);
+
+        if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
         }
     }
-    return VK_PRESENT_MODE_FIFO_KHR;
+
+    // Required to be supported as a depth attachment
+    return VK_FORMAT_D16_UNORM;
 }
 
 VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
@@ -557,24 +1450,70 @@ void Application::cleanup() {
         return;
     }
 
-    vkDestroyPipeline(m_vkDevice, m_vkPipeline, nullptr);
-    vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
-    vkDestroyRenderPass(m_vkDevice, m_vkRenderPass, nullptr);
+    // Frames in flight still reference everything below
+    vkDeviceWaitIdle(m_vkDevice);
+
+    releaseRetiredSwapchains(true);
+
+    for (auto& semaphore : m_renderFinishedSemaphores) {
+        vkDestroySemaphore(m_vkDevice, semaphore, nullptr);
+    }
+    m_renderFinishedSemaphores.clear();
+
+    for (auto& frame : m_frames) {
+        vkDestroySemaphore(m_vkDevice, frame.imageAvailableSemaphore, nullptr);
+        vkDestroyFence(m_vkDevice, frame.inFlightFence, nullptr);
+    }
+    m_frames.clear();
+
+    vkDestroyCommandPool(m_vkDevice, m_vkCommandPool, nullptr);
+    m_parallelRecorder.destroy();
+    m_gpuProfiler.destroy();
+
+    m_gpuCuller.destroy();
+    m_sceneMesh.destroy(m_memoryAllocator);
+    m_instanceBatcher.destroy();
+    m_memoryAllocator.destroyBuffer(m_sceneDrawInstances);
+    m_memoryAllocator.destroyBuffer(m_sceneDrawData);
+    vkDestroySampler(m_vkDevice, m_defaultSampler, nullptr);
+    m_textureStreamer.destroy();
+    m_stagingUploader.destroy();
+
+    m_shaderHotReloader.destroy();
+    m_pipelineRegistry.destroy();
+    m_assetStore.destroy();
+
+    m_pipelineCache.save();
+    m_pipelineCache.destroy();
+
+    m_pipelineLayouts.destroy();
+    m_bindlessDescriptors.destroy();
+    m_renderGraph.destroy();
 
     for (auto& imageView : m_swapchainImageViews) {
         vkDestroyImageView(m_vkDevice, imageView, nullptr);
     }
     m_swapchainImageViews.clear();
 
+    // Swapchain images are owned by the swapchain, only offscreen ones are ours
+    for (auto& offscreenImage : m_offscreenImages) {
+        m_memoryAllocator.destroyImage(offscreenImage);
+    }
+    m_offscreenImages.clear();
+    m_swapchainImages.clear();
+
     vkDestroySwapchainKHR(m_vkDevice, m_vkSwapchain, nullptr);
+    m_memoryAllocator.destroy();
     vkDestroyDevice(m_vkDevice, nullptr);
     vkDestroySurfaceKHR(m_vkInstance, m_vkSurface, nullptr);    
     destroyVulkanDebugMessenger();
     vkDestroyInstance(m_vkInstance, nullptr);
 
-    glfwDestroyWindow(m_window);
+    if (m_window) {
+        glfwDestroyWindow(m_window);
 
-    glfwTerminate();
+        glfwTerminate();
+    }
 }
 
 void Application::destroyVulkanDebugMessenger() {
@@ -587,8 +1526,94 @@ void Application::destroyVulkanDebugMessenger() {
 }
 
 void Application::loop() {
-    while (!glfwWindowShouldClose(m_window)) {
-        glfwPollEvents();
+    while (m_config.frameLimit == 0 || m_frameCounter < m_config.frameLimit) {
+        if (m_window) {
+            if (glfwWindowShouldClose(m_window)) {
+                break;
+            }
+
+            glfwPollEvents();
+
+            // Nothing can be presented while the window is minimized
+            int windowWidth = 0;
+            int windowHeight = 0;
+            glfwGetFramebufferSize(m_window, &windowWidth, &windowHeight);
+            if (windowWidth == 0 || windowHeight == 0) {
+                glfwWaitEvents();
+                continue;
+            }
+        }
+
+        utils::Stopwatch frameStopwatch;
+        uint64_t frameNumber = m_frameCounter;
+
+        if (m_config.frameBudget && frameNumber >= m_config.warmupFrames && !m_config.frameBudget->claim()) {
+            break;
+        }
+
+        // Utilisation covers the measured frames only, not startup compilation and warmup
+        if (frameNumber == m_config.warmupFrames) {
+            m_taskScheduler.resetStats();
+        }
+
+        drawFrame();
+
+        if (frameNumber == 0 && m_frameCounter != frameNumber) {
+            m_runStats.firstFrameMs = m_startupStopwatch.elapsedMs();
+            std::cout << "[startup] First frame submitted " << m_runStats.firstFrameMs << " ms after start" << std::endl;
+        }
+
+        // Skipped frames (out of date swapchain) do not count
+        if (m_frameCounter != frameNumber && frameNumber >= m_config.warmupFrames) {
+            m_runStats.cpuFrameMs.push_back(frameStopwatch.elapsedMs());
+        }
+    }
+
+    m_runStats.peakDeviceMemoryBytes = m_memoryAllocator.stats().peakReservedBytes;
+
+    if (m_config.profilerReport) {
+        Profiler::Get().report(std::cout);
+    }
+    if (!m_config.tracePath.empty()) {
+        Profiler::Get().writeChromeTrace(m_config.tracePath);
+        std::cout << "[profile] Chrome trace written to " << m_config.tracePath << std::endl;
+    }
+
+    if (m_inputToPresentLatency.count() > 0) {
+        std::cout << "[present] Input to present latency over " << m_inputToPresentLatency.count() << " inputs: min "
+                  << m_inputToPresentLatency.minMs() << " ms, avg " << m_inputToPresentLatency.averageMs() << " ms, max "
+                  << m_inputToPresentLatency.maxMs() << " ms" << std::endl;
+    }
+
+    TextureStreamingStats streamingStats = m_textureStreamer.stats();
+    if (streamingStats.requested > 0) {
+        std::cout << "[streaming] " << streamingStats.complete << " of " << streamingStats.requested << " textures complete, "
+                  << streamingStats.streaming << " streaming, " << streamingStats.failed << " failed, "
+                  << streamingStats.uploadedBytes / (1024.0 * 1024.0) << " MiB uploaded; first level after "
+                  << streamingStats.firstLevelMs.averageMs() << " ms, full chain after " << streamingStats.completeMs.averageMs() << " ms" << std::endl;
+    }
+
+    if (m_config.scene.instanceCount > 0) {
+        std::cout << "[instancing] " << m_instanceBatcher.instanceCount() << " instances in "
+                  << m_instanceBatcher.batchCount() << " instanced draws" << std::endl;
+    }
+
+    if (m_config.gpuDriven && m_gpuCuller.visibleCount()) {
+        std::cout << "[cull] GPU-driven, " << *m_gpuCuller.visibleCount() << " of " << m_gpuCuller.objectCount()
+                  << " objects visible in the last frame, drawn with "
+                  << (m_gpuCuller.drawIndirectCount() ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect") << std::endl;
+    }
+
+    std::vector<WorkerStats> workerStats = m_taskScheduler.workerStats();
+    for (size_t i = 0; i < workerStats.size(); ++i) {
+        std::cout << "[tasks] Worker " << i << ": " << workerStats[i].executed << " tasks (" << workerStats[i].stolen << " stolen), "
+                  << workerStats[i].busyMs << " ms busy, " << workerStats[i].utilisation * 100.0 << "% utilised" << std::endl;
+    }
+}
+
+void Application::onInput() {
+    if (!m_pendingInput) {
+        m_pendingInput.emplace();
     }
 }
 
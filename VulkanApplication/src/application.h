@@ -1,30 +1,199 @@
 #ifndef __VulkanApp_Application_H__
 #define __VulkanApp_Application_H__
 
+#include <atomic>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <GLFW/glfw3.h>
 
 #include <vulkan/vulkan.h>
 
+#include "VkDevices.h"
 #include "VkExtensions.h"
 #include "VkLayers.h"
+#include "AssetStore.h"
+#include "MappedFile.h"
+#include "PipelineCache.h"
+#include "PipelineLayoutCache.h"
+#include "PipelineRegistry.h"
+#include "ShaderHotReloader.h"
+#include "StartupGraph.h"
+#include "TaskScheduler.h"
+#include "VkMemoryAllocator.h"
+#include "StagingUploader.h"
+#include "BindlessDescriptors.h"
+#include "Mesh.h"
+#include "PresentPolicy.h"
+#include "GpuProfiler.h"
+#include "GpuCuller.h"
+#include "InstanceBatcher.h"
+#include "TextureStreamer.h"
+#include "ParallelCommandRecorder.h"
+#include "RenderGraph.h"
+#include "Utils.h"
 
 #define ENABLE_VALIDATION_LAYERS
 
 namespace nex {
 
+// Geometry the renderer draws, scaled up by the benchmark harness
+struct SceneConfig {
+    // Triangles laid out on a grid covering the viewport
+    uint32_t triangleCount = 1;
+    // Draw calls the triangles are split into
+    uint32_t drawCount = 1;
+    // Distinct pipelines the draws cycle through
+    uint32_t pipelineCount = 1;
+    // Copies of a single triangle laid out on a grid and merged into instanced
+    // draws, replaces the triangle grid when not 0
+    uint32_t instanceCount = 0;
+    // Shader permutation of the scene pipelines, see triangle.vert and triangle.frag
+    bool vertexColor = true;
+    // Texture samples averaged per pixel along each axis
+    uint32_t textureTaps = 1;
+};
+
+// Measured frames shared out between applications rendering on different
+// devices, each takes the next frame when it is ready for one
+class FrameBudget {
+public:
+    explicit FrameBudget(uint64_t frames)
+        : m_remaining(frames)
+    {}
+
+    FrameBudget(const FrameBudget&) = delete;
+    FrameBudget& operator=(const FrameBudget&) = delete;
+
+    // False once every frame has been handed out
+    bool claim() {
+        uint64_t remaining = m_remaining.load(std::memory_order_relaxed);
+        while (remaining > 0) {
+            if (m_remaining.compare_exchange_weak(remaining, remaining - 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::atomic<uint64_t> m_remaining;
+};
+
+// Measurements of a run, frames before ApplicationConfig::warmupFrames are not included
+struct RunStats {
+    std::string deviceName;
+    double startupMs = 0.0;
+    // From the start of initialization until the first frame was submitted
+    double firstFrameMs = 0.0;
+    std::vector<StartupPhaseTiming> startupPhases;
+    std::vector<double> cpuFrameMs;
+    std::vector<double> gpuFrameMs;
+    VkDeviceSize peakDeviceMemoryBytes = 0;
+};
+
+struct ApplicationConfig {
+    // Present mode, swapchain image count and default frames in flight
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+
+    // How many frames the CPU may record ahead of the GPU, 0 takes the present policy's choice
+    uint32_t framesInFlight = 0;
+
+    // Render into offscreen images without a window, surface or swapchain
+    bool headless = false;
+
+    // Stop after this many frames, 0 means run until the window is closed
+    uint64_t frameLimit = 0;
+
+    // Rank of the physical device to render on among the suitable ones, 0 is the best
+    uint32_t deviceIndex = 0;
+
+    // Once warmed up, every frame is claimed from this budget and the run stops when
+    // it is used up. Shared by the applications of a multi-device run, see RunOnDevices.
+    FrameBudget* frameBudget = nullptr;
+
+    // Frames excluded from RunStats while caches and clocks settle
+    uint64_t warmupFrames = 0;
+
+    SceneConfig scene;
+
+    // Workers recording secondary command buffers, 0 uses every thread of the pool
+    uint32_t recordThreads = 0;
+
+    // Cull and emit the scene draws on the GPU instead of recording one draw per object
+    bool gpuDriven = false;
+
+    // PPM image streamed in and applied to every draw, empty leaves the scene untextured
+    std::string texturePath;
+
+    // Side of a generated checkerboard streamed in when no texture path is given, 0 for none
+    uint32_t generatedTextureSize = 0;
+
+    // Packed asset archive, empty looks for assets.pak next to the executable. Assets
+    // missing from it are loaded as loose files from the executable's directory.
+    std::string assetArchivePath;
+
+    // Recompile shaders when their GLSL sources change and swap the affected pipelines in
+    bool hotReloadShaders = false;
+
+    // GLSL sources watched for hot reload, empty uses the source tree the build compiled
+    std::string shaderSourceDirectory;
+
+    // Where the pipeline cache is persisted between launches, empty disables it
+    std::string pipelineCachePath = "pipeline_cache.bin";
+
+    // Additionally build the pipelines against an empty cache to report cold vs warm cost
+    bool comparePipelineCache = false;
+
+    // Chrome trace JSON of CPU scopes and GPU passes written on exit, empty disables capture
+    std::string tracePath;
+
+    // Print the profiler's series on exit. The profiler is process wide, a multi-device
+    // run turns this off and reports once after every device has finished.
+    bool profilerReport = true;
+};
+
+// Resources owned by a single frame in flight
+struct FrameContext {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkFence inFlightFence = VK_NULL_HANDLE;
+};
+
+// Swapchain resources replaced by a recreation. Frames still in flight may
+// reference them, so they are destroyed only once every frame slot has cycled.
+struct RetiredSwapchain {
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    std::vector<VkImageView> imageViews;
+    RenderGraphResources renderGraphResources;
+    std::vector<VkSemaphore> renderFinishedSemaphores;
+    uint64_t retiredAtFrame = 0;
+};
+
 class Application {
 public:
-    Application(std::string_view title, int width, int height);
+    Application(std::string_view title, int width, int height, const ApplicationConfig& config = {});
     ~Application();
 
     void run();
 
+    const RunStats& runStats() const {
+        return m_runStats;
+    }
+
 private:
     void init();
+    // Declares initialization as phases, independent ones overlap
+    void buildStartupGraph(StartupGraph& startup);
+    void initWindowSystem();
     void initWindow();
-    void initVulkan();
+    // Asset store and shader reflection, which need no device. Takes the GPU-driven
+    // setting as requested, m_config.gpuDriven is settled by device creation.
+    void loadShaders(bool gpuDriven);
+    // Allocator, bindless set, uploads and texture streaming
+    void initDeviceResources();
 
     void createVulkanInstance();
     void createVulkanDebugMessenger();
@@ -32,20 +201,48 @@ private:
     void pickVulkanPhysicalDevice();
     void createVulkanLogicalDevice();
     void createSwapChain();
+    void recreateSwapChain();
+    void releaseRetiredSwapchains(bool force);
+    void createOffscreenTargets();
     void createImageViews();
-    void createRenderPass();
+    void createRenderGraph();
     void createGraphicsPipeline();
+    GraphicsPipelineDesc scenePipelineDesc(uint32_t variant) const;
+    void waitForPipelines();
+    void reportPipelineCacheComparison(double warmPipelineMs);
+    void createCommandPool();
+    void createCommandBuffers();
+    void createSyncObjects();
+    void createRenderFinishedSemaphores();
+    void createMeshes();
+    void createDefaultSampler();
+    void createSceneTexture();
+    void createGpuCuller();
+    // Re-submits every instance of the instanced scene, as a dynamic scene would
+    void submitSceneInstances();
+    // Swaps in pipelines rebuilt from hot-reloaded shaders, at the start of a frame
+    void reloadShaders();
 
-    VkShaderModule createShaderModule(const std::vector<char>& shaderCode);
+    // Appends the semaphores the submission has to wait on for uploads consumed by this frame
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                             std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages);
+    void recordScenePass(const RenderPassContext& context);
+    // Viewport, geometry, bindless set and push constants shared by all scene draws
+    void recordSceneState(VkCommandBuffer commandBuffer);
+    void recordSceneDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw);
+    // Secondary command buffers the scene pass is split into, 1 records it inline
+    uint32_t sceneChunkCount() const;
+    void drawFrame();
 
     VkSurfaceFormatKHR chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    VkFormat chooseDepthFormat() const;
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
     void cleanup();
     void destroyVulkanDebugMessenger();
 
     void loop();
+    void onInput();
 
 private:
     bool m_init = false;
@@ -54,6 +251,8 @@ private:
     int m_width = 0;
     int m_height = 0;
 
+    ApplicationConfig m_config;
+
     std::vector<const char*> m_requiredInstanceExtensions {
         #ifdef ENABLE_VALIDATION_LAYERS
         VK_EXT_DEBUG_UTILS_EXTENSION_NAME
@@ -66,9 +265,7 @@ private:
         #endif
     };
 
-    std::vector<const char*> m_requiredDeviceExtensions {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> m_requiredDeviceExtensions;
 
     // GLFW
     GLFWwindow* m_window = nullptr;
@@ -77,21 +274,107 @@ private:
     VkInstance m_vkInstance = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT m_vkDebugMessenger = VK_NULL_HANDLE;
     VkPhysicalDevice m_pickedVkPhysicalDevice = VK_NULL_HANDLE;
+    DeviceQueueFamilyIndices m_queueFamilyIndices;
+    // Queried while picking the device, used by the first swapchain creation
+    std::optional<DeviceSwapChainInfo> m_pickedSwapChainInfo;
     VkDevice m_vkDevice = VK_NULL_HANDLE;
     VkSurfaceKHR m_vkSurface = VK_NULL_HANDLE;
+    VkMemoryAllocator m_memoryAllocator;
+    StagingUploader m_stagingUploader;
+    BindlessDescriptors m_bindlessDescriptors;
 
     VkSwapchainKHR m_vkSwapchain = VK_NULL_HANDLE;
     VkSurfaceFormatKHR m_swapchainImageFormat {};
+    VkPresentModeKHR m_swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
     VkExtent2D m_swapchainImageExtent {};
     std::vector<VkImage> m_swapchainImages;
     std::vector<VkImageView> m_swapchainImageViews;
+    std::vector<RetiredSwapchain> m_retiredSwapchains;
+    // Set from the GLFW callback, the swapchain is recreated after the next present
+    bool m_framebufferResized = false;
+
+    // Images that stand in for the swapchain in headless mode
+    std::vector<AllocatedImage> m_offscreenImages;
     
     VkQueue m_vkGraphicsQueue = VK_NULL_HANDLE;
     VkQueue m_vkPresentQueue = VK_NULL_HANDLE;
-    VkPipeline m_vkPipeline = VK_NULL_HANDLE;
+    // Falls back to the graphics queue when the device has no separate transfer family
+    VkQueue m_vkTransferQueue = VK_NULL_HANDLE;
 
-    VkRenderPass m_vkRenderPass = VK_NULL_HANDLE;
+    RenderGraph m_renderGraph;
+    // The swapchain or offscreen image of the current frame
+    RenderGraphImage m_backbuffer;
+    // Cleared and discarded every frame, lazily allocated on tiled GPUs
+    RenderGraphImage m_depthBuffer;
+    RenderGraphPass m_scenePass;
+    // Only declared for the GPU-driven path
+    RenderGraphPass m_cullPass;
+    RenderGraphPass m_hizPass;
+    // Owned by m_pipelineLayouts
     VkPipelineLayout m_vkPipelineLayout = VK_NULL_HANDLE;
+    PipelineLayoutCache m_pipelineLayouts;
+    PipelineCache m_pipelineCache;
+    // Shader binaries and other assets opened more than once stay mapped here
+    MappedFileCache m_fileCache;
+    AssetStore m_assetStore;
+    TaskScheduler m_taskScheduler;
+    PipelineRegistry m_pipelineRegistry;
+    ShaderHotReloader m_shaderHotReloader;
+    std::vector<PipelineHandle> m_scenePipelines;
+    Mesh m_sceneMesh;
+
+    struct SceneDraw {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+    std::vector<SceneDraw> m_sceneDraws;
+
+    // std430 element of the per-draw storage buffer, matches DrawData in the shaders
+    struct SceneDrawData {
+        glm::vec4 tint { 1.0f };
+        // Entry of the texture table, which holds the bindless slot of its resident levels
+        TextureHandle texture = InvalidTexture;
+        uint32_t samplerSlot = BindlessDescriptors::InvalidSlot;
+        uint32_t padding[2] {};
+    };
+
+    // Matches the push constant block of the shaders, the draw index is passed as firstInstance
+    struct ScenePushConstants {
+        uint32_t drawDataSlot = 0;
+        uint32_t textureTableSlot = 0;
+    };
+
+    // Per-instance stream of the non-instanced paths, one instance per draw indexed by firstInstance
+    AllocatedBuffer m_sceneDrawInstances;
+    InstanceBatcher m_instanceBatcher;
+
+    AllocatedBuffer m_sceneDrawData;
+    uint32_t m_sceneDrawDataSlot = BindlessDescriptors::InvalidSlot;
+    TextureStreamer m_textureStreamer;
+    TextureHandle m_sceneTexture = InvalidTexture;
+    VkSampler m_defaultSampler = VK_NULL_HANDLE;
+    uint32_t m_defaultSamplerSlot = BindlessDescriptors::InvalidSlot;
+
+    GpuCuller m_gpuCuller;
+    // Required for the GPU-driven path, which falls back to vkCmdDrawIndexedIndirect without it
+    bool m_drawIndirectCountSupported = false;
+
+    VkCommandPool m_vkCommandPool = VK_NULL_HANDLE;
+    GpuProfiler m_gpuProfiler;
+    ParallelCommandRecorder m_parallelRecorder;
+    std::vector<FrameContext> m_frames;
+    // Signaled per swapchain image, because presentation may still hold the
+    // semaphore when the frame slot that signaled it comes around again
+    std::vector<VkSemaphore> m_renderFinishedSemaphores;
+    uint32_t m_currentFrame = 0;
+    uint64_t m_frameCounter = 0;
+
+    // Started by the first input event not yet shown, stopped when the frame that sampled it is presented
+    std::optional<utils::Stopwatch> m_pendingInput;
+    utils::SampleStats m_inputToPresentLatency;
+
+    RunStats m_runStats;
+    utils::Stopwatch m_startupStopwatch;
 
     VkExtensions m_instanceExtensions = VkExtensions::InstanceExtensions();
     VkLayers m_instanceLayers = VkLayers::InstanceLayers();
@@ -1,6 +1,86 @@
 #include "application.h"
+#include "MultiDevice.h"
 
-int main() {
-    nex::Application app("VulkanApp", 800, 600);
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+int main(int argc, char** argv) {
+    nex::ApplicationConfig config;
+    uint32_t deviceCount = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        // std::stoul and friends throw on values that are not numbers or out of range
+        try {
+            if (arg == "--headless") {
+                config.headless = true;
+            } else if (arg == "--instances" && i + 1 < argc) {
+                config.scene.instanceCount = std::stoul(argv[++i]);
+            } else if (arg == "--no-vertex-color") {
+                config.scene.vertexColor = false;
+            } else if (arg == "--texture-taps" && i + 1 < argc) {
+                config.scene.textureTaps = std::stoul(argv[++i]);
+            } else if (arg == "--texture" && i + 1 < argc) {
+                config.texturePath = argv[++i];
+            } else if (arg == "--generated-texture" && i + 1 < argc) {
+                config.generatedTextureSize = std::stoul(argv[++i]);
+            } else if (arg == "--gpu-driven") {
+                config.gpuDriven = true;
+            } else if (arg == "--device" && i + 1 < argc) {
+                config.deviceIndex = std::stoul(argv[++i]);
+            } else if (arg == "--devices" && i + 1 < argc) {
+                deviceCount = std::stoul(argv[++i]);
+            } else if (arg == "--frames" && i + 1 < argc) {
+                config.frameLimit = std::stoull(argv[++i]);
+            } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+                config.framesInFlight = std::stoul(argv[++i]);
+            } else if (arg == "--hot-reload") {
+                config.hotReloadShaders = true;
+            } else if (arg == "--shader-source" && i + 1 < argc) {
+                config.shaderSourceDirectory = argv[++i];
+            } else if (arg == "--assets" && i + 1 < argc) {
+                config.assetArchivePath = argv[++i];
+            } else if (arg == "--pipeline-cache" && i + 1 < argc) {
+                config.pipelineCachePath = argv[++i];
+            } else if (arg == "--present-policy" && i + 1 < argc) {
+                std::optional<nex::PresentPolicy> policy = nex::ParsePresentPolicy(argv[++i]);
+                if (!policy) {
+                    std::cerr << "Unknown present policy \"" << argv[i] << "\", expected low-latency, power-save or benchmark" << std::endl;
+                    return 1;
+                }
+                config.presentPolicy = *policy;
+            } else if (arg == "--trace" && i + 1 < argc) {
+                config.tracePath = argv[++i];
+            } else if (arg == "--compare-pipeline-cache") {
+                config.comparePipelineCache = true;
+            } else {
+                std::cerr << "Unknown argument \"" << arg << "\"" << std::endl;
+                return 1;
+            }
+        } catch (const std::logic_error&) {
+            std::cerr << "Invalid value \"" << argv[i] << "\" for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (deviceCount == 0) {
+        std::cerr << "--devices needs at least 1 device" << std::endl;
+        return 1;
+    }
+    if (deviceCount > 1 && (!config.headless || config.frameLimit <= config.warmupFrames)) {
+        std::cerr << "--devices renders offscreen jobs, it needs --headless and a --frames count" << std::endl;
+        return 1;
+    }
+
+    if (deviceCount > 1) {
+        nex::RunOnDevices("VulkanApp", 800, 600, config, deviceCount);
+        return 0;
+    }
+
+    nex::Application app("VulkanApp", 800, 600, config);
     app.run();
-}
\ No newline at end of file
+}
@@ -0,0 +1,324 @@
+#include "AssetArchive.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Round trips data through the LZ4 block codec and archives through
+// AssetArchiveWriter and AssetArchive, then feeds the reader truncated and
+// corrupted copies of a valid archive, all of which must throw. Exits with 1
+// if any check failed.
+
+namespace {
+
+using Header = nex::AssetArchive::Header;
+using Entry = nex::AssetArchive::Entry;
+using Compression = nex::AssetArchive::Compression;
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+bool Throws(const std::function<void()>& func) {
+    try {
+        func();
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+std::vector<char> RandomBytes(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<char> bytes(size);
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+// Period 3 repeats match their own output, runs of one byte do at offset 1
+std::vector<char> Repetitive(size_t size, size_t period) {
+    std::vector<char> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<char>('a' + i % period);
+    }
+    return bytes;
+}
+
+bool RoundTrips(const std::vector<char>& input, std::vector<char>* compressedOut = nullptr) {
+    std::vector<char> compressed = nex::Lz4CompressBlock(input.data(), input.size());
+    // One spare byte, so even an empty output has a valid pointer
+    std::vector<char> output(input.size() + 1);
+    nex::Lz4DecompressBlock(compressed.data(), compressed.size(), output.data(), input.size());
+    if (compressedOut) {
+        *compressedOut = compressed;
+    }
+    return input.size() <= nex::Lz4MaxDecompressedSize(compressed.size())
+        && std::equal(input.begin(), input.end(), output.begin());
+}
+
+void TestLz4RoundTrips() {
+    Check(RoundTrips({}), "empty input round trips");
+
+    // Too short for the compressor to look for matches at all
+    for (size_t size = 1; size < 13; ++size) {
+        Check(RoundTrips(Repetitive(size, 1)), "input of " + std::to_string(size) + " bytes round trips");
+    }
+
+    std::vector<char> compressed;
+    Check(RoundTrips(RandomBytes(65536, 1), &compressed), "incompressible input round trips");
+    Check(compressed.size() > 65536, "incompressible input is stored as literals");
+
+    Check(RoundTrips(Repetitive(100000, 1), &compressed), "run of one byte round trips");
+    Check(compressed.size() < 1000, "run of one byte compresses");
+    Check(std::find(compressed.begin(), compressed.end(), static_cast<char>(255)) != compressed.end(),
+          "long match is encoded with 255 length bytes");
+
+    Check(RoundTrips(Repetitive(100000, 3), &compressed), "overlapping period 3 matches round trip");
+    Check(compressed.size() < 1000, "period 3 repeat compresses");
+
+    // Literals and matches alternating, with literal runs of 255 bytes and more
+    std::vector<char> mixed;
+    for (uint32_t i = 0; i < 16; ++i) {
+        std::vector<char> literals = RandomBytes(200 + i * 20, i + 2);
+        mixed.insert(mixed.end(), literals.begin(), literals.end());
+        std::vector<char> run = Repetitive(300 + i, 2);
+        mixed.insert(mixed.end(), run.begin(), run.end());
+    }
+    Check(RoundTrips(mixed), "mixed literals and matches round trip");
+}
+
+void TestLz4RejectsCorruptBlocks() {
+    std::vector<char> input = Repetitive(4096, 3);
+    std::vector<char> compressed = nex::Lz4CompressBlock(input.data(), input.size());
+    std::vector<char> output(input.size() + 16);
+
+    Check(Throws([&] { nex::Lz4DecompressBlock(compressed.data(), 0, output.data(), input.size()); }), "empty block throws");
+    Check(Throws([&] { nex::Lz4DecompressBlock(compressed.data(), compressed.size() - 1, output.data(), input.size()); }),
+          "truncated block throws");
+    Check(Throws([&] { nex::Lz4DecompressBlock(compressed.data(), compressed.size(), output.data(), input.size() - 1); }),
+          "block larger than the output throws");
+    Check(Throws([&] { nex::Lz4DecompressBlock(compressed.data(), compressed.size(), output.data(), input.size() + 1); }),
+          "block smaller than the output throws");
+
+    // One literal, then a match reaching back before the start of the output
+    const char badOffset[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+    Check(Throws([&] { nex::Lz4DecompressBlock(badOffset, sizeof(badOffset), output.data(), 8); }), "match offset past the output start throws");
+    const char zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+    Check(Throws([&] { nex::Lz4DecompressBlock(zeroOffset, sizeof(zeroOffset), output.data(), 8); }), "zero match offset throws");
+    // Literal length continued past the end of the block
+    const char openLength[] = { static_cast<char>(0xF0), static_cast<char>(255) };
+    Check(Throws([&] { nex::Lz4DecompressBlock(openLength, sizeof(openLength), output.data(), 300); }), "unterminated length throws");
+}
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("AssetArchiveTest_" + name)).string();
+}
+
+std::vector<char> ReadFile(const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& filepath, const std::vector<char>& bytes) {
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T>
+T Load(const std::vector<char>& bytes, uint64_t offset) {
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void Store(std::vector<char>& bytes, uint64_t offset, const T& value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+struct ArchiveInput {
+    std::string name;
+    std::vector<char> data;
+    bool compress = false;
+};
+
+std::vector<ArchiveInput> ArchiveInputs() {
+    return {
+        { "assets/empty.bin", {}, true },
+        { "assets/small.bin", Repetitive(7, 1), true },
+        { "assets/noise.bin", RandomBytes(10000, 7), true },
+        { "assets/repeat.bin", Repetitive(50000, 3), true },
+        { "assets/stored.bin", Repetitive(5000, 5), false },
+        { "assets/shaders/triangle.vert.spv", RandomBytes(1236, 8), false },
+    };
+}
+
+void TestArchiveRoundTrip(const std::string& filepath) {
+    nex::AssetArchiveWriter writer;
+    for (const auto& input : ArchiveInputs()) {
+        writer.add(input.name, input.data.data(), input.data.size(), input.compress);
+    }
+    Check(Throws([&] { writer.add("assets/small.bin", "x", 1, false); }), "duplicate name throws");
+    Check(writer.stats().entryCount == 6, "writer counts every entry");
+    Check(writer.stats().compressedCount == 1, "only the repetitive entry is worth compressing");
+    writer.write(filepath);
+
+    nex::AssetArchive archive;
+    archive.open(filepath);
+    Check(archive.entryCount() == 6, "archive has every entry");
+
+    for (const auto& input : ArchiveInputs()) {
+        Check(archive.contains(input.name), input.name + " is in the archive");
+        nex::Asset asset = archive.read(input.name);
+        Check(asset.size() == input.data.size(), input.name + " has its size");
+        Check(std::equal(input.data.begin(), input.data.end(), asset.data()), input.name + " has its contents");
+        Check(reinterpret_cast<uintptr_t>(asset.data()) % 8 == 0 || asset.size() == 0, input.name + " is 8 byte aligned");
+    }
+
+    Check(!archive.contains("assets/missing.bin"), "missing name is not found");
+    Check(Throws([&] { archive.read("assets/missing.bin"); }), "reading a missing name throws");
+
+    nex::AssetArchiveWriter emptyWriter;
+    emptyWriter.write(filepath + ".empty");
+    nex::AssetArchive emptyArchive;
+    emptyArchive.open(filepath + ".empty");
+    Check(emptyArchive.entryCount() == 0 && !emptyArchive.contains("assets/small.bin"), "empty archive opens");
+    std::filesystem::remove(filepath + ".empty");
+}
+
+// Index of the entry with the given compression, the entries are in hash order
+size_t FindEntry(const std::vector<char>& bytes, Compression compression, bool nonEmpty) {
+    Header header = Load<Header>(bytes, 0);
+    for (size_t i = 0; i < header.entryCount; ++i) {
+        Entry entry = Load<Entry>(bytes, header.entriesOffset + i * sizeof(Entry));
+        if (entry.compression == compression && (!nonEmpty || entry.size > 0)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void TestArchiveRejectsCorruption(const std::string& filepath) {
+    const std::vector<char> valid = ReadFile(filepath);
+    const Header header = Load<Header>(valid, 0);
+    const std::string corruptPath = TempPath("corrupt.nxpk");
+
+    auto opens = [&](const std::vector<char>& bytes) {
+        WriteFile(corruptPath, bytes);
+        nex::AssetArchive archive;
+        return !Throws([&] { archive.open(corruptPath); });
+    };
+    auto withHeader = [&](const std::function<void(Header&)>& edit) {
+        std::vector<char> bytes = valid;
+        Header edited = header;
+        edit(edited);
+        Store(bytes, 0, edited);
+        return bytes;
+    };
+    auto withEntry = [&](size_t index, const std::function<void(Entry&)>& edit) {
+        std::vector<char> bytes = valid;
+        uint64_t offset = header.entriesOffset + index * sizeof(Entry);
+        Entry edited = Load<Entry>(bytes, offset);
+        edit(edited);
+        Store(bytes, offset, edited);
+        return bytes;
+    };
+    auto withBucket = [&](size_t index, uint32_t value) {
+        std::vector<char> bytes = valid;
+        Store(bytes, header.bucketsOffset + index * sizeof(uint32_t), value);
+        return bytes;
+    };
+    auto truncated = [&](size_t size) {
+        return std::vector<char>(valid.begin(), valid.begin() + size);
+    };
+
+    Check(opens(valid), "unchanged archive opens");
+
+    Check(!opens({}), "empty file throws");
+    Check(!opens(truncated(sizeof(Header) - 1)), "truncated header throws");
+    Check(!opens(truncated(header.bucketsOffset + 4)), "truncated bucket table throws");
+    Check(!opens(truncated(header.entriesOffset + sizeof(Entry) / 2)), "truncated entries throw");
+    Check(!opens(truncated(header.namesOffset + 4)), "archive truncated before the data throws");
+
+    Check(!opens(withHeader([](Header& h) { h.magic = 0; })), "wrong magic throws");
+    Check(!opens(withHeader([](Header& h) { h.version += 1; })), "unknown version throws");
+    Check(!opens(withHeader([](Header& h) { h.bucketCount = 0; })), "zero buckets throw");
+    Check(!opens(withHeader([](Header& h) { h.bucketCount = 0xFFFFFFFF; })), "bucket table past the end throws");
+    Check(!opens(withHeader([](Header& h) { h.entryCount += 1; })), "entry count not matching the buckets throws");
+    Check(!opens(withHeader([](Header& h) { h.entryCount = 0x7FFFFFFF; })), "entries past the end throw");
+    Check(!opens(withHeader([&](Header& h) { h.bucketsOffset = valid.size(); })), "bucket offset out of range throws");
+    Check(!opens(withHeader([](Header& h) { h.bucketsOffset += 2; })), "misaligned bucket table throws");
+    Check(!opens(withHeader([&](Header& h) { h.entriesOffset = valid.size() + 64; })), "entry offset out of range throws");
+    Check(!opens(withHeader([&](Header& h) { h.namesOffset = valid.size() + 1; })), "names offset out of range throws");
+
+    Check(!opens(withBucket(0, 1)), "first bucket not starting at entry 0 throws");
+    Check(!opens(withBucket(header.bucketCount, header.entryCount - 1)), "last bucket not ending at the entry count throws");
+    Check(!opens(withBucket(1, header.entryCount)), "buckets out of order throw");
+
+    // Top bits pick the bucket, flipping them moves the entry out of its bucket
+    Check(!opens(withEntry(0, [](Entry& e) { e.nameHash ^= 0x8000000000000000ull; })), "entry in the wrong bucket throws");
+    Check(!opens(withEntry(0, [&](Entry& e) { e.nameOffset = static_cast<uint32_t>(valid.size()); })), "name offset out of range throws");
+    Check(!opens(withEntry(0, [&](Entry& e) { e.nameLength = static_cast<uint32_t>(valid.size()); })), "name past the end throws");
+    Check(!opens(withEntry(0, [&](Entry& e) { e.dataOffset = valid.size() + nex::AssetArchive::DataAlignment; })),
+          "data offset out of range throws");
+    Check(!opens(withEntry(0, [](Entry& e) { e.dataOffset += 8; })), "misaligned data offset throws");
+    Check(!opens(withEntry(0, [&](Entry& e) { e.storedSize = valid.size(); })), "stored data past the end throws");
+    Check(!opens(withEntry(0, [](Entry& e) { e.compression = static_cast<Compression>(7); })), "unknown compression throws");
+
+    size_t stored = FindEntry(valid, Compression::None, true);
+    Check(!opens(withEntry(stored, [](Entry& e) { e.size += 1; })), "stored entry with two sizes throws");
+
+    // Checked before read() allocates the decompressed size
+    size_t compressed = FindEntry(valid, Compression::Lz4, true);
+    Check(!opens(withEntry(compressed, [](Entry& e) { e.size = nex::Lz4MaxDecompressedSize(e.storedSize) + 1; })),
+          "compressed size beyond what the data can hold throws");
+    Check(!opens(withEntry(compressed, [](Entry& e) { e.size = ~0ull; })), "huge compressed size throws");
+
+    // Still a plausible index, the data itself turns out corrupt on read
+    std::vector<char> badData = withEntry(compressed, [](Entry& e) { e.size += 1; });
+    Check(opens(badData), "compressed entry with a wrong but possible size opens");
+    {
+        WriteFile(corruptPath, badData);
+        nex::AssetArchive archive;
+        archive.open(corruptPath);
+        Check(Throws([&] { archive.read("assets/repeat.bin"); }), "reading a compressed entry of the wrong size throws");
+    }
+
+    std::filesystem::remove(corruptPath);
+}
+
+} // namespace
+
+int main() {
+    TestLz4RoundTrips();
+    TestLz4RejectsCorruptBlocks();
+
+    std::string filepath = TempPath("roundtrip.nxpk");
+    TestArchiveRoundTrip(filepath);
+    TestArchiveRejectsCorruption(filepath);
+    std::filesystem::remove(filepath);
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "AssetArchiveTest passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "FreeListAllocator.h"
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Drives the block bookkeeping VkMemoryAllocator sub-allocates with, without a
+// GPU: best fit at mixed alignments, coalescing on free, live allocations that
+// never overlap, and the block size and dedicated memory thresholds. Exits
+// with 1 if any check failed.
+
+namespace {
+
+constexpr VkDeviceSize MiB = 1024 * 1024;
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+void TestBestFit() {
+    nex::FreeListAllocator regions;
+    regions.init(1024);
+
+    // Leaves free holes of 64 at 64 and of 128 at 256, and the tail from 512
+    std::optional<VkDeviceSize> a = regions.allocate(64, 64);
+    std::optional<VkDeviceSize> hole1 = regions.allocate(64, 64);
+    std::optional<VkDeviceSize> b = regions.allocate(128, 128);
+    std::optional<VkDeviceSize> hole2 = regions.allocate(128, 128);
+    std::optional<VkDeviceSize> c = regions.allocate(128, 128);
+    Check(a == 0u && hole1 == 64u && b == 128u && hole2 == 256u && c == 384u, "empty block fills front to back");
+    regions.free(*hole1, 64);
+    regions.free(*hole2, 128);
+    Check(regions.freeRegionCount() == 3, "freed holes stay separate regions");
+
+    Check(regions.allocate(48, 16) == 64u, "smallest hole that fits is taken");
+    Check(regions.allocate(100, 4) == 256u, "next smallest hole is taken once the first is too small");
+    Check(regions.allocate(200, 8) == 512u, "only the tail fits");
+    Check(!regions.allocate(1024, 1), "allocation larger than the free space fails");
+}
+
+void TestAlignment() {
+    nex::FreeListAllocator regions;
+    regions.init(4096);
+
+    Check(regions.allocate(1, 1) == 0u, "byte allocation at the start");
+    std::optional<VkDeviceSize> aligned = regions.allocate(100, 256);
+    Check(aligned == 256u, "aligned allocation skips to the next boundary");
+    Check(regions.freeRegionCount() == 2, "padding before an aligned allocation stays free");
+
+    // The padding is reused by allocations whose alignment it satisfies
+    Check(regions.allocate(200, 8) == 8u, "padding is handed out again");
+    Check(regions.usedBytes() == 301, "used bytes count sizes, not padding");
+
+    // A region large enough but only without alignment is skipped
+    nex::FreeListAllocator small;
+    small.init(1024);
+    small.allocate(1, 1);
+    std::optional<VkDeviceSize> first = small.allocate(10, 1);
+    std::optional<VkDeviceSize> rest = small.allocate(1013, 1);
+    small.free(*first, 10);
+    Check(!small.allocate(10, 16), "region too small once aligned is not used");
+    small.free(*rest, 1013);
+    Check(small.allocate(10, 16) == 16u, "merged region fits the aligned allocation");
+}
+
+void TestCoalescing() {
+    nex::FreeListAllocator regions;
+    regions.init(1000);
+
+    std::vector<VkDeviceSize> offsets;
+    for (uint32_t i = 0; i < 10; ++i) {
+        offsets.push_back(*regions.allocate(100, 1));
+    }
+    Check(!regions.allocate(1, 1), "block is full");
+    Check(regions.freeRegionCount() == 0 && regions.largestFreeRegion() == 0, "full block has no free region");
+
+    // Free every other allocation, nothing can merge yet
+    for (uint32_t i = 0; i < 10; i += 2) {
+        regions.free(offsets[i], 100);
+    }
+    Check(regions.freeRegionCount() == 5 && regions.largestFreeRegion() == 100, "separated frees stay separate");
+    Check(!regions.allocate(150, 1), "no single region holds 150 bytes");
+
+    // Each free in between merges with both neighbours
+    regions.free(offsets[1], 100);
+    Check(regions.freeRegionCount() == 4 && regions.largestFreeRegion() == 300, "free merges with the previous and next region");
+    regions.free(offsets[9], 100);
+    Check(regions.freeRegionCount() == 4 && regions.largestFreeRegion() == 300, "free at the end merges with the previous region");
+    for (uint32_t i = 3; i < 9; i += 2) {
+        regions.free(offsets[i], 100);
+    }
+    Check(regions.freeRegionCount() == 1 && regions.largestFreeRegion() == 1000, "all frees merge back into one region");
+    Check(regions.allocationCount() == 0 && regions.usedBytes() == 0, "nothing left allocated");
+    Check(regions.allocate(1000, 1) == 0u, "whole block is usable again");
+}
+
+void TestRandomNoOverlap() {
+    constexpr VkDeviceSize BlockSize = 16 * MiB;
+
+    nex::FreeListAllocator regions;
+    regions.init(BlockSize);
+
+    std::mt19937 random(42);
+    // Live allocations by offset, value is the size
+    std::map<VkDeviceSize, VkDeviceSize> live;
+    VkDeviceSize liveBytes = 0;
+    bool noOverlap = true;
+    bool aligned = true;
+    bool inBounds = true;
+
+    for (uint32_t step = 0; step < 20000; ++step) {
+        if (live.empty() || random() % 3 != 0) {
+            VkDeviceSize size = 1 + random() % (64 * 1024);
+            VkDeviceSize alignment = VkDeviceSize(1) << (random() % 13);
+            std::optional<VkDeviceSize> offset = regions.allocate(size, alignment);
+            if (!offset) {
+                continue;
+            }
+
+            aligned = aligned && *offset % alignment == 0;
+            inBounds = inBounds && *offset + size <= BlockSize;
+
+            auto next = live.lower_bound(*offset);
+            if (next != live.end()) {
+                noOverlap = noOverlap && *offset + size <= next->first;
+            }
+            if (next != live.begin()) {
+                auto prev = std::prev(next);
+                noOverlap = noOverlap && prev->first + prev->second <= *offset;
+            }
+
+            live.emplace(*offset, size);
+            liveBytes += size;
+        } else {
+            auto victim = std::next(live.begin(), random() % live.size());
+            regions.free(victim->first, victim->second);
+            liveBytes -= victim->second;
+            live.erase(victim);
+        }
+    }
+
+    Check(aligned, "every offset honours its alignment");
+    Check(inBounds, "every allocation lies inside the block");
+    Check(noOverlap, "live allocations never overlap");
+    Check(regions.usedBytes() == liveBytes && regions.allocationCount() == live.size(), "used bytes and count track the live allocations");
+
+    for (const auto& [offset, size] : live) {
+        regions.free(offset, size);
+    }
+    Check(regions.freeRegionCount() == 1 && regions.largestFreeRegion() == BlockSize, "freeing everything coalesces the whole block");
+}
+
+void TestDedicatedThreshold() {
+    constexpr VkDeviceSize DefaultBlockSize = 64 * MiB;
+
+    Check(nex::MemoryBlockSize(DefaultBlockSize, 8192 * MiB) == DefaultBlockSize, "large heaps use the default block size");
+    Check(nex::MemoryBlockSize(DefaultBlockSize, 256 * MiB) == 32 * MiB, "small heaps use an eighth of the heap");
+
+    Check(!nex::NeedsDedicatedMemory(32 * MiB, 64 * MiB), "half a block is sub-allocated");
+    Check(nex::NeedsDedicatedMemory(32 * MiB + 1, 64 * MiB), "more than half a block is dedicated");
+    Check(nex::NeedsDedicatedMemory(16 * MiB + 1, nex::MemoryBlockSize(DefaultBlockSize, 256 * MiB)),
+          "dedicated threshold follows the smaller block of a small heap");
+
+    // Half a block, the largest sub-allocation, still fits aligned to its size beside another one
+    nex::FreeListAllocator regions;
+    regions.init(64 * MiB);
+    Check(regions.allocate(16 * MiB, 1).has_value(), "allocation below the threshold fits");
+    Check(regions.allocate(32 * MiB, 32 * MiB) == 32 * MiB, "largest sub-allocation fits beside it");
+}
+
+} // namespace
+
+int main() {
+    TestBestFit();
+    TestAlignment();
+    TestCoalescing();
+    TestRandomNoOverlap();
+    TestDedicatedThreshold();
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "FreeListAllocatorTest passed" << std::endl;
+    return 0;
+}
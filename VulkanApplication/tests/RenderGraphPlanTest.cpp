@@ -0,0 +1,270 @@
+#include "RenderGraphPlan.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Plans culling and barriers for small pass sequences the way RenderGraph
+// declares them, without a GPU, and checks the layouts, stages and access
+// masks of every barrier. Exits with 1 if any check failed.
+
+namespace {
+
+constexpr VkPipelineStageFlags FragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+constexpr VkAccessFlags ColorReadWrite = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+constexpr VkAccessFlags ShaderReadWrite = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+// Same flags RenderPassBuilder passes for a cleared attachment, a read and a storage write
+nex::ImageUse ClearedAttachment(uint32_t image, nex::ImageAccess access) {
+    return { image, access, false, true };
+}
+
+nex::ImageUse Read(uint32_t image, nex::ImageAccess access) {
+    return { image, access, true, false };
+}
+
+nex::ImageUse Write(uint32_t image, nex::ImageAccess access) {
+    return { image, access, false, false };
+}
+
+nex::PlanPass Pass(std::vector<nex::ImageUse> uses, bool sideEffects = false) {
+    nex::PlanPass pass;
+    pass.uses = std::move(uses);
+    pass.sideEffects = sideEffects;
+    return pass;
+}
+
+// Transient images that have their memory alone
+std::vector<nex::PlanImage> TransientImages(uint32_t count) {
+    std::vector<nex::PlanImage> images(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        images[i].aliasPredecessor = i;
+    }
+    return images;
+}
+
+std::vector<uint32_t> AllPasses(const std::vector<nex::PlanPass>& passes) {
+    std::vector<uint32_t> order;
+    for (uint32_t passIdx = 0; passIdx < passes.size(); ++passIdx) {
+        order.push_back(passIdx);
+    }
+    return order;
+}
+
+void TestWriteThenComputeThenFragmentRead() {
+    std::vector<nex::PlanPass> passes = {
+        Pass({ Write(0, nex::ImageAccess::ComputeStorageWrite) }),
+        Pass({ Read(0, nex::ImageAccess::ComputeSampled) }),
+        Pass({ Read(0, nex::ImageAccess::FragmentSampled) }),
+        Pass({ Read(0, nex::ImageAccess::ComputeSampled) }),
+    };
+    std::vector<nex::PlanImage> images = TransientImages(1);
+
+    nex::BarrierPlan plan = nex::PlanBarriers(passes, AllPasses(passes), images);
+    Check(plan.passBarriers.size() == 4, "one barrier batch per pass");
+
+    const nex::BarrierBatch& computeRead = plan.passBarriers[1];
+    Check(computeRead.barriers.size() == 1, "compute read after the write has a barrier");
+    if (computeRead.barriers.size() == 1) {
+        const nex::ImageBarrier& barrier = computeRead.barriers[0];
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_GENERAL && barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              "compute read transitions the storage image to SHADER_READ_ONLY_OPTIMAL");
+        Check(barrier.srcAccess == ShaderReadWrite && barrier.dstAccess == VK_ACCESS_SHADER_READ_BIT,
+              "compute read makes the storage write visible to shader reads");
+    }
+    Check(computeRead.srcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT && computeRead.dstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          "compute read waits for the compute write");
+
+    // The compute barrier did not make the write visible to the fragment shader
+    const nex::BarrierBatch& fragmentRead = plan.passBarriers[2];
+    Check(fragmentRead.barriers.size() == 1, "fragment read after the compute read still has a barrier");
+    if (fragmentRead.barriers.size() == 1) {
+        const nex::ImageBarrier& barrier = fragmentRead.barriers[0];
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              "fragment read keeps the layout");
+        Check(barrier.srcAccess == ShaderReadWrite && barrier.dstAccess == VK_ACCESS_SHADER_READ_BIT,
+              "fragment read makes the storage write visible");
+    }
+    Check(fragmentRead.srcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT && fragmentRead.dstStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          "fragment read waits for the compute stage");
+
+    Check(plan.passBarriers[3].barriers.empty(), "second compute read is covered by the first one's barrier");
+    Check(plan.finalBarriers.barriers.empty(), "transient images have no final barrier");
+}
+
+void TestReadAfterLayoutTransition() {
+    std::vector<nex::PlanPass> passes = {
+        Pass({ ClearedAttachment(0, nex::ImageAccess::ColorAttachment) }),
+        Pass({ Read(0, nex::ImageAccess::FragmentSampled) }),
+        Pass({ Read(0, nex::ImageAccess::ComputeSampled) }),
+        Pass({ Read(0, nex::ImageAccess::TransferSrc) }),
+    };
+    std::vector<nex::PlanImage> images = TransientImages(1);
+
+    nex::BarrierPlan plan = nex::PlanBarriers(passes, AllPasses(passes), images);
+
+    const nex::BarrierBatch& transition = plan.passBarriers[1];
+    Check(transition.barriers.size() == 1 && transition.barriers[0].oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+              && transition.barriers[0].newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          "fragment read transitions the attachment");
+
+    // The transition only finishes before the fragment stage, the compute read has to chain through it
+    const nex::BarrierBatch& computeRead = plan.passBarriers[2];
+    Check(computeRead.barriers.size() == 1, "compute read after the transition has a barrier");
+    if (computeRead.barriers.size() == 1) {
+        const nex::ImageBarrier& barrier = computeRead.barriers[0];
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              "compute read does not transition again");
+        Check(barrier.srcAccess == ColorReadWrite, "compute read synchronizes with the attachment write");
+    }
+    Check((computeRead.srcStages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0, "compute read waits for the transition's stage");
+    Check((computeRead.srcStages & VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) != 0, "compute read waits for the attachment write");
+    Check(computeRead.dstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "compute read blocks the compute stage");
+
+    // A transition to another layout has to wait for every read of the old one
+    const nex::BarrierBatch& transferRead = plan.passBarriers[3];
+    Check(transferRead.barriers.size() == 1 && transferRead.barriers[0].newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          "transfer read transitions to TRANSFER_SRC_OPTIMAL");
+    VkPipelineStageFlags reads = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    Check((transferRead.srcStages & reads) == reads, "transfer transition waits for the fragment and compute reads");
+}
+
+void TestAliasPredecessorSource() {
+    // Image 1 takes over the memory of image 0 after its last read
+    std::vector<nex::PlanPass> passes = {
+        Pass({ ClearedAttachment(0, nex::ImageAccess::ColorAttachment) }),
+        Pass({ Read(0, nex::ImageAccess::FragmentSampled), ClearedAttachment(2, nex::ImageAccess::ColorAttachment) }),
+        Pass({ Write(1, nex::ImageAccess::ComputeStorageWrite) }),
+    };
+    std::vector<nex::PlanImage> images = TransientImages(3);
+    images[1].aliasPredecessor = 0;
+
+    nex::BarrierPlan plan = nex::PlanBarriers(passes, AllPasses(passes), images);
+
+    const nex::BarrierBatch& firstUse = plan.passBarriers[2];
+    Check(firstUse.barriers.size() == 1, "aliased image has a barrier on first use");
+    if (firstUse.barriers.size() == 1) {
+        const nex::ImageBarrier& barrier = firstUse.barriers[0];
+        Check(barrier.image == 1, "barrier is for the aliased image");
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && barrier.newLayout == VK_IMAGE_LAYOUT_GENERAL,
+              "aliased image starts out undefined");
+        Check(barrier.srcAccess == ColorReadWrite, "aliased image waits for the predecessor's attachment write");
+        Check(barrier.dstAccess == ShaderReadWrite, "aliased image is made available to the storage write");
+    }
+    VkPipelineStageFlags predecessorStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    Check((firstUse.srcStages & predecessorStages) == predecessorStages, "aliased image waits for the predecessor's write and reads");
+    Check(firstUse.dstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "aliased image blocks the compute stage");
+
+    // Without an alias the first use waits for the image's own last use, from the previous frame
+    const nex::BarrierBatch& ownFirstUse = plan.passBarriers[0];
+    Check(ownFirstUse.barriers.size() == 1 && ownFirstUse.barriers[0].srcAccess == ColorReadWrite,
+          "unaliased image waits for its own last write");
+    Check((ownFirstUse.srcStages & predecessorStages) == predecessorStages, "unaliased image waits for its own last write and reads");
+}
+
+void TestImportedFinalBarrier() {
+    std::vector<nex::PlanImage> images(3);
+    // Swapchain image, acquired before the color attachment stage
+    images[0].imported = true;
+    images[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    images[0].initialStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    images[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Already in its final layout after the last pass
+    images[1].imported = true;
+    images[1].initialLayout = VK_IMAGE_LAYOUT_GENERAL;
+    images[1].initialStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    images[1].initialAccess = VK_ACCESS_SHADER_WRITE_BIT;
+    images[1].finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+    images[2].aliasPredecessor = 2;
+
+    std::vector<nex::PlanPass> passes = {
+        Pass({ Write(1, nex::ImageAccess::ComputeStorageWrite) }),
+        Pass({ ClearedAttachment(0, nex::ImageAccess::ColorAttachment), ClearedAttachment(2, nex::ImageAccess::DepthAttachment) }),
+    };
+
+    nex::BarrierPlan plan = nex::PlanBarriers(passes, AllPasses(passes), images);
+
+    const nex::BarrierBatch& storageWrite = plan.passBarriers[0];
+    Check(storageWrite.barriers.size() == 1 && storageWrite.barriers[0].srcAccess == VK_ACCESS_SHADER_WRITE_BIT,
+          "imported image waits for its initial access");
+    Check(storageWrite.srcStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "imported image waits for its initial stages");
+
+    const nex::BarrierBatch& scenePass = plan.passBarriers[1];
+    Check(scenePass.barriers.size() == 2, "scene pass transitions both attachments");
+    if (scenePass.barriers.size() == 2) {
+        const nex::ImageBarrier& barrier = scenePass.barriers[0];
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && barrier.newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+              "swapchain image starts in its initial layout");
+        Check(barrier.srcAccess == 0, "swapchain image has no initial access");
+    }
+    Check((scenePass.srcStages & VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) != 0, "scene pass waits for the acquire stage");
+    Check(scenePass.dstStages == (VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | FragmentTests), "scene pass blocks both attachment stages");
+
+    Check(plan.finalBarriers.barriers.size() == 1, "only the image not in its final layout gets a final barrier");
+    if (plan.finalBarriers.barriers.size() == 1) {
+        const nex::ImageBarrier& barrier = plan.finalBarriers.barriers[0];
+        Check(barrier.image == 0, "final barrier is for the swapchain image");
+        Check(barrier.oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL && barrier.newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+              "final barrier transitions to the final layout");
+        Check(barrier.srcAccess == ColorReadWrite && barrier.dstAccess == 0, "final barrier makes the attachment write available");
+    }
+    Check(plan.finalBarriers.srcStages == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "final barrier waits for the attachment write");
+    Check(plan.finalBarriers.dstStages == VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "final barrier blocks nothing after the graph");
+}
+
+void TestCullOverwrittenOutput() {
+    std::vector<nex::PlanImage> images = TransientImages(4);
+    images[1].imported = true;
+
+    std::vector<nex::PlanPass> passes = {
+        // Cleared again by the next pass before anything reads it
+        Pass({ ClearedAttachment(0, nex::ImageAccess::ColorAttachment) }),
+        Pass({ ClearedAttachment(0, nex::ImageAccess::ColorAttachment) }),
+        Pass({ Read(0, nex::ImageAccess::FragmentSampled), ClearedAttachment(1, nex::ImageAccess::ColorAttachment) }),
+        // Nothing reads image 3
+        Pass({ Write(3, nex::ImageAccess::ComputeStorageWrite) }),
+        Pass({ Write(3, nex::ImageAccess::ComputeStorageWrite) }, true),
+    };
+
+    std::vector<uint32_t> order = nex::CullPasses(passes, images);
+    Check(order == std::vector<uint32_t>({ 1, 2, 4 }), "overwritten and unread passes are culled, side effects kept");
+
+    Check(nex::ContentsNeededAfter(passes, order, images, 0, 0), "image read by a later pass is stored");
+    Check(!nex::ContentsNeededAfter(passes, order, images, 0, 1), "image after its last read is not stored");
+    Check(nex::ContentsNeededAfter(passes, order, images, 1, 1), "imported image is stored for the caller");
+
+    // A pass reading what the overwritten one produced keeps it alive
+    passes[1] = Pass({ Read(0, nex::ImageAccess::FragmentSampled), ClearedAttachment(2, nex::ImageAccess::ColorAttachment) });
+    passes[2] = Pass({ Read(2, nex::ImageAccess::FragmentSampled), ClearedAttachment(1, nex::ImageAccess::ColorAttachment) });
+    order = nex::CullPasses(passes, images);
+    Check(order == std::vector<uint32_t>({ 0, 1, 2, 4 }), "producer of a read image is kept");
+}
+
+} // namespace
+
+int main() {
+    TestWriteThenComputeThenFragmentRead();
+    TestReadAfterLayoutTransition();
+    TestAliasPredecessorSource();
+    TestImportedFinalBarrier();
+    TestCullOverwrittenOutput();
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "RenderGraphPlanTest passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "ShaderReflection.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Reflects the SPIR-V the build compiles from assets/ and checks what the
+// pipelines rely on: vertex and fragment inputs with their locations, the
+// bindless bindings, push constant sizes, specialization constant ids and the
+// compute local sizes. Also feeds malformed modules that have to throw.
+// Exits with 1 if any check failed.
+
+#ifndef SHADER_ASSET_DIRECTORY
+#define SHADER_ASSET_DIRECTORY "assets"
+#endif
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+nex::ShaderReflection ReflectAsset(const std::string& name) {
+    std::string path = std::string(SHADER_ASSET_DIRECTORY) + "/" + name + ".spv";
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    std::streamsize size = file.tellg();
+    std::vector<uint32_t> code(static_cast<size_t>(size) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+
+    return nex::ReflectSpirv(code.data(), code.size());
+}
+
+bool HasInput(const nex::ShaderReflection& reflection, size_t index, uint32_t location, nex::ShaderBaseType baseType,
+              uint32_t componentCount, const std::string& name) {
+    if (index >= reflection.inputs.size()) {
+        return false;
+    }
+    const nex::ReflectedInput& input = reflection.inputs[index];
+    return input.location == location && input.baseType == baseType && input.componentCount == componentCount && input.name == name;
+}
+
+bool HasBinding(const nex::ShaderReflection& reflection, size_t index, uint32_t binding, VkDescriptorType type, uint32_t count) {
+    if (index >= reflection.bindings.size()) {
+        return false;
+    }
+    const nex::ReflectedBinding& reflected = reflection.bindings[index];
+    return reflected.set == 0 && reflected.binding == binding && reflected.type == type && reflected.count == count;
+}
+
+std::vector<uint32_t> SpecConstantIds(const nex::ShaderReflection& reflection) {
+    std::vector<uint32_t> ids;
+    for (const auto& specConstant : reflection.specConstants) {
+        ids.push_back(specConstant.id);
+    }
+    return ids;
+}
+
+void TestVertexShader() {
+    nex::ShaderReflection vert = ReflectAsset("triangle.vert");
+
+    Check(vert.stage == VK_SHADER_STAGE_VERTEX_BIT, "triangle.vert is a vertex shader");
+    Check(vert.inputs.size() == 5, "triangle.vert has the vertex and instance attributes, no builtins");
+    Check(HasInput(vert, 0, 0, nex::ShaderBaseType::Float, 2, "inPosition"), "triangle.vert inPosition at location 0");
+    Check(HasInput(vert, 1, 1, nex::ShaderBaseType::Float, 3, "inColor"), "triangle.vert inColor at location 1");
+    Check(HasInput(vert, 2, 2, nex::ShaderBaseType::Float, 2, "inInstanceOffset"), "triangle.vert inInstanceOffset at location 2");
+    Check(HasInput(vert, 3, 3, nex::ShaderBaseType::Float, 1, "inInstanceScale"), "triangle.vert inInstanceScale at location 3");
+    Check(HasInput(vert, 4, 4, nex::ShaderBaseType::Uint, 1, "inInstanceDrawIndex"), "triangle.vert inInstanceDrawIndex at location 4");
+
+    Check(vert.bindings.size() == 1, "triangle.vert uses one binding");
+    Check(HasBinding(vert, 0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0), "triangle.vert reads the bindless storage buffers");
+    Check(vert.pushConstantSize == 8, "triangle.vert push constants hold two slots");
+    Check(SpecConstantIds(vert) == std::vector<uint32_t> { 0 }, "triangle.vert VertexColor is spec constant 0");
+}
+
+void TestFragmentShader() {
+    nex::ShaderReflection frag = ReflectAsset("triangle.frag");
+
+    Check(frag.stage == VK_SHADER_STAGE_FRAGMENT_BIT, "triangle.frag is a fragment shader");
+    Check(frag.inputs.size() == 2, "triangle.frag has two inputs, no builtins");
+    Check(HasInput(frag, 0, 0, nex::ShaderBaseType::Float, 3, "vertColor"), "triangle.frag vertColor at location 0");
+    Check(HasInput(frag, 1, 1, nex::ShaderBaseType::Uint, 1, "drawIndex"), "triangle.frag drawIndex at location 1");
+
+    // The two storage buffer blocks alias binding 2 and come out as one binding
+    Check(frag.bindings.size() == 3, "triangle.frag uses the three bindless bindings");
+    Check(HasBinding(frag, 0, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 0), "triangle.frag textures are a runtime array at binding 0");
+    Check(HasBinding(frag, 1, 1, VK_DESCRIPTOR_TYPE_SAMPLER, 0), "triangle.frag samplers are a runtime array at binding 1");
+    Check(HasBinding(frag, 2, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0), "triangle.frag storage buffers merge at binding 2");
+    Check(frag.pushConstantSize == 8, "triangle.frag push constants hold two slots");
+    Check(SpecConstantIds(frag) == std::vector<uint32_t> { 1, 2 }, "triangle.frag Textured and TextureTaps are spec constants 1 and 2");
+}
+
+void TestComputeShaders() {
+    nex::ShaderReflection cull = ReflectAsset("cull.comp");
+
+    Check(cull.stage == VK_SHADER_STAGE_COMPUTE_BIT, "cull.comp is a compute shader");
+    Check(cull.inputs.empty(), "cull.comp only reads builtin inputs");
+    Check(cull.localSize == std::array<uint32_t, 3> { 0, 1, 1 }, "cull.comp local size x comes from local_size_x_id");
+    Check(SpecConstantIds(cull) == std::vector<uint32_t> { 0, 1 }, "cull.comp local size and CompactCommands are spec constants 0 and 1");
+    Check(cull.bindings.size() == 1, "cull.comp uses one binding");
+    Check(HasBinding(cull, 0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0), "cull.comp storage buffers merge at binding 2");
+    Check(cull.pushConstantSize == 32, "cull.comp push constants hold the depth size and six words");
+
+    nex::ShaderReflection hiz = ReflectAsset("hiz.comp");
+
+    Check(hiz.stage == VK_SHADER_STAGE_COMPUTE_BIT, "hiz.comp is a compute shader");
+    Check(hiz.localSize == std::array<uint32_t, 3> { 8, 8, 1 }, "hiz.comp local size is 8x8x1");
+    Check(hiz.specConstants.empty(), "hiz.comp has no spec constants");
+    Check(hiz.bindings.size() == 3, "hiz.comp uses the three bindless bindings");
+    Check(HasBinding(hiz, 0, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 0), "hiz.comp textures are a runtime array at binding 0");
+    Check(HasBinding(hiz, 1, 1, VK_DESCRIPTOR_TYPE_SAMPLER, 0), "hiz.comp samplers are a runtime array at binding 1");
+    Check(HasBinding(hiz, 2, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0), "hiz.comp storage buffer at binding 2");
+    Check(hiz.pushConstantSize == 24, "hiz.comp push constants hold the depth size and four words");
+}
+
+bool Throws(const std::vector<uint32_t>& code) {
+    try {
+        nex::ReflectSpirv(code.data(), code.size());
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void TestMalformedModules() {
+    const std::vector<uint32_t> header = { 0x07230203, 0x00010500, 0, 16, 0 };
+    auto instruction = [](uint32_t opcode, uint32_t length) { return (length << 16) | opcode; };
+
+    Check(Throws({ 0x07230203, 0x00010500 }), "truncated header throws");
+    Check(Throws({ 0xDEADBEEF, 0x00010500, 0, 16, 0 }), "wrong magic throws");
+    Check(Throws(header), "module without an entry point throws");
+
+    std::vector<uint32_t> overrun = header;
+    overrun.push_back(instruction(30, 4));
+    overrun.push_back(1);
+    Check(Throws(overrun), "instruction running past the end throws");
+
+    // OpTypeStruct without a result id
+    std::vector<uint32_t> structure = header;
+    structure.push_back(instruction(30, 1));
+    Check(Throws(structure), "OpTypeStruct too short for its result id throws");
+}
+
+} // namespace
+
+int main() {
+    try {
+        TestVertexShader();
+        TestFragmentShader();
+        TestComputeShaders();
+    } catch (const std::exception& e) {
+        std::cerr << "FAILED: " << e.what() << std::endl;
+        ++g_failures;
+    }
+    TestMalformedModules();
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "ShaderReflectionTest passed" << std::endl;
+    return 0;
+}
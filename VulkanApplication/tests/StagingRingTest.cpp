@@ -0,0 +1,166 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Drives StagingRing the way StagingUploader does, without a GPU: uploads are
+// split into chunks, chunks are grouped into batches and batches retire in
+// submission order whenever the ring is full. Exits with 1 on the first failure.
+
+namespace {
+
+constexpr VkDeviceSize Alignment = 16;
+
+struct Range {
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+};
+
+struct Batch {
+    VkDeviceSize consumed = 0;
+    std::vector<Range> ranges;
+};
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+bool Overlaps(const Range& lhs, const Range& rhs) {
+    return lhs.offset < rhs.offset + rhs.size && rhs.offset < lhs.offset + lhs.size;
+}
+
+class UploadSimulation {
+public:
+    explicit UploadSimulation(VkDeviceSize ringSize) {
+        m_ring.init(ringSize);
+    }
+
+    void upload(VkDeviceSize size) {
+        for (VkDeviceSize copied = 0; copied < size;) {
+            VkDeviceSize chunkSize = std::min(size - copied, m_ring.maxChunkSize());
+            place(allocate(chunkSize));
+            copied += chunkSize;
+        }
+    }
+
+    void flush() {
+        if (!m_recording.ranges.empty()) {
+            m_submitted.push_back(std::move(m_recording));
+            m_recording = {};
+        }
+    }
+
+    void retireAll() {
+        flush();
+        while (!m_submitted.empty()) {
+            retireOldest();
+        }
+    }
+
+    nex::StagingRing& ring() {
+        return m_ring;
+    }
+
+    VkDeviceSize uploadedBytes() const {
+        return m_uploadedBytes;
+    }
+
+private:
+    Range allocate(VkDeviceSize size) {
+        while (true) {
+            if (auto allocation = m_ring.tryAllocate(size, Alignment)) {
+                m_recording.consumed += allocation->consumed;
+                return { allocation->offset, size };
+            }
+
+            flush();
+            if (m_submitted.empty()) {
+                Check(false, "a chunk of " + std::to_string(size) + " bytes does not fit into an idle ring");
+                return {};
+            }
+            retireOldest();
+        }
+    }
+
+    void place(const Range& range) {
+        Check(range.offset % Alignment == 0, "offset " + std::to_string(range.offset) + " is not aligned");
+        Check(range.offset + range.size <= m_ring.size(), "allocation runs past the end of the ring");
+
+        auto overlapsRange = [&](const Range& live) { return Overlaps(live, range); };
+        bool overlaps = std::any_of(m_recording.ranges.begin(), m_recording.ranges.end(), overlapsRange);
+        for (const auto& batch : m_submitted) {
+            overlaps = overlaps || std::any_of(batch.ranges.begin(), batch.ranges.end(), overlapsRange);
+        }
+        Check(!overlaps, "allocation at " + std::to_string(range.offset) + " overlaps staging still in flight");
+
+        m_recording.ranges.push_back(range);
+        m_uploadedBytes += range.size;
+    }
+
+    void retireOldest() {
+        m_ring.release(m_submitted.front().consumed);
+        m_submitted.pop_front();
+    }
+
+private:
+    nex::StagingRing m_ring;
+    Batch m_recording;
+    std::deque<Batch> m_submitted;
+    VkDeviceSize m_uploadedBytes = 0;
+};
+
+void TestUploadsLargerThanTheRing() {
+    constexpr VkDeviceSize RingSize = 64 * 1024;
+    UploadSimulation simulation(RingSize);
+
+    // Sizes sharing no factor with the ring size or the alignment, more than three rings in total
+    VkDeviceSize expected = 0;
+    for (VkDeviceSize size : { 1ull, 1000ull, 40001ull, 65535ull, 77777ull, 13ull, 33333ull }) {
+        simulation.upload(size);
+        expected += size;
+    }
+
+    Check(expected > 3 * RingSize, "the uploads cover more than three rings");
+    Check(simulation.uploadedBytes() == expected, "every byte is uploaded");
+
+    simulation.retireAll();
+    Check(simulation.ring().used() == 0, "the ring is empty once every batch retired");
+}
+
+void TestWholeRingFitsOnceIdle() {
+    // The head is left in the middle of the ring, where the next chunk does not fit before or after it
+    constexpr VkDeviceSize RingSize = 16 * 1024 * 1024;
+    nex::StagingRing ring;
+    ring.init(RingSize);
+
+    auto first = ring.tryAllocate(9'650'000, Alignment);
+    Check(first.has_value(), "the first allocation fits into an empty ring");
+    ring.release(first ? first->consumed : 0);
+
+    auto second = ring.tryAllocate(12'000'000, Alignment);
+    Check(second.has_value() && second->offset == 0, "an idle ring hands out space from its start");
+}
+
+} // namespace
+
+int main() {
+    TestUploadsLargerThanTheRing();
+    TestWholeRingFitsOnceIdle();
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "StagingRingTest passed" << std::endl;
+    return 0;
+}
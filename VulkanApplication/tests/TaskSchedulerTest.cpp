@@ -0,0 +1,271 @@
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stresses TaskScheduler with tasks that can only run by being stolen, with
+// more tasks than a worker deque holds, with dependency chains and diamonds
+// and with throwing tasks. Every task has to run exactly once. Exits with 1
+// if any check failed.
+
+namespace {
+
+constexpr uint32_t WorkerCount = 4;
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+void SpinUntil(const std::atomic<bool>& flag) {
+    while (!flag.load()) {
+        std::this_thread::yield();
+    }
+}
+
+bool RanOnce(const std::vector<std::atomic<uint32_t>>& runs) {
+    for (const auto& count : runs) {
+        if (count.load() != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestDequeCapacity() {
+    // Never dereferenced, the deque only moves the pointers around
+    auto fakeTask = [](int64_t i) { return reinterpret_cast<nex::Task*>(static_cast<uintptr_t>(i + 1) * 64); };
+
+    auto deque = std::make_unique<nex::WorkStealingDeque>();
+    bool pushedAll = true;
+    for (int64_t i = 0; i < nex::WorkStealingDeque::Capacity; ++i) {
+        pushedAll = pushedAll && deque->push(fakeTask(i));
+    }
+    Check(pushedAll, "deque takes Capacity tasks");
+    Check(!deque->push(fakeTask(-1)), "full deque refuses a push");
+
+    Check(deque->steal() == fakeTask(0), "steal takes the oldest task");
+    Check(deque->push(fakeTask(nex::WorkStealingDeque::Capacity)), "stolen slot is reused");
+    Check(deque->pop() == fakeTask(nex::WorkStealingDeque::Capacity), "pop takes the newest task");
+
+    int64_t remaining = 0;
+    while (deque->pop()) {
+        ++remaining;
+    }
+    Check(remaining == nex::WorkStealingDeque::Capacity - 1, "every task comes out once");
+    Check(deque->steal() == nullptr, "empty deque has nothing to steal");
+}
+
+void TestStolenSpawns() {
+    constexpr uint32_t TaskCount = 2000;
+
+    nex::TaskScheduler scheduler(WorkerCount);
+    std::vector<std::atomic<uint32_t>> runs(TaskCount);
+
+    // The spawning worker keeps busy until every child ran, so the other workers
+    // have to steal all of them. Waiting on the future does not run tasks.
+    std::atomic<uint32_t> done { 0 };
+    std::future<void> root = scheduler.submit([&]() {
+        for (uint32_t i = 0; i < TaskCount; ++i) {
+            scheduler.spawn([&runs, &done, i]() {
+                runs[i].fetch_add(1);
+                done.fetch_add(1);
+            });
+        }
+        while (done.load() < TaskCount) {
+            std::this_thread::yield();
+        }
+    });
+    root.get();
+
+    Check(RanOnce(runs), "every stolen task ran exactly once");
+
+    // Counted when a task is taken, before it runs
+    uint64_t stolen = 0;
+    for (const auto& stats : scheduler.workerStats()) {
+        stolen += stats.stolen;
+    }
+    Check(stolen >= TaskCount, "children spawned on a busy worker were stolen");
+}
+
+void TestDequeOverflow() {
+    constexpr uint32_t TaskCount = 3 * nex::WorkStealingDeque::Capacity;
+
+    nex::TaskScheduler scheduler(WorkerCount);
+    std::vector<std::atomic<uint32_t>> runs(TaskCount);
+    std::atomic<bool> released { false };
+
+    // Children hold up whichever worker takes one until all are spawned, so
+    // the spawning worker's deque fills up and the rest go to the injection queue
+    nex::TaskCounter counter;
+    std::future<void> root = scheduler.submit([&]() {
+        for (uint32_t i = 0; i < TaskCount; ++i) {
+            scheduler.spawn([&runs, &released, i]() {
+                SpinUntil(released);
+                runs[i].fetch_add(1);
+            }, &counter);
+        }
+        released = true;
+        scheduler.wait(counter);
+    });
+    root.get();
+
+    Check(counter.done(), "counter reaches zero");
+    Check(RanOnce(runs), "every task past the deque capacity ran exactly once");
+}
+
+void TestSpawnFromManyThreads() {
+    constexpr uint32_t ThreadCount = 4;
+    constexpr uint32_t TasksPerThread = 5000;
+
+    nex::TaskScheduler scheduler(WorkerCount);
+    std::vector<std::atomic<uint32_t>> runs(ThreadCount * TasksPerThread);
+
+    // Half of the tasks spawn their own child from a worker, the rest come through the injection queue
+    nex::TaskCounter counter;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < ThreadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint32_t i = 0; i < TasksPerThread; i += 2) {
+                uint32_t index = t * TasksPerThread + i;
+                scheduler.spawn([&, index]() {
+                    runs[index].fetch_add(1);
+                    scheduler.spawn([&runs, index]() { runs[index + 1].fetch_add(1); }, &counter);
+                }, &counter);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    scheduler.wait(counter);
+
+    Check(RanOnce(runs), "tasks spawned from many threads and workers ran exactly once");
+}
+
+void TestDependencyOrder() {
+    nex::TaskScheduler scheduler(WorkerCount);
+
+    // Racing the spawns against the dependencies finishing, many times over
+    bool ordered = true;
+    for (uint32_t iteration = 0; iteration < 500; ++iteration) {
+        std::atomic<uint32_t> sequence { 0 };
+        uint32_t a = 0, b = 0, c = 0, d = 0, e = 0;
+
+        nex::TaskHandle taskA = scheduler.spawn([&]() { a = ++sequence; });
+        nex::TaskHandle taskB = scheduler.spawn([&]() { b = ++sequence; }, nullptr, { taskA });
+        nex::TaskHandle taskC = scheduler.spawn([&]() { c = ++sequence; }, nullptr, { taskA });
+        nex::TaskHandle taskD = scheduler.spawn([&]() { d = ++sequence; }, nullptr, { taskB, taskC });
+        // A chain continuing from a task that may well have finished already
+        nex::TaskHandle taskE = scheduler.spawn([&]() { e = ++sequence; }, nullptr, { taskD, taskA, nullptr });
+        scheduler.wait(taskE);
+
+        ordered = ordered && a != 0 && a < b && a < c && b < d && c < d && d < e && sequence == 5;
+    }
+    Check(ordered, "dependents run after every dependency, once each");
+
+    // Long chain spawned up front, each link depending on the previous one
+    constexpr uint32_t ChainLength = 1000;
+    std::atomic<bool> released { false };
+    std::vector<uint32_t> order;
+    std::vector<nex::TaskHandle> chain;
+    chain.push_back(scheduler.spawn([&]() { SpinUntil(released); }));
+    for (uint32_t i = 0; i < ChainLength; ++i) {
+        chain.push_back(scheduler.spawn([&order, i]() { order.push_back(i); }, nullptr, { chain.back() }));
+    }
+    released = true;
+    scheduler.wait(chain.back());
+
+    bool chainOrdered = order.size() == ChainLength;
+    for (uint32_t i = 0; chainOrdered && i < ChainLength; ++i) {
+        chainOrdered = order[i] == i;
+    }
+    Check(chainOrdered, "continuation chain runs in order");
+}
+
+void TestExceptions() {
+    nex::TaskScheduler scheduler(WorkerCount);
+
+    nex::TaskCounter counter;
+    nex::TaskHandle failing = scheduler.spawn([]() { throw std::runtime_error("task failed"); }, &counter);
+
+    std::string message;
+    try {
+        scheduler.wait(failing);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    Check(message == "task failed", "wait() rethrows the task's exception");
+
+    scheduler.wait(counter);
+    Check(counter.done(), "a throwing task still decrements its counter");
+
+    // The exception belongs to the failing task, its continuation still runs
+    std::atomic<bool> continued { false };
+    nex::TaskHandle continuation = scheduler.spawn([&continued]() { continued = true; }, nullptr, { failing });
+    scheduler.wait(continuation);
+    Check(continued, "continuation of a throwing task runs");
+
+    // Thrown on a worker while the waiter helps running other tasks
+    std::atomic<bool> released { false };
+    std::vector<nex::TaskHandle> tasks;
+    for (uint32_t i = 0; i < 64; ++i) {
+        tasks.push_back(scheduler.spawn([&released, i]() {
+            SpinUntil(released);
+            if (i % 2 == 1) {
+                throw std::runtime_error("task " + std::to_string(i));
+            }
+        }));
+    }
+    released = true;
+
+    bool rethrown = true;
+    for (uint32_t i = 0; i < tasks.size(); ++i) {
+        try {
+            scheduler.wait(tasks[i]);
+            rethrown = rethrown && i % 2 == 0;
+        } catch (const std::runtime_error& e) {
+            rethrown = rethrown && e.what() == "task " + std::to_string(i);
+        }
+    }
+    Check(rethrown, "every throwing task rethrows its own exception");
+
+    std::future<int> future = scheduler.submit([]() -> int { throw std::runtime_error("submit failed"); });
+    bool futureThrew = false;
+    try {
+        future.get();
+    } catch (const std::runtime_error&) {
+        futureThrew = true;
+    }
+    Check(futureThrew, "submit() hands the exception to the future");
+}
+
+} // namespace
+
+int main() {
+    TestDequeCapacity();
+    TestStolenSpawns();
+    TestDequeOverflow();
+    TestSpawnFromManyThreads();
+    TestDependencyOrder();
+    TestExceptions();
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "TaskSchedulerTest passed" << std::endl;
+    return 0;
+}
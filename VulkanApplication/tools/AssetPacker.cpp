@@ -0,0 +1,68 @@
+#include "AssetArchive.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Packs assets into the single archive AssetStore reads at startup. Run by the
+// add_compileShaders_target build step, every input is given as name=path
+// where name is what the runtime asks for, e.g. assets/triangle.vert.spv.
+
+int main(int argc, char** argv) {
+    bool compress = false;
+    std::string outputPath;
+    std::vector<std::pair<std::string, std::string>> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--compress") {
+            compress = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (size_t separator = arg.find('='); separator != std::string_view::npos && separator > 0) {
+            inputs.emplace_back(std::string(arg.substr(0, separator)), std::string(arg.substr(separator + 1)));
+        } else {
+            std::cerr << "Usage: AssetPacker [--compress] -o <archive> <name>=<file>..." << std::endl;
+            return 1;
+        }
+    }
+
+    if (outputPath.empty()) {
+        std::cerr << "Usage: AssetPacker [--compress] -o <archive> <name>=<file>..." << std::endl;
+        return 1;
+    }
+
+    try {
+        nex::AssetArchiveWriter writer;
+        for (const auto& [name, filepath] : inputs) {
+            nex::MappedFile file(filepath, nex::FileAccess::Sequential);
+            writer.add(name, file.data(), file.size(), compress);
+        }
+        writer.write(outputPath);
+
+        // Read everything back, so a packer bug fails the build instead of the first launch
+        nex::AssetArchive archive;
+        archive.open(outputPath);
+        for (const auto& [name, filepath] : inputs) {
+            nex::MappedFile file(filepath, nex::FileAccess::Sequential);
+            nex::Asset asset = archive.read(name);
+            if (asset.size() != file.size() || (file.size() > 0 && std::memcmp(asset.data(), file.data(), file.size()) != 0)) {
+                throw std::runtime_error("Asset " + name + " does not read back intact");
+            }
+        }
+
+        const auto& stats = writer.stats();
+        std::cout << "Packed " << stats.entryCount << " assets into " << outputPath << ": " << stats.size << " bytes stored as "
+                  << stats.storedSize << " (" << stats.compressedCount << " compressed)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "AssetPacker: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}